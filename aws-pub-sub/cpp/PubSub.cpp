@@ -25,13 +25,18 @@
  */
 
 
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <ctime>
 
 #ifdef USE_WEBSOCKETS
 #include "WebSocketConnection.hpp"
 #elif defined USE_MBEDTLS
 #include "MbedTLSConnection.hpp"
+#elif defined USE_IO_URING
+#include "IoUringConnection.hpp"
 #else
 #include "OpenSSLConnection.hpp"
 #endif
@@ -46,6 +51,9 @@
 #define LOG_TAG_PUBSUB "[Sample - PubSub]"
 #define MESSAGE_COUNT 5
 #define SDK_SAMPLE_TOPIC "sdk/test/cpp"
+#define SDK_BENCHMARK_TOPIC_PREFIX "sdk/test/cpp/benchmark"
+#define SDK_SAMPLE_PAYLOAD_LENGTH 64
+#define SDK_SAMPLE_RECEIVE_TIMEOUT_SECS 10
 
 
 
@@ -58,33 +66,341 @@ namespace awsiotsdk {
             ResponseCode rc;
             uint16_t packet_id = 0;
             int itr = 1;
-
-            util::String p_topic_name_str = SDK_SAMPLE_TOPIC;
+            char payload[SDK_SAMPLE_PAYLOAD_LENGTH];
 
             do {
-                util::String payload = "Hello from SDK : ";
-                payload.append(std::to_string(itr));
-                std::cout << "Publish Payload : " << payload << std::endl;
+                // Slots come back with the PUBACK, the payload is written in place without allocating
+                PayloadArena::Slot *p_slot = p_payload_arena_->Acquire(ConfigCommon::mqtt_command_timeout_);
+                if (nullptr == p_slot) {
+                    rc = ResponseCode::ACTION_QUEUE_FULL;
+                    itr--;
+                    continue;
+                }
+                int payload_length = snprintf(payload, sizeof(payload), "Hello from SDK : %d", itr);
+                p_slot->payload.assign(payload, static_cast<size_t>(payload_length));
+                std::cout << "Publish Payload : " << p_slot->payload << std::endl;
 
-                std::unique_ptr<Utf8String> p_topic_name = Utf8String::Create(p_topic_name_str);
-                rc = p_iot_client_->PublishAsync(std::move(p_topic_name), false, false, mqtt::QoS::QOS1,
-                                                 payload, nullptr, packet_id);
+                rc = p_publisher_->Publish(*p_sample_topic_, mqtt::QoS::QOS1, p_slot, packet_id,
+                                           ConfigCommon::mqtt_command_timeout_);
                 if (ResponseCode::SUCCESS == rc) {
                     cur_pending_messages_++;
                     total_published_messages_++;
                     std::cout << "Publish Packet Id : " << packet_id << std::endl;
                 } else if (ResponseCode::ACTION_QUEUE_FULL == rc) {
+                    // No acknowledgement within the command timeout, try the same message again
                     itr--;
-                    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
                 }
             } while (++itr <= msg_count && (ResponseCode::SUCCESS == rc || ResponseCode::ACTION_QUEUE_FULL == rc));
 
+            if (!p_publisher_->WaitForAcks(ConfigCommon::mqtt_command_timeout_)) {
+                AWS_LOG_WARN(LOG_TAG_PUBSUB, "%u publishes still unacknowledged",
+                             (unsigned int) p_publisher_->GetInFlightCount());
+            }
+            std::cout << "Publish window : " << p_publisher_->GetWindow()
+                      << ", acknowledged : " << p_publisher_->GetAckedCount()
+                      << ", failed : " << p_publisher_->GetFailedCount()
+                      << ", queue full : " << p_publisher_->GetQueueFullCount() << std::endl;
+
             return rc;
         }
 
+        ResponseCode PubSub::RunBenchmark() {
+            std::cout << std::endl << "******************************Entering Benchmark**************************"
+                      << std::endl;
+            mqtt::QoS qos = (0 == ConfigCommon::benchmark_qos_) ? mqtt::QoS::QOS0 : mqtt::QoS::QOS1;
+            std::shared_ptr<BackpressurePublisher> p_publisher = p_publisher_;
+            PubSubBenchmark::PublishFunction publish =
+                [p_publisher, qos](const TopicHandle &topic, PayloadArena::Slot *p_slot) {
+                    uint16_t packet_id = 0;
+                    return p_publisher->Publish(topic, qos, p_slot, packet_id, ConfigCommon::mqtt_command_timeout_);
+                };
+
+            ResponseCode rc = p_benchmark_->Run(publish, ConfigCommon::mqtt_command_timeout_);
+            if (!p_publisher_->WaitForAcks(ConfigCommon::mqtt_command_timeout_)) {
+                AWS_LOG_WARN(LOG_TAG_PUBSUB, "%u publishes still unacknowledged",
+                             (unsigned int) p_publisher_->GetInFlightCount());
+            }
+            if (!p_benchmark_->WaitForMessages(ConfigCommon::mqtt_command_timeout_)) {
+                AWS_LOG_WARN(LOG_TAG_PUBSUB, "Not every benchmark message was received");
+            }
+            p_benchmark_->PrintReport();
+            std::cout << "Publish window : " << p_publisher_->GetWindow()
+                      << ", queue full : " << p_publisher_->GetQueueFullCount() << std::endl;
+            return rc;
+        }
+
+        ResponseCode PubSub::RunScalingBenchmark(const util::Vector<std::pair<size_t, size_t>> &payload_sizes,
+                                                 size_t max_window) {
+            std::cout << std::endl << "**************************Entering Scaling Benchmark**********************"
+                      << std::endl;
+            mqtt::QoS qos = (0 == ConfigCommon::benchmark_qos_) ? mqtt::QoS::QOS0 : mqtt::QoS::QOS1;
+            std::chrono::milliseconds queue_full_backoff(1000 / std::max(ConfigCommon::action_processing_rate_hz_,
+                                                                         (uint32_t) 1));
+            ShardedPublisher::ConnectionFactory create_connection =
+                [this](std::shared_ptr<NetworkConnection> &p_connection_out) {
+                    return CreateNetworkConnection(p_connection_out);
+                };
+            mqtt::Subscription::ApplicationCallbackHandlerPtr p_sub_handler = std::bind(&PubSub::SubscribeCallback,
+                                                                                        this,
+                                                                                        std::placeholders::_1,
+                                                                                        std::placeholders::_2,
+                                                                                        std::placeholders::_3);
+
+            // 1, 2, 4, ... connections, ending with the configured maximum
+            util::Vector<size_t> connection_counts;
+            for (size_t connection_count = 1; connection_count < ConfigCommon::benchmark_max_connections_;
+                 connection_count *= 2) {
+                connection_counts.push_back(connection_count);
+            }
+            connection_counts.push_back(ConfigCommon::benchmark_max_connections_);
+
+            ResponseCode rc = ResponseCode::SUCCESS;
+            util::Vector<std::pair<size_t, PubSubBenchmark::Summary>> summaries;
+            for (size_t connection_count : connection_counts) {
+                // Every shard gets a full window, the arena has to cover all of them
+                p_benchmark_ = std::unique_ptr<PubSubBenchmark>(
+                    new PubSubBenchmark(SDK_BENCHMARK_TOPIC_PREFIX, ConfigCommon::benchmark_message_count_,
+                                        payload_sizes, ConfigCommon::benchmark_topic_count_,
+                                        ConfigCommon::benchmark_target_rate_, max_window * connection_count));
+                ShardedPublisher sharded_publisher(create_connection, max_window, queue_full_backoff);
+
+                util::String client_id_prefix = ConfigCommon::base_client_id_;
+                client_id_prefix.append("_pub_sub_tester_");
+                client_id_prefix.append(std::to_string(rand()));
+                client_id_prefix.append("_");
+                rc = sharded_publisher.Connect(connection_count, client_id_prefix);
+                if (ResponseCode::SUCCESS != rc) {
+                    AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Connecting %u shards failed. %s", (unsigned int) connection_count,
+                                  ResponseHelper::ToString(rc).c_str());
+                    break;
+                }
+
+                rc = sharded_publisher.Subscribe(p_benchmark_->GetTopics(), qos, p_sub_handler);
+                if (ResponseCode::SUCCESS != rc) {
+                    AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Subscribe failed. %s", ResponseHelper::ToString(rc).c_str());
+                    break;
+                }
+
+                PubSubBenchmark::PublishFunction publish =
+                    [&sharded_publisher, qos](const TopicHandle &topic, PayloadArena::Slot *p_slot) {
+                        uint16_t packet_id = 0;
+                        return sharded_publisher.Publish(topic, qos, p_slot, packet_id,
+                                                         ConfigCommon::mqtt_command_timeout_);
+                    };
+                rc = p_benchmark_->Run(publish, ConfigCommon::mqtt_command_timeout_);
+                if (!sharded_publisher.WaitForAcks(ConfigCommon::mqtt_command_timeout_)) {
+                    AWS_LOG_WARN(LOG_TAG_PUBSUB, "%u publishes still unacknowledged",
+                                 (unsigned int) sharded_publisher.GetInFlightCount());
+                }
+                if (!p_benchmark_->WaitForMessages(ConfigCommon::mqtt_command_timeout_)) {
+                    AWS_LOG_WARN(LOG_TAG_PUBSUB, "Not every benchmark message was received");
+                }
+                p_benchmark_->PrintReport();
+                std::cout << "Connections : " << sharded_publisher.GetShardCount()
+                          << ", acknowledged : " << sharded_publisher.GetAckedCount()
+                          << ", failed : " << sharded_publisher.GetFailedCount()
+                          << ", queue full : " << sharded_publisher.GetQueueFullCount() << std::endl;
+                summaries.push_back(std::make_pair(connection_count, p_benchmark_->GetSummary()));
+                sharded_publisher.Disconnect();
+                if (ResponseCode::SUCCESS != rc) {
+                    AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Benchmark failed. %s", ResponseHelper::ToString(rc).c_str());
+                    break;
+                }
+            }
+            p_benchmark_.reset();
+
+            std::cout << std::endl << "**************************Scaling Benchmark Results***********************"
+                      << std::endl;
+            std::cout << "Connections\tmsgs/sec\tbytes/sec\tp50 usec\tp99 usec" << std::endl;
+            for (const std::pair<size_t, PubSubBenchmark::Summary> &summary : summaries) {
+                std::cout << summary.first << "\t\t" << summary.second.receive_rate
+                          << "\t\t" << summary.second.receive_byte_rate
+                          << "\t\t" << summary.second.p50_latency_usecs
+                          << "\t\t" << summary.second.p99_latency_usecs << std::endl;
+            }
+            return rc;
+        }
+
+        ResponseCode PubSub::ParseCipherProfiles(const util::String &profiles,
+                                                 util::Vector<CipherProfile> &profiles_out) {
+            profiles_out.clear();
+            size_t entry_start = 0;
+            while (entry_start <= profiles.length()) {
+                size_t entry_end = profiles.find(';', entry_start);
+                if (util::String::npos == entry_end) {
+                    entry_end = profiles.length();
+                }
+                util::String entry = profiles.substr(entry_start, entry_end - entry_start);
+                entry_start = entry_end + 1;
+                if (entry.empty()) {
+                    continue;
+                }
+
+                // "cipher list|ciphersuites|groups", missing or empty fields keep the library default
+                util::Vector<util::String> fields;
+                size_t field_start = 0;
+                while (field_start <= entry.length()) {
+                    size_t field_end = entry.find('|', field_start);
+                    if (util::String::npos == field_end) {
+                        field_end = entry.length();
+                    }
+                    fields.push_back(entry.substr(field_start, field_end - field_start));
+                    field_start = field_end + 1;
+                }
+                if (3 < fields.size()) {
+                    AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Malformed cipher profile \"%s\"", entry.c_str());
+                    profiles_out.clear();
+                    return ResponseCode::FAILURE;
+                }
+                fields.resize(3);
+
+                CipherProfile profile;
+                profile.cipher_list = fields[0];
+                profile.ciphersuites = fields[1];
+                profile.groups = fields[2];
+                profiles_out.push_back(profile);
+            }
+            if (profiles_out.empty()) {
+                AWS_LOG_ERROR(LOG_TAG_PUBSUB, "No cipher profile in \"%s\"", profiles.c_str());
+                return ResponseCode::FAILURE;
+            }
+            return ResponseCode::SUCCESS;
+        }
+
+        ResponseCode PubSub::RunCipherBenchmark(const util::Vector<std::pair<size_t, size_t>> &payload_sizes,
+                                                size_t max_window) {
+#if defined USE_WEBSOCKETS || defined USE_MBEDTLS || defined USE_IO_URING
+            AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Cipher profiles are only supported by the OpenSSL transport");
+            return ResponseCode::FAILURE;
+#else
+            util::Vector<CipherProfile> profiles;
+            ResponseCode rc = ParseCipherProfiles(ConfigCommon::benchmark_cipher_profiles_, profiles);
+            if (ResponseCode::SUCCESS != rc) {
+                return rc;
+            }
+
+            std::cout << std::endl << "**************************Entering Cipher Benchmark***********************"
+                      << std::endl;
+            mqtt::QoS qos = (0 == ConfigCommon::benchmark_qos_) ? mqtt::QoS::QOS0 : mqtt::QoS::QOS1;
+            std::chrono::milliseconds queue_full_backoff(1000 / std::max(ConfigCommon::action_processing_rate_hz_,
+                                                                         (uint32_t) 1));
+            mqtt::Subscription::ApplicationCallbackHandlerPtr p_sub_handler = std::bind(&PubSub::SubscribeCallback,
+                                                                                        this,
+                                                                                        std::placeholders::_1,
+                                                                                        std::placeholders::_2,
+                                                                                        std::placeholders::_3);
+
+            struct CipherResult {
+                util::String negotiated_cipher;     // Empty if the handshake failed
+                uint64_t handshake_usecs;
+                PubSubBenchmark::Summary summary;
+                double cpu_usecs_per_message;       // Process wide, includes the client's own threads
+            };
+            util::Vector<CipherResult> results;
+            for (const CipherProfile &profile : profiles) {
+                std::cout << std::endl << "Cipher list : \"" << profile.cipher_list << "\", ciphersuites : \""
+                          << profile.ciphersuites << "\", groups : \"" << profile.groups << "\"" << std::endl;
+                p_benchmark_ = std::unique_ptr<PubSubBenchmark>(
+                    new PubSubBenchmark(SDK_BENCHMARK_TOPIC_PREFIX, ConfigCommon::benchmark_message_count_,
+                                        payload_sizes, ConfigCommon::benchmark_topic_count_,
+                                        ConfigCommon::benchmark_target_rate_, max_window));
+
+                // The profile replaces the configured preferences, they are applied when the handshake starts
+                std::shared_ptr<network::OpenSSLConnection> p_openssl_connection;
+                ShardedPublisher::ConnectionFactory create_connection =
+                    [this, &profile, &p_openssl_connection](std::shared_ptr<NetworkConnection> &p_connection_out) {
+                        ResponseCode create_rc = CreateNetworkConnection(p_connection_out);
+                        if (ResponseCode::SUCCESS == create_rc) {
+                            p_openssl_connection =
+                                std::dynamic_pointer_cast<network::OpenSSLConnection>(p_connection_out);
+                            p_openssl_connection->SetCipherPreferences(profile.cipher_list, profile.ciphersuites,
+                                                                       profile.groups);
+                        }
+                        return create_rc;
+                    };
+                ShardedPublisher sharded_publisher(create_connection, max_window, queue_full_backoff);
+
+                util::String client_id_prefix = ConfigCommon::base_client_id_;
+                client_id_prefix.append("_pub_sub_tester_");
+                client_id_prefix.append(std::to_string(rand()));
+                client_id_prefix.append("_");
+                CipherResult result = CipherResult();
+                rc = sharded_publisher.Connect(1, client_id_prefix);
+                if (ResponseCode::SUCCESS != rc) {
+                    // The broker may not offer this profile, carry on with the next one
+                    AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Connecting with the cipher profile failed. %s",
+                                  ResponseHelper::ToString(rc).c_str());
+                    results.push_back(result);
+                    rc = ResponseCode::SUCCESS;
+                    continue;
+                }
+                result.negotiated_cipher = p_openssl_connection->GetNegotiatedCipher();
+                result.handshake_usecs =
+                    static_cast<uint64_t>(p_openssl_connection->GetLastHandshakeDuration().count());
+
+                rc = sharded_publisher.Subscribe(p_benchmark_->GetTopics(), qos, p_sub_handler);
+                if (ResponseCode::SUCCESS != rc) {
+                    AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Subscribe failed. %s", ResponseHelper::ToString(rc).c_str());
+                    break;
+                }
+
+                PubSubBenchmark::PublishFunction publish =
+                    [&sharded_publisher, qos](const TopicHandle &topic, PayloadArena::Slot *p_slot) {
+                        uint16_t packet_id = 0;
+                        return sharded_publisher.Publish(topic, qos, p_slot, packet_id,
+                                                         ConfigCommon::mqtt_command_timeout_);
+                    };
+                std::clock_t cpu_start = std::clock();
+                rc = p_benchmark_->Run(publish, ConfigCommon::mqtt_command_timeout_);
+                if (!sharded_publisher.WaitForAcks(ConfigCommon::mqtt_command_timeout_)) {
+                    AWS_LOG_WARN(LOG_TAG_PUBSUB, "%u publishes still unacknowledged",
+                                 (unsigned int) sharded_publisher.GetInFlightCount());
+                }
+                if (!p_benchmark_->WaitForMessages(ConfigCommon::mqtt_command_timeout_)) {
+                    AWS_LOG_WARN(LOG_TAG_PUBSUB, "Not every benchmark message was received");
+                }
+                double cpu_usecs = 1000000.0 * (std::clock() - cpu_start) / CLOCKS_PER_SEC;
+                p_benchmark_->PrintReport();
+
+                result.summary = p_benchmark_->GetSummary();
+                result.cpu_usecs_per_message = cpu_usecs / std::max(result.summary.received_count, (size_t) 1);
+                std::cout << "Negotiated : " << result.negotiated_cipher << ", handshake : "
+                          << result.handshake_usecs << " usec, CPU : " << result.cpu_usecs_per_message
+                          << " usec/msg" << std::endl;
+                results.push_back(result);
+                sharded_publisher.Disconnect();
+                if (ResponseCode::SUCCESS != rc) {
+                    AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Benchmark failed. %s", ResponseHelper::ToString(rc).c_str());
+                    break;
+                }
+            }
+            p_benchmark_.reset();
+
+            std::cout << std::endl << "**************************Cipher Benchmark Results************************"
+                      << std::endl;
+            std::cout << "Profile\tNegotiated\tHandshake usec\tmsgs/sec\tbytes/sec\tCPU usec/msg" << std::endl;
+            for (size_t itr = 0; itr < results.size(); itr++) {
+                std::cout << (itr + 1) << "\t";
+                if (results[itr].negotiated_cipher.empty()) {
+                    std::cout << "handshake failed" << std::endl;
+                    continue;
+                }
+                std::cout << results[itr].negotiated_cipher
+                          << "\t" << results[itr].handshake_usecs
+                          << "\t\t" << results[itr].summary.receive_rate
+                          << "\t\t" << results[itr].summary.receive_byte_rate
+                          << "\t\t" << results[itr].cpu_usecs_per_message << std::endl;
+            }
+            return rc;
+#endif
+        }
+
         ResponseCode PubSub::SubscribeCallback(util::String topic_name,
                                                util::String payload,
                                                std::shared_ptr<mqtt::SubscriptionHandlerContextData> p_app_handler_data) {
+            if (nullptr != p_benchmark_ && p_benchmark_->OnMessage(payload)) {
+                return ResponseCode::SUCCESS;
+            }
             std::cout << std::endl << "************" << std::endl;
             std::cout << "Received message on topic : " << topic_name << std::endl;
             std::cout << "Payload Length : " << payload.length();
@@ -93,7 +409,11 @@ namespace awsiotsdk {
                 std::cout << "Payload : " << payload << std::endl;
             }
             std::cout << std::endl << "************" << std::endl;
-            cur_pending_messages_--;
+            {
+                std::lock_guard<std::mutex> pending_guard(pending_messages_mutex_);
+                cur_pending_messages_--;
+            }
+            pending_messages_cv_.notify_all();
             return ResponseCode::SUCCESS;
         }
 
@@ -121,10 +441,14 @@ namespace awsiotsdk {
                 mqtt::Subscription::Create(std::move(p_topic_name), mqtt::QoS::QOS0, p_sub_handler, nullptr);
             util::Vector<std::shared_ptr<mqtt::Subscription>> topic_vector;
             topic_vector.push_back(p_subscription);
+            if (nullptr != p_benchmark_) {
+                mqtt::QoS qos = (0 == ConfigCommon::benchmark_qos_) ? mqtt::QoS::QOS0 : mqtt::QoS::QOS1;
+                topic_vector.push_back(mqtt::Subscription::Create(Utf8String::Create(p_benchmark_->GetTopicFilter()),
+                                                                  qos, p_sub_handler, nullptr));
+            }
 
-            ResponseCode rc = p_iot_client_->Subscribe(topic_vector, ConfigCommon::mqtt_command_timeout_);
-            std::this_thread::sleep_for(std::chrono::seconds(3));
-            return rc;
+            // Returns once the SUBACK arrived, messages published after this are delivered
+            return p_iot_client_->Subscribe(topic_vector, ConfigCommon::mqtt_command_timeout_);
         }
 
         ResponseCode PubSub::Unsubscribe() {
@@ -132,17 +456,36 @@ namespace awsiotsdk {
             std::unique_ptr<Utf8String> p_topic_name = Utf8String::Create(p_topic_name_str);
             util::Vector<std::unique_ptr<Utf8String>> topic_vector;
             topic_vector.push_back(std::move(p_topic_name));
+            if (nullptr != p_benchmark_) {
+                topic_vector.push_back(Utf8String::Create(p_benchmark_->GetTopicFilter()));
+            }
+
+            // Returns once the UNSUBACK arrived
+            return p_iot_client_->Unsubscribe(std::move(topic_vector), ConfigCommon::mqtt_command_timeout_);
+        }
 
-            ResponseCode rc = p_iot_client_->Unsubscribe(std::move(topic_vector), ConfigCommon::mqtt_command_timeout_);
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+        ResponseCode PubSub::UnsubscribeWithRetry() {
+            ResponseCode rc;
+            do {
+                rc = Unsubscribe();
+                if (ResponseCode::ACTION_QUEUE_FULL == rc) {
+                    // The client drains one action per processing period
+                    std::cout << "Message queue full on Unsub, waiting!!!" << std::endl;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(
+                        1000 / std::max(ConfigCommon::action_processing_rate_hz_, (uint32_t) 1)));
+                }
+            } while (ResponseCode::ACTION_QUEUE_FULL == rc);
+            if (ResponseCode::SUCCESS != rc) {
+                AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Unsubscribe failed. %s", ResponseHelper::ToString(rc).c_str());
+            }
             return rc;
         }
 
-        ResponseCode PubSub::InitializeTLS() {
+        ResponseCode PubSub::CreateNetworkConnection(std::shared_ptr<NetworkConnection> &p_connection_out) {
             ResponseCode rc = ResponseCode::SUCCESS;
 
 #ifdef USE_WEBSOCKETS
-            p_network_connection_ = std::shared_ptr<NetworkConnection>(
+            p_connection_out = std::shared_ptr<NetworkConnection>(
                 new network::WebSocketConnection(ConfigCommon::endpoint_, ConfigCommon::endpoint_https_port_,
                                                  ConfigCommon::root_ca_path_, ConfigCommon::aws_region_,
                                                  ConfigCommon::aws_access_key_id_,
@@ -151,26 +494,46 @@ namespace awsiotsdk {
                                                  ConfigCommon::tls_handshake_timeout_,
                                                  ConfigCommon::tls_read_timeout_,
                                                  ConfigCommon::tls_write_timeout_, true));
-            if (nullptr == p_network_connection_) {
+            if (nullptr == p_connection_out) {
                 AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Failed to initialize Network Connection. %s",
                               ResponseHelper::ToString(rc).c_str());
                 rc = ResponseCode::FAILURE;
             }
 #elif defined USE_MBEDTLS
-            p_network_connection_ = std::make_shared<network::MbedTLSConnection>(ConfigCommon::endpoint_,
-                                                                                 ConfigCommon::endpoint_mqtt_port_,
-                                                                                 ConfigCommon::root_ca_path_,
-                                                                                 ConfigCommon::client_cert_path_,
-                                                                                 ConfigCommon::client_key_path_,
-                                                                                 ConfigCommon::tls_handshake_timeout_,
-                                                                                 ConfigCommon::tls_read_timeout_,
-                                                                                 ConfigCommon::tls_write_timeout_,
-                                                                                 true);
-            if (nullptr == p_network_connection_) {
+            p_connection_out = std::make_shared<network::MbedTLSConnection>(ConfigCommon::endpoint_,
+                                                                            ConfigCommon::endpoint_mqtt_port_,
+                                                                            ConfigCommon::root_ca_path_,
+                                                                            ConfigCommon::client_cert_path_,
+                                                                            ConfigCommon::client_key_path_,
+                                                                            ConfigCommon::tls_handshake_timeout_,
+                                                                            ConfigCommon::tls_read_timeout_,
+                                                                            ConfigCommon::tls_write_timeout_,
+                                                                            true);
+            if (nullptr == p_connection_out) {
                 AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Failed to initialize Network Connection. %s",
                               ResponseHelper::ToString(rc).c_str());
                 rc = ResponseCode::FAILURE;
             }
+#elif defined USE_IO_URING
+            std::shared_ptr<network::IoUringConnection> p_network_connection =
+                std::make_shared<network::IoUringConnection>(ConfigCommon::endpoint_,
+                                                             ConfigCommon::endpoint_mqtt_port_,
+                                                             ConfigCommon::root_ca_path_,
+                                                             ConfigCommon::client_cert_path_,
+                                                             ConfigCommon::client_key_path_,
+                                                             ConfigCommon::tls_handshake_timeout_,
+                                                             ConfigCommon::tls_read_timeout_,
+                                                             ConfigCommon::tls_write_timeout_, true);
+            rc = p_network_connection->Initialize();
+
+            if (ResponseCode::SUCCESS != rc) {
+                AWS_LOG_ERROR(LOG_TAG_PUBSUB,
+                              "Failed to initialize Network Connection. %s",
+                              ResponseHelper::ToString(rc).c_str());
+                rc = ResponseCode::FAILURE;
+            } else {
+                p_connection_out = std::dynamic_pointer_cast<NetworkConnection>(p_network_connection);
+            }
 #else
             std::shared_ptr<network::OpenSSLConnection> p_network_connection =
                 std::make_shared<network::OpenSSLConnection>(ConfigCommon::endpoint_,
@@ -181,7 +544,52 @@ namespace awsiotsdk {
                                                              ConfigCommon::tls_handshake_timeout_,
                                                              ConfigCommon::tls_read_timeout_,
                                                              ConfigCommon::tls_write_timeout_, true);
-            rc = p_network_connection->Initialize();
+            p_network_connection->SetCipherPreferences(ConfigCommon::tls_cipher_list_,
+                                                       ConfigCommon::tls_ciphersuites_, ConfigCommon::tls_groups_);
+            p_network_connection->SetEarlyDataEnabled(ConfigCommon::tls_early_data_replay_safe_);
+            p_network_connection->SetStatsDumpInterval(ConfigCommon::tls_stats_dump_interval_);
+            network::OpenSSLSocketTuning::Profile socket_profile;
+            rc = network::OpenSSLSocketTuning::ParseProfile(ConfigCommon::tcp_socket_profile_, socket_profile);
+            if (ResponseCode::SUCCESS == rc) {
+                p_network_connection->SetSocketProfile(socket_profile);
+                rc = p_network_connection->Initialize();
+            }
+
+            // The pools are created with the first connection and shared by every connection made after it, so the
+            // handshake worker bound and the probing cover all of them
+            if (ResponseCode::SUCCESS == rc && 0 < ConfigCommon::tls_handshake_workers_) {
+                if (nullptr == p_handshake_pool_) {
+                    // Reconnects are spread over the reconnect intervals the MQTT client backs off with
+                    p_handshake_pool_ =
+                        std::make_shared<network::OpenSSLHandshakePool>(ConfigCommon::tls_handshake_workers_,
+                                                                        ConfigCommon::tls_handshake_queue_length_,
+                                                                        ConfigCommon::minimum_reconnect_interval_,
+                                                                        ConfigCommon::maximum_reconnect_interval_);
+                }
+                p_network_connection->SetHandshakePool(p_handshake_pool_);
+            }
+
+            if (ResponseCode::SUCCESS == rc && !ConfigCommon::failover_endpoints_.empty()) {
+                if (nullptr == p_endpoint_pool_) {
+                    // The configured endpoint is tried first until the probes find a faster one
+                    std::shared_ptr<network::OpenSSLEndpointPool> p_endpoint_pool =
+                        std::make_shared<network::OpenSSLEndpointPool>(ConfigCommon::root_ca_path_,
+                                                                       ConfigCommon::client_cert_path_,
+                                                                       ConfigCommon::client_key_path_,
+                                                                       ConfigCommon::tls_handshake_timeout_);
+                    p_endpoint_pool->AddEndpoint(ConfigCommon::endpoint_, ConfigCommon::endpoint_mqtt_port_);
+                    rc = p_endpoint_pool->AddEndpoints(ConfigCommon::failover_endpoints_,
+                                                       ConfigCommon::endpoint_mqtt_port_);
+                    if (ResponseCode::SUCCESS == rc) {
+                        p_endpoint_pool->ProbeAll();
+                        p_endpoint_pool->StartProbing(ConfigCommon::endpoint_probe_interval_);
+                        p_endpoint_pool_ = p_endpoint_pool;
+                    }
+                }
+                if (ResponseCode::SUCCESS == rc) {
+                    p_network_connection->SetEndpointPool(p_endpoint_pool_);
+                }
+            }
 
             if (ResponseCode::SUCCESS != rc) {
                 AWS_LOG_ERROR(LOG_TAG_PUBSUB,
@@ -189,16 +597,51 @@ namespace awsiotsdk {
                               ResponseHelper::ToString(rc).c_str());
                 rc = ResponseCode::FAILURE;
             } else {
-                p_network_connection_ = std::dynamic_pointer_cast<NetworkConnection>(p_network_connection);
+                p_connection_out = std::dynamic_pointer_cast<NetworkConnection>(p_network_connection);
             }
 #endif
             return rc;
         }
 
+        ResponseCode PubSub::InitializeTLS() {
+            return CreateNetworkConnection(p_network_connection_);
+        }
+
         ResponseCode PubSub::RunSample() {
             total_published_messages_ = 0;
             cur_pending_messages_ = 0;
 
+            // Keep no more publishes unacknowledged than the action queue can hold and wait for PUBACKs, not a fixed
+            // sleep, when the window is full
+            size_t max_window = std::min(ConfigCommon::max_pending_acks_,
+                                         ConfigCommon::maximum_outgoing_action_queue_length_);
+            p_payload_arena_ = std::make_shared<PayloadArena>(max_window, SDK_SAMPLE_PAYLOAD_LENGTH);
+            p_sample_topic_ = TopicHandle::Create(SDK_SAMPLE_TOPIC);
+            if (nullptr == p_sample_topic_) {
+                return ResponseCode::FAILURE;
+            }
+
+            if (0 < ConfigCommon::benchmark_message_count_) {
+                util::Vector<std::pair<size_t, size_t>> payload_sizes;
+                ResponseCode rc = PubSubBenchmark::ParsePayloadSizes(ConfigCommon::benchmark_payload_sizes_,
+                                                                     payload_sizes);
+                if (ResponseCode::SUCCESS != rc) {
+                    return rc;
+                }
+                if (!ConfigCommon::benchmark_cipher_profiles_.empty()) {
+                    // Opens a connection per profile instead of the single sample connection
+                    return RunCipherBenchmark(payload_sizes, max_window);
+                }
+                if (1 < ConfigCommon::benchmark_max_connections_) {
+                    // Opens its own sharded connections instead of the single sample connection
+                    return RunScalingBenchmark(payload_sizes, max_window);
+                }
+                p_benchmark_ = std::unique_ptr<PubSubBenchmark>(
+                    new PubSubBenchmark(SDK_BENCHMARK_TOPIC_PREFIX, ConfigCommon::benchmark_message_count_,
+                                        payload_sizes, ConfigCommon::benchmark_topic_count_,
+                                        ConfigCommon::benchmark_target_rate_, max_window));
+            }
+
             ResponseCode rc = InitializeTLS();
             if (ResponseCode::SUCCESS != rc) {
                 return rc;
@@ -229,9 +672,19 @@ namespace awsiotsdk {
                 return rc;
             }
 
+            std::chrono::milliseconds queue_full_backoff(1000 / std::max(ConfigCommon::action_processing_rate_hz_,
+                                                                         (uint32_t) 1));
+            p_publisher_ = std::make_shared<BackpressurePublisher>(p_iot_client_, max_window, queue_full_backoff);
+
             rc = Subscribe();
             if (ResponseCode::SUCCESS != rc) {
                 AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Subscribe failed. %s", ResponseHelper::ToString(rc).c_str());
+            } else if (nullptr != p_benchmark_) {
+                rc = RunBenchmark();
+                if (ResponseCode::SUCCESS != rc) {
+                    AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Benchmark failed. %s", ResponseHelper::ToString(rc).c_str());
+                }
+                UnsubscribeWithRetry();
             } else {
                 // Test with delay between each action being queued up
                 rc = RunPublish(MESSAGE_COUNT);
@@ -244,35 +697,26 @@ namespace awsiotsdk {
 
                 std::cout << ResponseHelper::ToString(rc) << std::endl;
                 if (ResponseCode::SUCCESS == rc) {
-                    //Sleep for 10 seconds and wait for all messages to be received
-                    int cur_sleep_sec_count = 0;
-                    do {
-                        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                        if (0 == cur_pending_messages_) {
-                            break;
-                        }
-                        cur_sleep_sec_count++;
-                        std::cout << "Waiting!!! " << cur_sleep_sec_count << std::endl;
-                    } while (cur_sleep_sec_count < 100);
-                }
-
-                do {
-                    rc = Unsubscribe();
-                    if (ResponseCode::ACTION_QUEUE_FULL == rc) {
-                        std::cout << "Message queue full on Unsub, waiting!!!" << std::endl;
-                        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+                    // Wait up to 10 seconds, SubscribeCallback wakes us up as soon as the last message arrived
+                    std::unique_lock<std::mutex> pending_lock(pending_messages_mutex_);
+                    if (!pending_messages_cv_.wait_for(pending_lock,
+                                                       std::chrono::seconds(SDK_SAMPLE_RECEIVE_TIMEOUT_SECS),
+                                                       [this] { return 0 >= cur_pending_messages_; })) {
+                        std::cout << "Timed out waiting for " << cur_pending_messages_ << " messages" << std::endl;
                     }
-                } while (ResponseCode::ACTION_QUEUE_FULL == rc);
-                if (ResponseCode::SUCCESS != rc) {
-                    AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Unsubscribe failed. %s",
-                                  ResponseHelper::ToString(rc).c_str());
                 }
+
+                UnsubscribeWithRetry();
             }
 
             rc = p_iot_client_->Disconnect(ConfigCommon::mqtt_command_timeout_);
             if (ResponseCode::SUCCESS != rc) {
                 AWS_LOG_ERROR(LOG_TAG_PUBSUB, "Disconnect failed. %s", ResponseHelper::ToString(rc).c_str());
             }
+            // Acknowledgement handlers still queued in the client point into the publisher, the arena and the
+            // benchmark. Leave the publisher holding the last reference, it destroys the client before itself.
+            p_iot_client_.reset();
+            p_publisher_.reset();
 
             std::cout << std::endl << "*************************Results**************************" << std::endl;
             std::cout << "Pending published messages : " << cur_pending_messages_ << std::endl;
@@ -312,6 +756,10 @@ int main(int argc, char **argv) {
         pub_sub = std::unique_ptr<awsiotsdk::samples::PubSub>(new awsiotsdk::samples::PubSub());
 
     awsiotsdk::ResponseCode rc = awsiotsdk::ConfigCommon::InitializeCommon("config/SampleConfig.json");
+    if (awsiotsdk::ResponseCode::SUCCESS == rc) {
+        // e.g. --benchmark_message_count=100000 --benchmark_payload_sizes=64,1024-4096
+        rc = awsiotsdk::ConfigCommon::ApplyCommandLine(argc, argv);
+    }
     if (awsiotsdk::ResponseCode::SUCCESS == rc) {
         rc = pub_sub->RunSample();
     }
@@ -22,20 +22,52 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <mutex>
+
 #include "mqtt/Client.hpp"
 #include "NetworkConnection.hpp"
+#include "BackpressurePublisher.hpp"
+#include "PubSubBenchmark.hpp"
+#include "ShardedPublisher.hpp"
 
 namespace awsiotsdk {
+    namespace network {
+        class OpenSSLHandshakePool;
+        class OpenSSLEndpointPool;
+    }
+
     namespace samples {
         class PubSub {
         protected:
+            struct CipherProfile {
+                util::String cipher_list;
+                util::String ciphersuites;
+                util::String groups;
+            };
+
             std::shared_ptr<NetworkConnection> p_network_connection_;
+            std::shared_ptr<network::OpenSSLHandshakePool> p_handshake_pool_;
+            std::shared_ptr<network::OpenSSLEndpointPool> p_endpoint_pool_;
             std::shared_ptr<mqtt::ConnectPacket> p_connect_packet_;
             std::atomic_int cur_pending_messages_;
+            std::mutex pending_messages_mutex_;
+            std::condition_variable pending_messages_cv_;
             std::atomic_int total_published_messages_;
             std::shared_ptr<MqttClient> p_iot_client_;
+            std::shared_ptr<BackpressurePublisher> p_publisher_;
+            std::shared_ptr<PayloadArena> p_payload_arena_;
+            std::shared_ptr<TopicHandle> p_sample_topic_;
+            std::unique_ptr<PubSubBenchmark> p_benchmark_;
 
             ResponseCode RunPublish(int msg_count);
+            ResponseCode RunBenchmark();
+            ResponseCode RunScalingBenchmark(const util::Vector<std::pair<size_t, size_t>> &payload_sizes,
+                                             size_t max_window);
+            static ResponseCode ParseCipherProfiles(const util::String &profiles,
+                                                    util::Vector<CipherProfile> &profiles_out);
+            ResponseCode RunCipherBenchmark(const util::Vector<std::pair<size_t, size_t>> &payload_sizes,
+                                            size_t max_window);
             ResponseCode SubscribeCallback(util::String topic_name,
                                            util::String payload,
                                            std::shared_ptr<mqtt::SubscriptionHandlerContextData> p_app_handler_data);
@@ -43,6 +75,8 @@ namespace awsiotsdk {
                                             std::shared_ptr<DisconnectCallbackContextData> p_app_handler_data);
             ResponseCode Subscribe();
             ResponseCode Unsubscribe();
+            ResponseCode UnsubscribeWithRetry();
+            ResponseCode CreateNetworkConnection(std::shared_ptr<NetworkConnection> &p_connection_out);
             ResponseCode InitializeTLS();
 
         public:
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file AllocationCounter.cpp
+ * @brief
+ *
+ */
+
+#include "AllocationCounter.hpp"
+
+#ifdef COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> allocation_count(0);
+
+static void *CountedAllocate(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return malloc(0 == size ? 1 : size);
+}
+
+void *operator new(size_t size) {
+    void *p_memory = CountedAllocate(size);
+    if (nullptr == p_memory) {
+        throw std::bad_alloc();
+    }
+    return p_memory;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return CountedAllocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return CountedAllocate(size);
+}
+
+void operator delete(void *p_memory) noexcept {
+    free(p_memory);
+}
+
+void operator delete[](void *p_memory) noexcept {
+    free(p_memory);
+}
+
+void operator delete(void *p_memory, size_t) noexcept {
+    free(p_memory);
+}
+
+void operator delete[](void *p_memory, size_t) noexcept {
+    free(p_memory);
+}
+
+void operator delete(void *p_memory, const std::nothrow_t &) noexcept {
+    free(p_memory);
+}
+
+void operator delete[](void *p_memory, const std::nothrow_t &) noexcept {
+    free(p_memory);
+}
+
+#endif
+
+namespace awsiotsdk {
+    namespace samples {
+        bool AllocationCounter::IsEnabled() {
+#ifdef COUNT_ALLOCATIONS
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        uint64_t AllocationCounter::GetCount() {
+#ifdef COUNT_ALLOCATIONS
+            return allocation_count.load(std::memory_order_relaxed);
+#else
+            return 0;
+#endif
+        }
+    }
+}
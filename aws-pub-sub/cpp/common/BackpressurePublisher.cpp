@@ -0,0 +1,187 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file BackpressurePublisher.cpp
+ * @brief
+ *
+ */
+
+#include <algorithm>
+
+#include "util/logging/LogMacros.hpp"
+#include "BackpressurePublisher.hpp"
+
+#define LOG_TAG_BACKPRESSURE_PUBLISHER "[Sample - Backpressure Publisher]"
+
+namespace awsiotsdk {
+    namespace samples {
+        BackpressurePublisher::BackpressurePublisher(std::shared_ptr<MqttClient> p_client, size_t max_window,
+                                                     std::chrono::milliseconds queue_full_backoff) {
+            p_client_ = p_client;
+            max_window_ = std::max((size_t) 1, max_window);
+            queue_full_backoff_ = queue_full_backoff;
+            // Start small and find the broker's pace through slow start
+            window_ = 1;
+            slow_start_threshold_ = max_window_;
+            ack_credit_ = 0;
+            in_flight_ = 0;
+            acked_count_ = 0;
+            failed_count_ = 0;
+            queue_full_count_ = 0;
+        }
+
+        BackpressurePublisher::~BackpressurePublisher() {
+            // Pending acknowledgement handlers call OnAck(), if this was the last reference the client goes away
+            // while every member is still intact
+            p_client_.reset();
+        }
+
+        void BackpressurePublisher::ShrinkWindowLocked() {
+            slow_start_threshold_ = std::max((size_t) 1, window_ / 2);
+            window_ = slow_start_threshold_;
+            ack_credit_ = 0;
+        }
+
+        void BackpressurePublisher::OnAck(uint16_t packet_id, ResponseCode rc) {
+            std::lock_guard<std::mutex> window_guard(window_mutex_);
+            if (0 < in_flight_) {
+                in_flight_--;
+            }
+            if (ResponseCode::SUCCESS == rc) {
+                acked_count_++;
+                if (window_ < slow_start_threshold_) {
+                    window_++;
+                } else if (++ack_credit_ >= window_) {
+                    ack_credit_ = 0;
+                    window_++;
+                }
+                window_ = std::min(window_, max_window_);
+            } else {
+                failed_count_++;
+                ShrinkWindowLocked();
+                AWS_LOG_WARN(LOG_TAG_BACKPRESSURE_PUBLISHER, "Publish %u failed, window shrunk to %u. %s",
+                             (unsigned int) packet_id, (unsigned int) window_, ResponseHelper::ToString(rc).c_str());
+            }
+            window_cv_.notify_all();
+        }
+
+        ResponseCode BackpressurePublisher::Publish(const util::String &topic_name, mqtt::QoS qos,
+                                                    const util::String &payload, uint16_t &packet_id_out,
+                                                    std::chrono::milliseconds timeout) {
+            ActionData::AsyncAckNotificationHandlerPtr p_ack_handler = nullptr;
+            if (mqtt::QoS::QOS0 != qos) {
+                // Captures fit std::function's inline storage, copies of the handler don't allocate
+                p_ack_handler = [this](uint16_t packet_id, ResponseCode rc) { OnAck(packet_id, rc); };
+            }
+            return PublishInternal(topic_name, qos, payload, p_ack_handler, packet_id_out, timeout);
+        }
+
+        ResponseCode BackpressurePublisher::Publish(const TopicHandle &topic, mqtt::QoS qos,
+                                                    PayloadArena::Slot *p_slot, uint16_t &packet_id_out,
+                                                    std::chrono::milliseconds timeout) {
+            ActionData::AsyncAckNotificationHandlerPtr p_ack_handler = nullptr;
+            if (mqtt::QoS::QOS0 != qos) {
+                p_ack_handler = [this, p_slot](uint16_t packet_id, ResponseCode rc) {
+                    OnAck(packet_id, rc);
+                    p_slot->p_arena->Release(p_slot);
+                };
+            }
+            ResponseCode rc = PublishInternal(topic.GetName(), qos, p_slot->payload, p_ack_handler, packet_id_out,
+                                              timeout);
+            // The client copies the payload, only a pending acknowledgement still needs the slot
+            if (ResponseCode::SUCCESS != rc || mqtt::QoS::QOS0 == qos) {
+                p_slot->p_arena->Release(p_slot);
+            }
+            return rc;
+        }
+
+        ResponseCode BackpressurePublisher::PublishInternal(
+            const util::String &topic_name, mqtt::QoS qos, const util::String &payload,
+            const ActionData::AsyncAckNotificationHandlerPtr &p_ack_handler, uint16_t &packet_id_out,
+            std::chrono::milliseconds timeout) {
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+            bool is_acknowledged = (mqtt::QoS::QOS0 != qos);
+
+            std::unique_lock<std::mutex> window_lock(window_mutex_);
+            for (;;) {
+                if (is_acknowledged) {
+                    while (in_flight_ >= window_) {
+                        if (std::cv_status::timeout == window_cv_.wait_until(window_lock, deadline) &&
+                            in_flight_ >= window_) {
+                            return ResponseCode::ACTION_QUEUE_FULL;
+                        }
+                    }
+                    // Counted before queueing, the acknowledgement may arrive before PublishAsync returns
+                    in_flight_++;
+                }
+                window_lock.unlock();
+
+                ResponseCode rc = p_client_->PublishAsync(Utf8String::Create(topic_name), false, false, qos, payload,
+                                                          p_ack_handler, packet_id_out);
+
+                window_lock.lock();
+                if (ResponseCode::SUCCESS == rc) {
+                    return rc;
+                }
+                if (is_acknowledged) {
+                    in_flight_--;
+                }
+                if (ResponseCode::ACTION_QUEUE_FULL != rc) {
+                    return rc;
+                }
+
+                // Other actions filled the queue, back off and retry once something completed
+                queue_full_count_++;
+                ShrinkWindowLocked();
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if (now >= deadline) {
+                    return rc;
+                }
+                window_cv_.wait_until(window_lock, std::min(deadline, now + queue_full_backoff_));
+            }
+        }
+
+        bool BackpressurePublisher::WaitForAcks(std::chrono::milliseconds timeout) {
+            std::unique_lock<std::mutex> window_lock(window_mutex_);
+            return window_cv_.wait_for(window_lock, timeout, [this] { return 0 == in_flight_; });
+        }
+
+        size_t BackpressurePublisher::GetWindow() {
+            std::lock_guard<std::mutex> window_guard(window_mutex_);
+            return window_;
+        }
+
+        size_t BackpressurePublisher::GetInFlightCount() {
+            std::lock_guard<std::mutex> window_guard(window_mutex_);
+            return in_flight_;
+        }
+
+        uint64_t BackpressurePublisher::GetAckedCount() {
+            std::lock_guard<std::mutex> window_guard(window_mutex_);
+            return acked_count_;
+        }
+
+        uint64_t BackpressurePublisher::GetFailedCount() {
+            std::lock_guard<std::mutex> window_guard(window_mutex_);
+            return failed_count_;
+        }
+
+        uint64_t BackpressurePublisher::GetQueueFullCount() {
+            std::lock_guard<std::mutex> window_guard(window_mutex_);
+            return queue_full_count_;
+        }
+    }
+}
@@ -29,6 +29,8 @@
 #define MAX_PATH_LENGTH_ PATH_MAX
 #endif
 
+#include <cstdlib>
+
 #include "util/logging/LogMacros.hpp"
 #include "ConfigCommon.hpp"
 
@@ -40,6 +42,10 @@
 #define SDK_CONFIG_ENDPOINT_MQTT_PORT_KEY "mqtt_port"
 #define SDK_CONFIG_ENDPOINT_HTTPS_PORT_KEY "https_port"
 #define SDK_CONFIG_ENDPOINT_GREENGRASS_DISCOVERY_PORT_KEY "greengrass_discovery_port"
+// Optional, comma separated "host" or "host:port" entries tried when the endpoint is slower or unreachable
+#define SDK_CONFIG_FAILOVER_ENDPOINTS_KEY "failover_endpoints"
+// Optional, defaults to 0 which only probes the endpoints once at startup
+#define SDK_CONFIG_ENDPOINT_PROBE_INTERVAL_SECS_KEY "endpoint_probe_interval_secs"
 
 // TLS Settings
 #define SDK_CONFIG_ROOT_CA_RELATIVE_KEY "root_ca_relative_path"
@@ -48,6 +54,20 @@
 #define SDK_CONFIG_TLS_HANDSHAKE_TIMEOUT_MSECS_KEY "tls_handshake_timeout_msecs"
 #define SDK_CONFIG_TLS_READ_TIMEOUT_MSECS_KEY "tls_read_timeout_msecs"
 #define SDK_CONFIG_TLS_WRITE_TIMEOUT_MSECS_KEY "tls_write_timeout_msecs"
+// Optional, an empty or missing value keeps the OpenSSL default
+#define SDK_CONFIG_TLS_CIPHER_LIST_KEY "tls_cipher_list"
+#define SDK_CONFIG_TLS_CIPHERSUITES_KEY "tls_ciphersuites"
+#define SDK_CONFIG_TLS_GROUPS_KEY "tls_groups"
+// Optional, defaults to false. Only set if the first messages after connecting are safe to be replayed
+#define SDK_CONFIG_TLS_EARLY_DATA_REPLAY_SAFE_KEY "tls_early_data_replay_safe"
+// Optional, defaults to 0 which disables the periodic statistics log
+#define SDK_CONFIG_TLS_STATS_DUMP_INTERVAL_SECS_KEY "tls_stats_dump_interval_secs"
+// Optional, "low_latency", "bulk_throughput", "low_power" or "system_default" (the default)
+#define SDK_CONFIG_TCP_SOCKET_PROFILE_KEY "tcp_socket_profile"
+// Optional, defaults to 0 which runs every handshake on the connecting thread
+#define SDK_CONFIG_TLS_HANDSHAKE_WORKERS_KEY "tls_handshake_workers"
+// Optional, handshakes allowed to wait for a handshake worker, defaults to 64
+#define SDK_CONFIG_TLS_HANDSHAKE_QUEUE_LENGTH_KEY "tls_handshake_queue_length"
 
 // Websocket settings
 #define SDK_CONFIG_AWS_REGION_KEY "aws_region"
@@ -72,6 +92,22 @@
 // Discovery settings
 #define DISCOVER_ACTION_TIMEOUT_MSECS_KEY "discover_action_timeout_msecs"
 
+// Benchmark settings, all optional
+// Messages to publish, defaults to 0 which runs the regular sample instead of the benchmark
+#define SDK_CONFIG_BENCHMARK_MESSAGE_COUNT_KEY "benchmark_message_count"
+// Comma separated payload sizes in bytes picked with equal probability, "min-max" entries pick uniformly in between
+#define SDK_CONFIG_BENCHMARK_PAYLOAD_SIZES_KEY "benchmark_payload_sizes"
+// 0 or 1, defaults to 1
+#define SDK_CONFIG_BENCHMARK_QOS_KEY "benchmark_qos"
+// Topics the messages are spread over round robin, defaults to 1
+#define SDK_CONFIG_BENCHMARK_TOPIC_COUNT_KEY "benchmark_topic_count"
+// Messages per second, defaults to 0 which publishes as fast as the broker acknowledges
+#define SDK_CONFIG_BENCHMARK_TARGET_RATE_KEY "benchmark_target_rate"
+// Above 1, repeats the benchmark over 1, 2, 4, ... up to this many sharded connections, defaults to 1
+#define SDK_CONFIG_BENCHMARK_MAX_CONNECTIONS_KEY "benchmark_max_connections"
+// ";" separated "cipher list|ciphersuites|groups" profiles the benchmark is repeated with, defaults to "" for none
+#define SDK_CONFIG_BENCHMARK_CIPHER_PROFILES_KEY "benchmark_cipher_profiles"
+
 // Intel System Studio defines
 // define this to override getting the settings from the config file
 #define ISS_PROJECT
@@ -82,12 +118,22 @@
 #define ENDPOINT_MQTT_PORT_ISS 8883
 #define HTTPS_PORT_ISS 443
 #define GREENGRASS_DISCOVERY_PORT_ISS 8443
+#define FAILOVER_ENDPOINTS_ISS ""
+#define ENDPOINT_PROBE_INTERVAL_SECS_ISS 0
 #define ROOT_CA_RELATIVE_PATH_ISS "certs/rootCA.crt"
 #define DEVICE_CERTIFICATE_RELATIVE_PATH_ISS "certs/cert.pem"
 #define DEVICE_PRIVATE_KEY_RELATIVE_PATH_ISS "certs/privkey.pem"
 #define TLS_HANDSHAKE_TIMEOUT_MSECS_ISS 60000
 #define TLS_READ_TIMEOUT_MSECS_ISS 2000
 #define TLS_WRITE_TIMEOUT_MSECS_ISS 2000
+#define TLS_CIPHER_LIST_ISS ""
+#define TLS_CIPHERSUITES_ISS ""
+#define TLS_GROUPS_ISS ""
+#define TLS_EARLY_DATA_REPLAY_SAFE_ISS false
+#define TLS_STATS_DUMP_INTERVAL_SECS_ISS 0
+#define TCP_SOCKET_PROFILE_ISS "system_default"
+#define TLS_HANDSHAKE_WORKERS_ISS 0
+#define TLS_HANDSHAKE_QUEUE_LENGTH_ISS 64
 #define AWS_REGION_ISS ""
 #define AWS_ACCESS_KEY_ID_ISS ""
 #define AWS_SECRET_ACCESS_KEY_ISS ""
@@ -103,6 +149,13 @@
 #define ACTION_PROCESSING_RATE_HZ_ISS 5
 #define MAXIMUM_OUTGOING_ACTION_QUEUE_LENGTH_ISS 32
 #define DISCOVER_ACTION_TIMEOUT_MSECS_ISS 300000
+#define BENCHMARK_MESSAGE_COUNT_ISS 0
+#define BENCHMARK_PAYLOAD_SIZES_ISS "64"
+#define BENCHMARK_QOS_ISS 1
+#define BENCHMARK_TOPIC_COUNT_ISS 1
+#define BENCHMARK_TARGET_RATE_ISS 0
+#define BENCHMARK_MAX_CONNECTIONS_ISS 1
+#define BENCHMARK_CIPHER_PROFILES_ISS ""
 
 #endif
 
@@ -123,6 +176,13 @@ namespace awsiotsdk {
     util::String ConfigCommon::aws_access_key_id_;
     util::String ConfigCommon::aws_secret_access_key_;
     util::String ConfigCommon::aws_session_token_;
+    util::String ConfigCommon::tls_cipher_list_;
+    util::String ConfigCommon::tls_ciphersuites_;
+    util::String ConfigCommon::tls_groups_;
+    util::String ConfigCommon::failover_endpoints_;
+    util::String ConfigCommon::tcp_socket_profile_;
+    util::String ConfigCommon::benchmark_payload_sizes_;
+    util::String ConfigCommon::benchmark_cipher_profiles_;
 
     std::chrono::milliseconds ConfigCommon::mqtt_command_timeout_;
     std::chrono::milliseconds ConfigCommon::tls_handshake_timeout_;
@@ -130,13 +190,23 @@ namespace awsiotsdk {
     std::chrono::milliseconds ConfigCommon::tls_write_timeout_;
     std::chrono::milliseconds ConfigCommon::discover_action_timeout_;
     std::chrono::seconds ConfigCommon::keep_alive_timeout_secs_;
+    std::chrono::seconds ConfigCommon::tls_stats_dump_interval_;
+    std::chrono::seconds ConfigCommon::endpoint_probe_interval_;
 
     bool ConfigCommon::is_clean_session_;
+    bool ConfigCommon::tls_early_data_replay_safe_;
     std::chrono::seconds ConfigCommon::minimum_reconnect_interval_;
     std::chrono::seconds ConfigCommon::maximum_reconnect_interval_;
     size_t ConfigCommon::max_pending_acks_;
     size_t ConfigCommon::maximum_outgoing_action_queue_length_;
+    size_t ConfigCommon::tls_handshake_workers_;
+    size_t ConfigCommon::tls_handshake_queue_length_;
     uint32_t ConfigCommon::action_processing_rate_hz_;
+    size_t ConfigCommon::benchmark_message_count_;
+    size_t ConfigCommon::benchmark_topic_count_;
+    uint32_t ConfigCommon::benchmark_qos_;
+    uint32_t ConfigCommon::benchmark_target_rate_;
+    size_t ConfigCommon::benchmark_max_connections_;
 
     util::String ConfigCommon::GetCurrentPath() {
         util::String current_working_directory;
@@ -160,9 +230,19 @@ namespace awsiotsdk {
     endpoint_mqtt_port_ = ENDPOINT_MQTT_PORT_ISS;
     endpoint_https_port_=  HTTPS_PORT_ISS;
     endpoint_greengrass_discovery_port_=  GREENGRASS_DISCOVERY_PORT_ISS;
+    failover_endpoints_ = FAILOVER_ENDPOINTS_ISS;
+    endpoint_probe_interval_ = std::chrono::seconds(ENDPOINT_PROBE_INTERVAL_SECS_ISS);
     tls_handshake_timeout_ = std::chrono::milliseconds(TLS_HANDSHAKE_TIMEOUT_MSECS_ISS);
     tls_read_timeout_ = std::chrono::milliseconds(TLS_READ_TIMEOUT_MSECS_ISS);
     tls_write_timeout_ = std::chrono::milliseconds(TLS_WRITE_TIMEOUT_MSECS_ISS);
+    tls_cipher_list_ = TLS_CIPHER_LIST_ISS;
+    tls_ciphersuites_ = TLS_CIPHERSUITES_ISS;
+    tls_groups_ = TLS_GROUPS_ISS;
+    tls_early_data_replay_safe_ = TLS_EARLY_DATA_REPLAY_SAFE_ISS;
+    tls_stats_dump_interval_ = std::chrono::seconds(TLS_STATS_DUMP_INTERVAL_SECS_ISS);
+    tcp_socket_profile_ = TCP_SOCKET_PROFILE_ISS;
+    tls_handshake_workers_ = TLS_HANDSHAKE_WORKERS_ISS;
+    tls_handshake_queue_length_ = TLS_HANDSHAKE_QUEUE_LENGTH_ISS;
     aws_region_=  AWS_REGION_ISS;
     aws_access_key_id_=  AWS_ACCESS_KEY_ID_ISS;
     aws_secret_access_key_=  AWS_SECRET_ACCESS_KEY_ISS;
@@ -178,6 +258,13 @@ namespace awsiotsdk {
     action_processing_rate_hz_=  ACTION_PROCESSING_RATE_HZ_ISS;
     maximum_outgoing_action_queue_length_=  MAXIMUM_OUTGOING_ACTION_QUEUE_LENGTH_ISS;
     discover_action_timeout_ = std::chrono::milliseconds(DISCOVER_ACTION_TIMEOUT_MSECS_ISS);
+    benchmark_message_count_ = BENCHMARK_MESSAGE_COUNT_ISS;
+    benchmark_payload_sizes_ = BENCHMARK_PAYLOAD_SIZES_ISS;
+    benchmark_qos_ = BENCHMARK_QOS_ISS;
+    benchmark_topic_count_ = BENCHMARK_TOPIC_COUNT_ISS;
+    benchmark_target_rate_ = BENCHMARK_TARGET_RATE_ISS;
+    benchmark_max_connections_ = BENCHMARK_MAX_CONNECTIONS_ISS;
+    benchmark_cipher_profiles_ = BENCHMARK_CIPHER_PROFILES_ISS;
 
     return ResponseCode::SUCCESS;
 #else
@@ -241,6 +328,19 @@ namespace awsiotsdk {
             return rc;
         }
 
+        // Failover is optional, without it the sample only ever connects to the endpoint
+        if (ResponseCode::SUCCESS !=
+            util::JsonParser::GetStringValue(sdk_config_json_, SDK_CONFIG_FAILOVER_ENDPOINTS_KEY, failover_endpoints_)) {
+            failover_endpoints_.clear();
+        }
+        uint32_t probe_interval_secs = 0;
+        if (ResponseCode::SUCCESS != util::JsonParser::GetUint32Value(sdk_config_json_,
+                                                                      SDK_CONFIG_ENDPOINT_PROBE_INTERVAL_SECS_KEY,
+                                                                      probe_interval_secs)) {
+            probe_interval_secs = 0;
+        }
+        endpoint_probe_interval_ = std::chrono::seconds(probe_interval_secs);
+
         rc = util::JsonParser::GetStringValue(sdk_config_json_, SDK_CONFIG_ROOT_CA_RELATIVE_KEY, temp_str);
         if (ResponseCode::SUCCESS != rc) {
             AWS_LOG_ERROR(LOG_TAG_SAMPLE_CONFIG_COMMON,
@@ -388,6 +488,46 @@ namespace awsiotsdk {
         }
         tls_write_timeout_ = std::chrono::milliseconds(temp);
 
+        // Cipher preferences are optional, configs written before they existed keep working
+        if (ResponseCode::SUCCESS !=
+            util::JsonParser::GetStringValue(sdk_config_json_, SDK_CONFIG_TLS_CIPHER_LIST_KEY, tls_cipher_list_)) {
+            tls_cipher_list_.clear();
+        }
+        if (ResponseCode::SUCCESS !=
+            util::JsonParser::GetStringValue(sdk_config_json_, SDK_CONFIG_TLS_CIPHERSUITES_KEY, tls_ciphersuites_)) {
+            tls_ciphersuites_.clear();
+        }
+        if (ResponseCode::SUCCESS !=
+            util::JsonParser::GetStringValue(sdk_config_json_, SDK_CONFIG_TLS_GROUPS_KEY, tls_groups_)) {
+            tls_groups_.clear();
+        }
+        if (ResponseCode::SUCCESS != util::JsonParser::GetBoolValue(sdk_config_json_,
+                                                                    SDK_CONFIG_TLS_EARLY_DATA_REPLAY_SAFE_KEY,
+                                                                    tls_early_data_replay_safe_)) {
+            tls_early_data_replay_safe_ = false;
+        }
+        if (ResponseCode::SUCCESS == util::JsonParser::GetUint32Value(sdk_config_json_,
+                                                                      SDK_CONFIG_TLS_STATS_DUMP_INTERVAL_SECS_KEY,
+                                                                      temp)) {
+            tls_stats_dump_interval_ = std::chrono::seconds(temp);
+        } else {
+            tls_stats_dump_interval_ = std::chrono::seconds(0);
+        }
+        if (ResponseCode::SUCCESS !=
+            util::JsonParser::GetStringValue(sdk_config_json_, SDK_CONFIG_TCP_SOCKET_PROFILE_KEY, tcp_socket_profile_)) {
+            tcp_socket_profile_.clear();
+        }
+        if (ResponseCode::SUCCESS != util::JsonParser::GetSizeTValue(sdk_config_json_,
+                                                                     SDK_CONFIG_TLS_HANDSHAKE_WORKERS_KEY,
+                                                                     tls_handshake_workers_)) {
+            tls_handshake_workers_ = 0;
+        }
+        if (ResponseCode::SUCCESS != util::JsonParser::GetSizeTValue(sdk_config_json_,
+                                                                     SDK_CONFIG_TLS_HANDSHAKE_QUEUE_LENGTH_KEY,
+                                                                     tls_handshake_queue_length_)) {
+            tls_handshake_queue_length_ = 64;
+        }
+
         rc = util::JsonParser::GetUint32Value(sdk_config_json_, SDK_CONFIG_KEEPALIVE_INTERVAL_SECS_KEY, temp);
         if (ResponseCode::SUCCESS != rc) {
             AWS_LOG_ERROR(LOG_TAG_SAMPLE_CONFIG_COMMON,
@@ -475,7 +615,83 @@ namespace awsiotsdk {
         }
         discover_action_timeout_ = std::chrono::milliseconds(temp);
 
+        // The benchmark is optional, without a message count the regular sample runs
+        if (ResponseCode::SUCCESS != util::JsonParser::GetSizeTValue(sdk_config_json_,
+                                                                     SDK_CONFIG_BENCHMARK_MESSAGE_COUNT_KEY,
+                                                                     benchmark_message_count_)) {
+            benchmark_message_count_ = 0;
+        }
+        if (ResponseCode::SUCCESS != util::JsonParser::GetStringValue(sdk_config_json_,
+                                                                      SDK_CONFIG_BENCHMARK_PAYLOAD_SIZES_KEY,
+                                                                      benchmark_payload_sizes_)) {
+            benchmark_payload_sizes_ = "64";
+        }
+        if (ResponseCode::SUCCESS != util::JsonParser::GetUint32Value(sdk_config_json_,
+                                                                      SDK_CONFIG_BENCHMARK_QOS_KEY,
+                                                                      benchmark_qos_)) {
+            benchmark_qos_ = 1;
+        }
+        if (ResponseCode::SUCCESS != util::JsonParser::GetSizeTValue(sdk_config_json_,
+                                                                     SDK_CONFIG_BENCHMARK_TOPIC_COUNT_KEY,
+                                                                     benchmark_topic_count_)) {
+            benchmark_topic_count_ = 1;
+        }
+        if (ResponseCode::SUCCESS != util::JsonParser::GetUint32Value(sdk_config_json_,
+                                                                      SDK_CONFIG_BENCHMARK_TARGET_RATE_KEY,
+                                                                      benchmark_target_rate_)) {
+            benchmark_target_rate_ = 0;
+        }
+        if (ResponseCode::SUCCESS != util::JsonParser::GetSizeTValue(sdk_config_json_,
+                                                                     SDK_CONFIG_BENCHMARK_MAX_CONNECTIONS_KEY,
+                                                                     benchmark_max_connections_)) {
+            benchmark_max_connections_ = 1;
+        }
+        if (ResponseCode::SUCCESS != util::JsonParser::GetStringValue(sdk_config_json_,
+                                                                      SDK_CONFIG_BENCHMARK_CIPHER_PROFILES_KEY,
+                                                                      benchmark_cipher_profiles_)) {
+            benchmark_cipher_profiles_.clear();
+        }
+
         return rc;
 #endif
     }
+
+    ResponseCode ConfigCommon::ApplyCommandLine(int argc, char **argv) {
+        for (int i = 1; i < argc; i++) {
+            util::String arg = argv[i];
+            size_t equals_pos = arg.find('=');
+            if (0 != arg.compare(0, 2, "--") || util::String::npos == equals_pos) {
+                AWS_LOG_ERROR(LOG_TAG_SAMPLE_CONFIG_COMMON, "Expected --key=value, got %s", arg.c_str());
+                return ResponseCode::FAILURE;
+            }
+            util::String key = arg.substr(2, equals_pos - 2);
+            util::String value = arg.substr(equals_pos + 1);
+            char *p_end = nullptr;
+            unsigned long long number = strtoull(value.c_str(), &p_end, 10);
+            bool is_number = !value.empty() && '\0' == *p_end;
+
+            if (SDK_CONFIG_BENCHMARK_PAYLOAD_SIZES_KEY == key) {
+                benchmark_payload_sizes_ = value;
+            } else if (SDK_CONFIG_BENCHMARK_CIPHER_PROFILES_KEY == key) {
+                benchmark_cipher_profiles_ = value;
+            } else if (!is_number) {
+                AWS_LOG_ERROR(LOG_TAG_SAMPLE_CONFIG_COMMON, "%s is not a number", arg.c_str());
+                return ResponseCode::FAILURE;
+            } else if (SDK_CONFIG_BENCHMARK_MESSAGE_COUNT_KEY == key) {
+                benchmark_message_count_ = static_cast<size_t>(number);
+            } else if (SDK_CONFIG_BENCHMARK_QOS_KEY == key) {
+                benchmark_qos_ = static_cast<uint32_t>(number);
+            } else if (SDK_CONFIG_BENCHMARK_TOPIC_COUNT_KEY == key) {
+                benchmark_topic_count_ = static_cast<size_t>(number);
+            } else if (SDK_CONFIG_BENCHMARK_TARGET_RATE_KEY == key) {
+                benchmark_target_rate_ = static_cast<uint32_t>(number);
+            } else if (SDK_CONFIG_BENCHMARK_MAX_CONNECTIONS_KEY == key) {
+                benchmark_max_connections_ = static_cast<size_t>(number);
+            } else {
+                AWS_LOG_ERROR(LOG_TAG_SAMPLE_CONFIG_COMMON, "Unknown option %s", arg.c_str());
+                return ResponseCode::FAILURE;
+            }
+        }
+        return ResponseCode::SUCCESS;
+    }
 }
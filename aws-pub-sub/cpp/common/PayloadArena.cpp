@@ -0,0 +1,63 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file PayloadArena.cpp
+ * @brief
+ *
+ */
+
+#include <algorithm>
+
+#include "PayloadArena.hpp"
+
+namespace awsiotsdk {
+    namespace samples {
+        PayloadArena::PayloadArena(size_t slot_count, size_t slot_size) {
+            slots_.resize(std::max((size_t) 1, slot_count));
+            free_slots_.reserve(slots_.size());
+            for (size_t itr = 0; itr < slots_.size(); itr++) {
+                slots_[itr].payload.reserve(slot_size);
+                slots_[itr].p_arena = this;
+                free_slots_.push_back(&slots_[itr]);
+            }
+        }
+
+        PayloadArena::Slot *PayloadArena::Acquire(std::chrono::milliseconds timeout) {
+            std::unique_lock<std::mutex> arena_lock(arena_mutex_);
+            if (!released_cv_.wait_for(arena_lock, timeout, [this] { return !free_slots_.empty(); })) {
+                return nullptr;
+            }
+            Slot *p_slot = free_slots_.back();
+            free_slots_.pop_back();
+            p_slot->payload.clear();
+            return p_slot;
+        }
+
+        void PayloadArena::Release(Slot *p_slot) {
+            if (nullptr == p_slot) {
+                return;
+            }
+            std::lock_guard<std::mutex> arena_guard(arena_mutex_);
+            free_slots_.push_back(p_slot);
+            released_cv_.notify_one();
+        }
+
+        size_t PayloadArena::GetFreeCount() {
+            std::lock_guard<std::mutex> arena_guard(arena_mutex_);
+            return free_slots_.size();
+        }
+    }
+}
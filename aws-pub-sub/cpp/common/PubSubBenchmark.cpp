@@ -0,0 +1,305 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file PubSubBenchmark.cpp
+ * @brief
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "util/logging/LogMacros.hpp"
+#include "AllocationCounter.hpp"
+#include "PubSubBenchmark.hpp"
+
+#define LOG_TAG_PUBSUB_BENCHMARK "[Sample - PubSub Benchmark]"
+
+// Room for "<sequence number> <send time in ns> "
+#define PUBSUB_BENCHMARK_MAX_HEADER_LENGTH 64
+
+namespace awsiotsdk {
+    namespace samples {
+        // Sized from the largest payload up front so no slot ever grows
+        static size_t GetMaxPayloadSize(const util::Vector<std::pair<size_t, size_t>> &payload_sizes) {
+            size_t max_size = PUBSUB_BENCHMARK_MAX_HEADER_LENGTH;
+            for (const std::pair<size_t, size_t> &range : payload_sizes) {
+                max_size = std::max(max_size, range.second);
+            }
+            return max_size;
+        }
+
+        PubSubBenchmark::PubSubBenchmark(const util::String &topic_prefix, size_t message_count,
+                                         const util::Vector<std::pair<size_t, size_t>> &payload_sizes,
+                                         size_t topic_count, uint32_t target_rate, size_t max_in_flight)
+            : payload_arena_(max_in_flight, GetMaxPayloadSize(payload_sizes)) {
+            message_count_ = message_count;
+            payload_sizes_ = payload_sizes;
+            if (payload_sizes_.empty()) {
+                payload_sizes_.push_back(std::make_pair((size_t) 0, (size_t) 0));
+            }
+            for (size_t itr = 0; itr < std::max((size_t) 1, topic_count); itr++) {
+                util::String topic_name = topic_prefix;
+                topic_name.append("/");
+                topic_name.append(std::to_string(itr));
+                std::shared_ptr<TopicHandle> p_topic = TopicHandle::Create(topic_name);
+                if (nullptr != p_topic) {
+                    topics_.push_back(p_topic);
+                }
+            }
+            topic_filter_ = topic_prefix;
+            topic_filter_.append("/#");
+            target_rate_ = target_rate;
+
+            is_publishing_done_ = false;
+            published_count_ = 0;
+            failed_count_ = 0;
+            received_count_ = 0;
+            duplicate_count_ = 0;
+            published_bytes_ = 0;
+            received_bytes_ = 0;
+            steady_state_count_ = 0;
+            steady_state_allocations_ = 0;
+            is_received_.resize(message_count_, false);
+            latencies_usecs_.reserve(message_count_);
+        }
+
+        ResponseCode PubSubBenchmark::ParsePayloadSizes(const util::String &sizes,
+                                                        util::Vector<std::pair<size_t, size_t>> &sizes_out) {
+            sizes_out.clear();
+            size_t entry_start = 0;
+            while (entry_start <= sizes.length()) {
+                size_t entry_end = sizes.find(',', entry_start);
+                if (util::String::npos == entry_end) {
+                    entry_end = sizes.length();
+                }
+                util::String entry = sizes.substr(entry_start, entry_end - entry_start);
+                entry_start = entry_end + 1;
+
+                char *p_end = nullptr;
+                unsigned long min_size = strtoul(entry.c_str(), &p_end, 10);
+                unsigned long max_size = min_size;
+                if (p_end != entry.c_str() && '-' == *p_end) {
+                    const char *p_max = p_end + 1;
+                    max_size = strtoul(p_max, &p_end, 10);
+                    if (p_end == p_max) {
+                        p_end = nullptr;
+                    }
+                }
+                if (entry.empty() || nullptr == p_end || '\0' != *p_end || max_size < min_size) {
+                    AWS_LOG_ERROR(LOG_TAG_PUBSUB_BENCHMARK, "Malformed payload size \"%s\"", entry.c_str());
+                    sizes_out.clear();
+                    return ResponseCode::FAILURE;
+                }
+                sizes_out.push_back(std::make_pair((size_t) min_size, (size_t) max_size));
+            }
+            return ResponseCode::SUCCESS;
+        }
+
+        util::String PubSubBenchmark::GetTopicFilter() const {
+            return topic_filter_;
+        }
+
+        const util::Vector<std::shared_ptr<TopicHandle>> &PubSubBenchmark::GetTopics() const {
+            return topics_;
+        }
+
+        ResponseCode PubSubBenchmark::Run(const PublishFunction &publish, std::chrono::milliseconds slot_timeout) {
+            if (topics_.empty()) {
+                AWS_LOG_ERROR(LOG_TAG_PUBSUB_BENCHMARK, "No valid benchmark topic");
+                return ResponseCode::FAILURE;
+            }
+            std::uniform_int_distribution<size_t> pick_range(0, payload_sizes_.size() - 1);
+            char header[PUBSUB_BENCHMARK_MAX_HEADER_LENGTH];
+            ResponseCode rc = ResponseCode::SUCCESS;
+            size_t warm_up_count = message_count_ / 10;
+            uint64_t warm_up_allocations = AllocationCounter::GetCount();
+            {
+                std::lock_guard<std::mutex> stats_guard(stats_mutex_);
+                start_time_ = std::chrono::steady_clock::now();
+            }
+
+            for (size_t sequence = 0; sequence < message_count_; sequence++) {
+                if (warm_up_count == sequence) {
+                    warm_up_allocations = AllocationCounter::GetCount();
+                }
+                if (0 < target_rate_) {
+                    std::this_thread::sleep_until(start_time_ + std::chrono::microseconds(
+                        static_cast<uint64_t>(sequence) * 1000000 / target_rate_));
+                }
+
+                const std::pair<size_t, size_t> &range = payload_sizes_[pick_range(size_engine_)];
+                size_t payload_size = std::uniform_int_distribution<size_t>(range.first, range.second)(size_engine_);
+                PayloadArena::Slot *p_slot = payload_arena_.Acquire(slot_timeout);
+                size_t payload_length = 0;
+                if (nullptr == p_slot) {
+                    rc = ResponseCode::ACTION_QUEUE_FULL;
+                } else {
+                    // The latency includes any wait for room in the publish window
+                    long long send_nsecs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count();
+                    int header_length = snprintf(header, sizeof(header), "%lu %lld ",
+                                                 (unsigned long) sequence, send_nsecs);
+                    p_slot->payload.assign(header, static_cast<size_t>(header_length));
+                    if (payload_size > p_slot->payload.length()) {
+                        p_slot->payload.append(payload_size - p_slot->payload.length(), 'x');
+                    }
+                    payload_length = p_slot->payload.length();
+
+                    rc = publish(*topics_[sequence % topics_.size()], p_slot);
+                }
+
+                std::lock_guard<std::mutex> stats_guard(stats_mutex_);
+                if (ResponseCode::SUCCESS == rc) {
+                    published_count_++;
+                    published_bytes_ += payload_length;
+                    if (warm_up_count <= sequence) {
+                        steady_state_count_++;
+                    }
+                } else {
+                    failed_count_++;
+                    if (ResponseCode::ACTION_QUEUE_FULL != rc) {
+                        AWS_LOG_ERROR(LOG_TAG_PUBSUB_BENCHMARK, "Publish %lu failed. %s", (unsigned long) sequence,
+                                      ResponseHelper::ToString(rc).c_str());
+                        break;
+                    }
+                    rc = ResponseCode::SUCCESS;
+                }
+            }
+
+            uint64_t end_allocations = AllocationCounter::GetCount();
+            std::lock_guard<std::mutex> stats_guard(stats_mutex_);
+            steady_state_allocations_ = end_allocations - warm_up_allocations;
+            publish_end_time_ = std::chrono::steady_clock::now();
+            is_publishing_done_ = true;
+            received_cv_.notify_all();
+            return rc;
+        }
+
+        bool PubSubBenchmark::OnMessage(const util::String &payload) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            const char *p_sequence = payload.c_str();
+            char *p_end = nullptr;
+            unsigned long long sequence = strtoull(p_sequence, &p_end, 10);
+            if (p_end == p_sequence || ' ' != *p_end) {
+                return false;
+            }
+            const char *p_send_time = p_end + 1;
+            long long send_nsecs = strtoll(p_send_time, &p_end, 10);
+            if (p_end == p_send_time || ' ' != *p_end) {
+                return false;
+            }
+            long long latency_nsecs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                now.time_since_epoch()).count() - send_nsecs;
+
+            std::lock_guard<std::mutex> stats_guard(stats_mutex_);
+            if (sequence >= message_count_) {
+                return false;
+            }
+            if (is_received_[sequence]) {
+                // QoS1 allows the broker to deliver twice
+                duplicate_count_++;
+                return true;
+            }
+            is_received_[sequence] = true;
+            received_count_++;
+            received_bytes_ += payload.length();
+            last_receive_time_ = now;
+            latencies_usecs_.push_back(static_cast<uint32_t>(std::max(0LL, latency_nsecs / 1000)));
+            if (is_publishing_done_ && received_count_ >= published_count_) {
+                received_cv_.notify_all();
+            }
+            return true;
+        }
+
+        bool PubSubBenchmark::WaitForMessages(std::chrono::milliseconds timeout) {
+            std::unique_lock<std::mutex> stats_lock(stats_mutex_);
+            return received_cv_.wait_for(stats_lock, timeout, [this] {
+                return is_publishing_done_ && received_count_ >= published_count_;
+            });
+        }
+
+        uint32_t PubSubBenchmark::GetPercentileLocked(double fraction) const {
+            if (latencies_usecs_.empty()) {
+                return 0;
+            }
+            size_t rank = static_cast<size_t>(std::ceil(fraction * latencies_usecs_.size()));
+            return latencies_usecs_[std::min(latencies_usecs_.size(), std::max((size_t) 1, rank)) - 1];
+        }
+
+        PubSubBenchmark::Summary PubSubBenchmark::GetSummaryLocked() const {
+            double receive_secs = 0;
+            if (0 < received_count_) {
+                receive_secs = std::chrono::duration<double>(last_receive_time_ - start_time_).count();
+            }
+
+            Summary summary;
+            summary.received_count = received_count_;
+            summary.receive_rate = (0 < receive_secs) ? static_cast<uint64_t>(received_count_ / receive_secs) : 0;
+            summary.receive_byte_rate = (0 < receive_secs) ? static_cast<uint64_t>(received_bytes_ / receive_secs)
+                                                           : 0;
+            summary.p50_latency_usecs = GetPercentileLocked(0.5);
+            summary.p99_latency_usecs = GetPercentileLocked(0.99);
+            return summary;
+        }
+
+        PubSubBenchmark::Summary PubSubBenchmark::GetSummary() {
+            std::lock_guard<std::mutex> stats_guard(stats_mutex_);
+            std::sort(latencies_usecs_.begin(), latencies_usecs_.end());
+            return GetSummaryLocked();
+        }
+
+        void PubSubBenchmark::PrintReport() {
+            std::lock_guard<std::mutex> stats_guard(stats_mutex_);
+            std::sort(latencies_usecs_.begin(), latencies_usecs_.end());
+
+            double publish_secs = std::chrono::duration<double>(publish_end_time_ - start_time_).count();
+            uint64_t publish_rate = (0 < publish_secs) ? static_cast<uint64_t>(published_count_ / publish_secs) : 0;
+            Summary summary = GetSummaryLocked();
+
+            std::cout << std::endl << "*************************Benchmark Results**************************"
+                      << std::endl;
+            std::cout << "Topics : " << topics_.size() << ", target rate : ";
+            if (0 < target_rate_) {
+                std::cout << target_rate_ << " msgs/sec" << std::endl;
+            } else {
+                std::cout << "unthrottled" << std::endl;
+            }
+            std::cout << "Published : " << published_count_ << " msgs, " << published_bytes_ << " bytes in "
+                      << publish_secs << " sec (" << publish_rate << " msgs/sec), failed : " << failed_count_
+                      << std::endl;
+            std::cout << "Received : " << received_count_ << " msgs, " << received_bytes_ << " bytes, lost : "
+                      << (published_count_ - std::min(published_count_, received_count_))
+                      << ", duplicates : " << duplicate_count_ << std::endl;
+            std::cout << "Throughput : " << summary.receive_rate << " msgs/sec, " << summary.receive_byte_rate
+                      << " bytes/sec" << std::endl;
+            std::cout << "Publish to receive latency (usec) p50 : " << summary.p50_latency_usecs
+                      << ", p99 : " << summary.p99_latency_usecs
+                      << ", p999 : " << GetPercentileLocked(0.999)
+                      << ", max : " << GetPercentileLocked(1.0) << std::endl;
+            if (AllocationCounter::IsEnabled() && 0 < steady_state_count_) {
+                std::cout << "Allocations per message after warm up, process wide : "
+                          << static_cast<double>(steady_state_allocations_) / steady_state_count_ << std::endl;
+            } else {
+                std::cout << "Allocations per message : build with COUNT_ALLOCATIONS to count them" << std::endl;
+            }
+        }
+    }
+}
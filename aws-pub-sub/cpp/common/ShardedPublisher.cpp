@@ -0,0 +1,210 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file ShardedPublisher.cpp
+ * @brief
+ *
+ */
+
+#include <algorithm>
+
+#include "util/logging/LogMacros.hpp"
+#include "ConfigCommon.hpp"
+#include "ShardedPublisher.hpp"
+
+#define LOG_TAG_SHARDED_PUBLISHER "[Sample - Sharded Publisher]"
+
+// 64 bit FNV-1a, stable across runs and platforms unlike std::hash
+#define SHARDED_PUBLISHER_FNV_OFFSET_BASIS 14695981039346656037ULL
+#define SHARDED_PUBLISHER_FNV_PRIME 1099511628211ULL
+
+namespace awsiotsdk {
+    namespace samples {
+        ShardedPublisher::ShardedPublisher(const ConnectionFactory &create_connection, size_t max_window,
+                                           std::chrono::milliseconds queue_full_backoff) {
+            create_connection_ = create_connection;
+            max_window_ = max_window;
+            queue_full_backoff_ = queue_full_backoff;
+        }
+
+        ShardedPublisher::~ShardedPublisher() {
+            Disconnect();
+        }
+
+        ResponseCode ShardedPublisher::DisconnectCallback(
+            util::String client_id, std::shared_ptr<DisconnectCallbackContextData> p_app_handler_data) {
+            AWS_LOG_WARN(LOG_TAG_SHARDED_PUBLISHER, "Shard %s disconnected", client_id.c_str());
+            return ResponseCode::SUCCESS;
+        }
+
+        ResponseCode ShardedPublisher::Connect(size_t shard_count, const util::String &client_id_prefix) {
+            ClientCoreState::ApplicationDisconnectCallbackPtr p_disconnect_handler =
+                std::bind(&ShardedPublisher::DisconnectCallback, this, std::placeholders::_1, std::placeholders::_2);
+
+            for (size_t itr = 0; itr < std::max((size_t) 1, shard_count); itr++) {
+                std::shared_ptr<NetworkConnection> p_connection;
+                ResponseCode rc = create_connection_(p_connection);
+                if (ResponseCode::SUCCESS != rc) {
+                    Disconnect();
+                    return rc;
+                }
+
+                Shard shard;
+                shard.p_client = std::shared_ptr<MqttClient>(MqttClient::Create(p_connection,
+                                                                                ConfigCommon::mqtt_command_timeout_,
+                                                                                p_disconnect_handler, nullptr));
+                if (nullptr == shard.p_client) {
+                    Disconnect();
+                    return ResponseCode::FAILURE;
+                }
+
+                util::String client_id = client_id_prefix;
+                client_id.append(std::to_string(itr));
+                rc = shard.p_client->Connect(ConfigCommon::mqtt_command_timeout_, ConfigCommon::is_clean_session_,
+                                             mqtt::Version::MQTT_3_1_1, ConfigCommon::keep_alive_timeout_secs_,
+                                             Utf8String::Create(client_id), nullptr, nullptr, nullptr);
+                if (ResponseCode::MQTT_CONNACK_CONNECTION_ACCEPTED != rc) {
+                    AWS_LOG_ERROR(LOG_TAG_SHARDED_PUBLISHER, "Shard %s failed to connect. %s", client_id.c_str(),
+                                  ResponseHelper::ToString(rc).c_str());
+                    Disconnect();
+                    return rc;
+                }
+                shard.p_publisher = std::make_shared<BackpressurePublisher>(shard.p_client, max_window_,
+                                                                            queue_full_backoff_);
+                shards_.push_back(shard);
+            }
+            return ResponseCode::SUCCESS;
+        }
+
+        ResponseCode ShardedPublisher::Subscribe(const util::Vector<std::shared_ptr<TopicHandle>> &topics,
+                                                 mqtt::QoS qos,
+                                                 const mqtt::Subscription::ApplicationCallbackHandlerPtr &p_handler) {
+            util::Vector<util::Vector<std::shared_ptr<mqtt::Subscription>>> shard_subscriptions(shards_.size());
+            for (const std::shared_ptr<TopicHandle> &p_topic : topics) {
+                shard_subscriptions[GetShardIndex(p_topic->GetName())].push_back(
+                    mqtt::Subscription::Create(Utf8String::Create(p_topic->GetName()), qos, p_handler, nullptr));
+            }
+
+            for (size_t itr = 0; itr < shards_.size(); itr++) {
+                if (shard_subscriptions[itr].empty()) {
+                    continue;
+                }
+                ResponseCode rc = shards_[itr].p_client->Subscribe(shard_subscriptions[itr],
+                                                                   ConfigCommon::mqtt_command_timeout_);
+                if (ResponseCode::SUCCESS != rc) {
+                    AWS_LOG_ERROR(LOG_TAG_SHARDED_PUBLISHER, "Shard %u failed to subscribe. %s", (unsigned int) itr,
+                                  ResponseHelper::ToString(rc).c_str());
+                    return rc;
+                }
+            }
+            return ResponseCode::SUCCESS;
+        }
+
+        ResponseCode ShardedPublisher::Disconnect() {
+            ResponseCode first_rc = ResponseCode::SUCCESS;
+            for (Shard &shard : shards_) {
+                if (!shard.p_client->IsConnected()) {
+                    continue;
+                }
+                ResponseCode rc = shard.p_client->Disconnect(ConfigCommon::mqtt_command_timeout_);
+                if (ResponseCode::SUCCESS != rc && ResponseCode::SUCCESS == first_rc) {
+                    first_rc = rc;
+                }
+            }
+            for (Shard &shard : shards_) {
+                // Acknowledgement handlers still queued in the client point into the publisher and its slots. Drop
+                // this reference so the publisher holds the last one and destroys the client before itself.
+                shard.p_client.reset();
+            }
+            shards_.clear();
+            return first_rc;
+        }
+
+        size_t ShardedPublisher::GetShardIndex(const util::String &key) const {
+            if (shards_.empty()) {
+                return 0;
+            }
+            uint64_t hash = SHARDED_PUBLISHER_FNV_OFFSET_BASIS;
+            for (char key_char : key) {
+                hash ^= static_cast<unsigned char>(key_char);
+                hash *= SHARDED_PUBLISHER_FNV_PRIME;
+            }
+            return static_cast<size_t>(hash % shards_.size());
+        }
+
+        ResponseCode ShardedPublisher::Publish(const TopicHandle &topic, mqtt::QoS qos, PayloadArena::Slot *p_slot,
+                                               uint16_t &packet_id_out, std::chrono::milliseconds timeout) {
+            return Publish(topic.GetName(), topic, qos, p_slot, packet_id_out, timeout);
+        }
+
+        ResponseCode ShardedPublisher::Publish(const util::String &key, const TopicHandle &topic, mqtt::QoS qos,
+                                               PayloadArena::Slot *p_slot, uint16_t &packet_id_out,
+                                               std::chrono::milliseconds timeout) {
+            if (shards_.empty()) {
+                p_slot->p_arena->Release(p_slot);
+                return ResponseCode::FAILURE;
+            }
+            return shards_[GetShardIndex(key)].p_publisher->Publish(topic, qos, p_slot, packet_id_out, timeout);
+        }
+
+        bool ShardedPublisher::WaitForAcks(std::chrono::milliseconds timeout) {
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+            bool is_done = true;
+            for (Shard &shard : shards_) {
+                std::chrono::milliseconds remaining = std::max(std::chrono::milliseconds(0),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()));
+                is_done = shard.p_publisher->WaitForAcks(remaining) && is_done;
+            }
+            return is_done;
+        }
+
+        size_t ShardedPublisher::GetShardCount() const {
+            return shards_.size();
+        }
+
+        size_t ShardedPublisher::GetInFlightCount() {
+            size_t in_flight_count = 0;
+            for (Shard &shard : shards_) {
+                in_flight_count += shard.p_publisher->GetInFlightCount();
+            }
+            return in_flight_count;
+        }
+
+        uint64_t ShardedPublisher::GetAckedCount() {
+            uint64_t acked_count = 0;
+            for (Shard &shard : shards_) {
+                acked_count += shard.p_publisher->GetAckedCount();
+            }
+            return acked_count;
+        }
+
+        uint64_t ShardedPublisher::GetFailedCount() {
+            uint64_t failed_count = 0;
+            for (Shard &shard : shards_) {
+                failed_count += shard.p_publisher->GetFailedCount();
+            }
+            return failed_count;
+        }
+
+        uint64_t ShardedPublisher::GetQueueFullCount() {
+            uint64_t queue_full_count = 0;
+            for (Shard &shard : shards_) {
+                queue_full_count += shard.p_publisher->GetQueueFullCount();
+            }
+            return queue_full_count;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file TopicHandle.cpp
+ * @brief
+ *
+ */
+
+#include "util/logging/LogMacros.hpp"
+#include "mqtt/Client.hpp"
+#include "TopicHandle.hpp"
+
+#define LOG_TAG_TOPIC_HANDLE "[Sample - Topic Handle]"
+
+// MQTT strings carry a 16 bit length
+#define MAX_TOPIC_NAME_LENGTH 65535
+
+namespace awsiotsdk {
+    namespace samples {
+        TopicHandle::TopicHandle(const util::String &topic_name) {
+            topic_name_ = topic_name;
+        }
+
+        std::shared_ptr<TopicHandle> TopicHandle::Create(const util::String &topic_name) {
+            if (topic_name.empty() || MAX_TOPIC_NAME_LENGTH < topic_name.length()) {
+                AWS_LOG_ERROR(LOG_TAG_TOPIC_HANDLE, "Topic name length %u is out of range",
+                              (unsigned int) topic_name.length());
+                return nullptr;
+            }
+            if (util::String::npos != topic_name.find_first_of(util::String("+#\0", 3))) {
+                AWS_LOG_ERROR(LOG_TAG_TOPIC_HANDLE, "Topic name %s contains a wildcard or NUL character",
+                              topic_name.c_str());
+                return nullptr;
+            }
+            // Same UTF-8 check the client applies to every publish
+            if (nullptr == Utf8String::Create(topic_name)) {
+                AWS_LOG_ERROR(LOG_TAG_TOPIC_HANDLE, "Topic name %s is not valid UTF-8", topic_name.c_str());
+                return nullptr;
+            }
+            return std::shared_ptr<TopicHandle>(new TopicHandle(topic_name));
+        }
+    }
+}
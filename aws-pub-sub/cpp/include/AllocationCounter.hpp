@@ -0,0 +1,50 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file AllocationCounter.hpp
+ * @brief Counts heap allocations made through operator new when built with COUNT_ALLOCATIONS
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace awsiotsdk {
+    namespace samples {
+        /**
+         * @brief Process wide count of operator new calls
+         *
+         * Defining COUNT_ALLOCATIONS replaces the global operator new and delete with versions that count every
+         * allocation before forwarding to malloc and free. Without it nothing is replaced and the count stays 0.
+         */
+        class AllocationCounter {
+        public:
+            /**
+             * @brief Check whether allocations are counted
+             *
+             * @return bool - true if built with COUNT_ALLOCATIONS
+             */
+            static bool IsEnabled();
+
+            /**
+             * @brief Get the number of allocations since the process started
+             *
+             * @return uint64_t - operator new calls, all threads included
+             */
+            static uint64_t GetCount();
+        };
+    }
+}
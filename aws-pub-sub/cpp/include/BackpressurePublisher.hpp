@@ -0,0 +1,190 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file BackpressurePublisher.hpp
+ * @brief Defines a publisher that paces itself by the acknowledgements it gets back
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "mqtt/Client.hpp"
+#include "PayloadArena.hpp"
+#include "TopicHandle.hpp"
+
+namespace awsiotsdk {
+    namespace samples {
+        /**
+         * @brief Publishes through PublishAsync while bounding the number of unacknowledged messages
+         *
+         * Every queued QoS1 publish stays unacknowledged at least until the client's action thread has sent it, so
+         * keeping the unacknowledged count below the action queue length keeps the queue from filling up. The limit,
+         * the window, adapts like TCP's congestion window. It grows by one per acknowledgement up to the slow start
+         * threshold, then by one per window of acknowledgements. It halves when the action queue is full anyway or a
+         * publish fails. Callers that hit the window wait for the next acknowledgement instead of sleeping for a
+         * fixed time.
+         *
+         * The acknowledgement handlers refer to the publisher, so it must outlive every publish it made. Call
+         * WaitForAcks() before destroying it. The publisher releases its client first when it is destroyed, so a
+         * client only it still refers to is gone, with its pending handlers, before the publisher is.
+         */
+        class BackpressurePublisher {
+        protected:
+            std::shared_ptr<MqttClient> p_client_;          ///< Client to publish through
+            size_t max_window_;                             ///< Upper bound of the window
+            std::chrono::milliseconds queue_full_backoff_;  ///< Longest wait after ACTION_QUEUE_FULL before retrying
+
+            std::mutex window_mutex_;                       ///< Protects everything below
+            std::condition_variable window_cv_;             ///< Signalled whenever an acknowledgement arrives
+            size_t window_;                                 ///< Unacknowledged publishes currently allowed
+            size_t slow_start_threshold_;                   ///< Window size at which growth turns linear
+            size_t ack_credit_;                             ///< Acknowledgements counted towards the next linear step
+            size_t in_flight_;                              ///< Publishes queued or sent and not acknowledged yet
+            uint64_t acked_count_;                          ///< Publishes acknowledged by the broker
+            uint64_t failed_count_;                         ///< Publishes that failed or timed out waiting for PUBACK
+            uint64_t queue_full_count_;                     ///< Times the client's action queue was full
+
+            /**
+             * @brief Called by the client when a publish is acknowledged or has failed
+             *
+             * @param uint16_t packet_id - packet id of the publish
+             * @param ResponseCode rc - SUCCESS for a PUBACK, the failure otherwise
+             */
+            void OnAck(uint16_t packet_id, ResponseCode rc);
+
+            /**
+             * @brief Halve the window, must be called with the window mutex held
+             */
+            void ShrinkWindowLocked();
+
+            /**
+             * @brief Wait for room in the window and queue the publish
+             *
+             * @param util::String topic_name - topic to publish on
+             * @param mqtt::QoS qos - QoS of the publish
+             * @param util::String payload - message payload
+             * @param ActionData::AsyncAckNotificationHandlerPtr p_ack_handler - handler for QoS1, must call OnAck()
+             * @param uint16_t packet_id_out - reference to store the packet id of the publish
+             * @param std::chrono::milliseconds timeout - longest time to wait for room
+             * @return ResponseCode - see Publish()
+             */
+            ResponseCode PublishInternal(const util::String &topic_name, mqtt::QoS qos, const util::String &payload,
+                                         const ActionData::AsyncAckNotificationHandlerPtr &p_ack_handler,
+                                         uint16_t &packet_id_out, std::chrono::milliseconds timeout);
+
+        public:
+            /**
+             * @brief Constructor
+             *
+             * @param std::shared_ptr<MqttClient> p_client - connected client to publish through
+             * @param size_t max_window - most unacknowledged publishes allowed, e.g. the smaller of
+             * maximum_acks_to_wait_for and the action queue length
+             * @param std::chrono::milliseconds queue_full_backoff - longest wait for an acknowledgement after the
+             * action queue was full, e.g. one action processing period
+             */
+            BackpressurePublisher(std::shared_ptr<MqttClient> p_client, size_t max_window,
+                                  std::chrono::milliseconds queue_full_backoff);
+
+            // Disabling copy constructors
+            BackpressurePublisher(const BackpressurePublisher &) = delete;
+            BackpressurePublisher &operator=(const BackpressurePublisher &) = delete;
+
+            /**
+             * @brief Destructor, releases the client before anything else
+             */
+            ~BackpressurePublisher();
+
+            /**
+             * @brief Publish a message, waiting for room in the window first
+             *
+             * QoS0 publishes are never acknowledged, they only wait while the action queue is full.
+             *
+             * @param util::String topic_name - topic to publish on
+             * @param mqtt::QoS qos - QoS of the publish
+             * @param util::String payload - message payload
+             * @param uint16_t packet_id_out - reference to store the packet id of the publish
+             * @param std::chrono::milliseconds timeout - longest time to wait for room
+             * @return ResponseCode - SUCCESS once queued, ACTION_QUEUE_FULL if there was no room before the timeout,
+             * or the error returned by the client
+             */
+            ResponseCode Publish(const util::String &topic_name, mqtt::QoS qos, const util::String &payload,
+                                 uint16_t &packet_id_out, std::chrono::milliseconds timeout);
+
+            /**
+             * @brief Publish a payload serialized into an arena slot
+             *
+             * Nothing on this side allocates per message. The slot is returned to its arena once the broker
+             * acknowledged the message, right after queueing for QoS0, or at once if the publish fails.
+             *
+             * @param TopicHandle topic - topic to publish on
+             * @param mqtt::QoS qos - QoS of the publish
+             * @param PayloadArena::Slot * p_slot - slot holding the payload, owned by the publish from now on
+             * @param uint16_t packet_id_out - reference to store the packet id of the publish
+             * @param std::chrono::milliseconds timeout - longest time to wait for room
+             * @return ResponseCode - see above
+             */
+            ResponseCode Publish(const TopicHandle &topic, mqtt::QoS qos, PayloadArena::Slot *p_slot,
+                                 uint16_t &packet_id_out, std::chrono::milliseconds timeout);
+
+            /**
+             * @brief Wait until every publish made so far has been acknowledged or has failed
+             *
+             * @param std::chrono::milliseconds timeout - longest time to wait
+             * @return bool - true if nothing is in flight anymore
+             */
+            bool WaitForAcks(std::chrono::milliseconds timeout);
+
+            /**
+             * @brief Get the current window
+             *
+             * @return size_t - unacknowledged publishes currently allowed
+             */
+            size_t GetWindow();
+
+            /**
+             * @brief Get the number of publishes not acknowledged yet
+             *
+             * @return size_t - publishes in flight
+             */
+            size_t GetInFlightCount();
+
+            /**
+             * @brief Get the number of acknowledged publishes
+             *
+             * @return uint64_t - acknowledged publishes
+             */
+            uint64_t GetAckedCount();
+
+            /**
+             * @brief Get the number of publishes that failed after being queued
+             *
+             * @return uint64_t - failed publishes
+             */
+            uint64_t GetFailedCount();
+
+            /**
+             * @brief Get the number of times the client's action queue was full
+             *
+             * @return uint64_t - queue full count
+             */
+            uint64_t GetQueueFullCount();
+        };
+    }
+}
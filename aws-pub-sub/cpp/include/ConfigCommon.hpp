@@ -46,6 +46,13 @@ namespace awsiotsdk {
         static util::String aws_access_key_id_;
         static util::String aws_secret_access_key_;
         static util::String aws_session_token_;
+        static util::String tls_cipher_list_;
+        static util::String tls_ciphersuites_;
+        static util::String tls_groups_;
+        static util::String failover_endpoints_;
+        static util::String tcp_socket_profile_;
+        static util::String benchmark_payload_sizes_;
+        static util::String benchmark_cipher_profiles_;
 
         static std::chrono::milliseconds mqtt_command_timeout_;
         static std::chrono::milliseconds tls_handshake_timeout_;
@@ -53,15 +60,27 @@ namespace awsiotsdk {
         static std::chrono::milliseconds tls_write_timeout_;
         static std::chrono::milliseconds discover_action_timeout_;
         static std::chrono::seconds keep_alive_timeout_secs_;
+        static std::chrono::seconds tls_stats_dump_interval_;
+        static std::chrono::seconds endpoint_probe_interval_;
 
         static bool is_clean_session_;
+        static bool tls_early_data_replay_safe_;
         static std::chrono::seconds minimum_reconnect_interval_;
         static std::chrono::seconds maximum_reconnect_interval_;
         static size_t max_pending_acks_;
         static size_t maximum_outgoing_action_queue_length_;
+        static size_t tls_handshake_workers_;
+        static size_t tls_handshake_queue_length_;
         static uint32_t action_processing_rate_hz_;
+        static size_t benchmark_message_count_;
+        static size_t benchmark_topic_count_;
+        static uint32_t benchmark_qos_;
+        static uint32_t benchmark_target_rate_;
+        static size_t benchmark_max_connections_;
 
         static ResponseCode InitializeCommon(const util::String &config_file_path);
+        // Overrides benchmark settings with --<config key>=<value> arguments
+        static ResponseCode ApplyCommandLine(int argc, char **argv);
         static util::String GetCurrentPath();
     };
 }
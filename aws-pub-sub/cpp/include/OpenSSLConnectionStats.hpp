@@ -0,0 +1,181 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLConnectionStats.hpp
+ * @brief Defines the I/O statistics kept by each OpenSSLConnection
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "util/memory/stl/String.hpp"
+
+// Shards per statistics object, threads are spread across them round robin
+#define OPENSSL_STATS_SHARD_COUNT 4
+// Latency histogram buckets, bucket i counts samples below 2^(i + 1) microseconds, the last one everything above
+#define OPENSSL_STATS_LATENCY_BUCKET_COUNT 24
+
+namespace awsiotsdk {
+    namespace network {
+        /**
+         * @brief I/O counters and latency histograms for a connection
+         *
+         * Cheap enough to stay on in production. Every update is a relaxed atomic add on the calling thread's shard,
+         * so the reading, writing and reactor threads of a connection don't contend on the same cache line. Queries
+         * sum the shards and may observe updates that are still in progress on other threads.
+         */
+        class OpenSSLConnectionStats {
+        public:
+            /**
+             * @brief Event counters
+             */
+            enum class Counter {
+                BYTES_READ = 0,             ///< Plaintext bytes returned by SSL_read
+                BYTES_WRITTEN,              ///< Plaintext bytes accepted by SSL_write, early data and sendfile included
+                RECORDS_READ,               ///< TLS records received, not counted for records decrypted by the kernel
+                RECORDS_WRITTEN,            ///< TLS records sent, not counted for records encrypted by the kernel
+                SSL_READ_CALLS,             ///< Calls to SSL_read
+                SSL_WRITE_CALLS,            ///< Calls to SSL_write, SSL_write_early_data and SSL_sendfile
+                WANT_READ_WAITS,            ///< Times a TLS operation had to wait for incoming data
+                WANT_WRITE_WAITS,           ///< Times a TLS operation had to wait for the socket to drain
+                READ_AHEAD_HITS,            ///< Reads served entirely from the read-ahead buffer
+                READ_AHEAD_MISSES,          ///< Reads that required at least one SSL_read
+                FULL_HANDSHAKES,            ///< Completed full handshakes
+                RESUMED_HANDSHAKES,         ///< Completed abbreviated (resumed) handshakes
+                EARLY_DATA_ACCEPTED,        ///< Connections whose early data was accepted
+                EARLY_DATA_REJECTED,        ///< Connections whose early data was rejected and resent
+                CIPHERTEXT_SENDS,           ///< send() calls made by the memory BIO engine
+                CIPHERTEXT_RECVS,           ///< recv() calls made by the memory BIO engine
+                COUNT                       ///< Number of counters, not a counter
+            };
+
+            /**
+             * @brief Latency histograms, the first three match OpenSSLConnection::OperationType
+             */
+            enum class Latency {
+                HANDSHAKE = 0,              ///< TCP connect and TLS handshake
+                READ = 1,                   ///< TLS reads that had to wait
+                WRITE = 2,                  ///< TLS writes that had to wait
+                SOCKET_WAIT = 3,            ///< Single waits for socket readiness
+                COUNT = 4                   ///< Number of histograms, not a histogram
+            };
+
+        protected:
+            /**
+             * @brief Statistics updated by one group of threads
+             */
+            struct Shard {
+                std::atomic<uint64_t> counters_[static_cast<int>(Counter::COUNT)];
+                std::atomic<uint64_t> latency_buckets_[static_cast<int>(Latency::COUNT)][OPENSSL_STATS_LATENCY_BUCKET_COUNT];
+                char padding_[64];          ///< Keeps the next shard off this shard's last cache line
+            };
+
+            Shard shards_[OPENSSL_STATS_SHARD_COUNT];                               ///< Per thread shards
+            std::atomic<uint64_t> timeout_counts_[static_cast<int>(Latency::COUNT)];   ///< Operations that ran into their deadline, rare enough to share
+            std::atomic<int64_t> max_latency_usecs_[static_cast<int>(Latency::COUNT)]; ///< Largest sample per histogram
+
+            /**
+             * @brief Get the shard of the calling thread
+             *
+             * @return Shard & - shard to update
+             */
+            Shard &GetThreadShard();
+
+        public:
+            OpenSSLConnectionStats();
+
+            // Disabling copy constructors
+            OpenSSLConnectionStats(const OpenSSLConnectionStats &) = delete;
+            OpenSSLConnectionStats &operator=(const OpenSSLConnectionStats &) = delete;
+
+            /**
+             * @brief Add to a counter
+             *
+             * @param Counter counter - counter to update
+             * @param uint64_t value - amount to add
+             */
+            void Increment(Counter counter, uint64_t value = 1) {
+                GetThreadShard().counters_[static_cast<int>(counter)].fetch_add(value, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Record a latency sample
+             *
+             * @param Latency latency - histogram to update
+             * @param std::chrono::microseconds duration - sample
+             * @param bool timed_out - true if the operation ran into its deadline
+             */
+            void RecordLatency(Latency latency, std::chrono::microseconds duration, bool timed_out);
+
+            /**
+             * @brief Get the current value of a counter
+             *
+             * @param Counter counter - counter to query
+             * @return uint64_t - counter value
+             */
+            uint64_t Get(Counter counter) const;
+
+            /**
+             * @brief Get the number of samples in a histogram
+             *
+             * @param Latency latency - histogram to query
+             * @return uint64_t - sample count
+             */
+            uint64_t GetSampleCount(Latency latency) const;
+
+            /**
+             * @brief Get an upper bound for a percentile of a histogram
+             *
+             * @param Latency latency - histogram to query
+             * @param double percentile - percentile between 0 and 100
+             * @return std::chrono::microseconds - upper bound of the bucket holding the percentile, capped at the largest
+             * sample, zero if empty
+             */
+            std::chrono::microseconds GetPercentile(Latency latency, double percentile) const;
+
+            /**
+             * @brief Get the largest sample of a histogram
+             *
+             * @param Latency latency - histogram to query
+             * @return std::chrono::microseconds - largest sample
+             */
+            std::chrono::microseconds GetMax(Latency latency) const {
+                return std::chrono::microseconds(max_latency_usecs_[static_cast<int>(latency)].load(
+                    std::memory_order_relaxed));
+            }
+
+            /**
+             * @brief Get the number of operations that ran into their deadline
+             *
+             * @param Latency latency - operation to query
+             * @return uint64_t - timeout count
+             */
+            uint64_t GetTimeoutCount(Latency latency) const {
+                return timeout_counts_[static_cast<int>(latency)].load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Format all statistics on a single line, for logging
+             *
+             * @return util::String - formatted statistics
+             */
+            util::String ToString() const;
+        };
+    }
+}
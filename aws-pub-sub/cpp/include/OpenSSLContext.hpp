@@ -0,0 +1,116 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLContext.hpp
+ * @brief Defines a shared, reference counted OpenSSL context
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include "util/memory/stl/String.hpp"
+#include "ResponseCode.hpp"
+
+namespace awsiotsdk {
+    namespace network {
+        /**
+         * @brief Shared OpenSSL context
+         *
+         * Holds an SSL_CTX with the root CA, device certificate and private key already parsed. Contexts are cached
+         * per set of credentials, so every OpenSSLConnection using the same files shares one context and the PEM
+         * files are read once instead of on every connection attempt. The context is freed when the last connection
+         * referencing it goes away.
+         */
+        class OpenSSLContext {
+        protected:
+            util::String root_ca_location_;             ///< Filename (including path) of the root CA file
+            util::String device_cert_location_;         ///< Filename (including path) of the device certificate
+            util::String device_private_key_location_;  ///< Filename (including path) of the device private key file
+            SSL_CTX *p_ssl_context_;                    ///< SSL Context instance, also owns the parsed X509_STORE
+
+            OpenSSLContext(util::String root_ca_location, util::String device_cert_location,
+                           util::String device_private_key_location);
+
+            /**
+             * @brief Create the SSL_CTX and load the credentials into it
+             *
+             * @return ResponseCode - successful operation or TLS error
+             */
+            ResponseCode LoadCredentials();
+
+            /**
+             * @brief Build the cache key for a set of credentials
+             *
+             * @return util::String - cache key
+             */
+            static util::String GetCacheKey(const util::String &root_ca_location,
+                                            const util::String &device_cert_location,
+                                            const util::String &device_private_key_location);
+
+        public:
+            // Disabling default and copy constructors
+            OpenSSLContext() = delete;
+            OpenSSLContext(const OpenSSLContext &) = delete;
+            OpenSSLContext &operator=(const OpenSSLContext &) = delete;
+
+            /**
+             * @brief Initialize the OpenSSL library
+             *
+             * Safe to call from every connection, the library is only initialized once per process.
+             *
+             * @return ResponseCode - successful operation or TLS init error
+             */
+            static ResponseCode InitializeLibrary();
+
+            /**
+             * @brief Get the shared context for a set of credentials
+             *
+             * Returns the cached context if one is still in use, otherwise creates a new context and parses the
+             * credential files. Device certificate and key are optional and skipped if either path is empty.
+             *
+             * @param util::String root_ca_location - Path of the location of the Root CA
+             * @param util::String device_cert_location - Path to the location of the Device Cert
+             * @param util::String device_private_key_location - Path to the location of the device private key file
+             * @param std::shared_ptr<OpenSSLContext> p_context_out - reference to store the shared context
+             * @return ResponseCode - successful operation or TLS error
+             */
+            static ResponseCode Acquire(util::String root_ca_location, util::String device_cert_location,
+                                        util::String device_private_key_location,
+                                        std::shared_ptr<OpenSSLContext> &p_context_out);
+
+            /**
+             * @brief Check if this context was created for the given credentials
+             *
+             * @return bool - true if the credential files match
+             */
+            bool Matches(const util::String &root_ca_location, const util::String &device_cert_location,
+                         const util::String &device_private_key_location) const;
+
+            /**
+             * @brief Get the underlying SSL_CTX
+             *
+             * @return SSL_CTX * - SSL context, owned by this object
+             */
+            SSL_CTX *GetSSLContext() const { return p_ssl_context_; }
+
+            ~OpenSSLContext();
+        };
+    }
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLHandshakePool.hpp
+ * @brief Defines a bounded pool of threads running TLS handshakes for many connections
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "util/memory/stl/Vector.hpp"
+#include "ResponseCode.hpp"
+
+// Weight of a new sample in the smoothed handshake duration, as a divisor
+#define OPENSSL_HANDSHAKE_POOL_SMOOTHING_DIVISOR 4
+
+namespace awsiotsdk {
+    namespace network {
+        /**
+         * @brief Runs the TCP connects and TLS handshakes of many connections on a fixed number of threads
+         *
+         * When an uplink comes back, every connection of a gateway reconnects at the same moment. Without the pool
+         * each of them runs its asymmetric crypto on its own thread, the handshakes compete for the CPU and all of
+         * them finish late, often after the broker has given up on them. With the pool, at most one handshake per
+         * worker runs at a time and the callers wait for their turn.
+         *
+         * While every worker is busy, a new handshake is scheduled at a random point of a jitter window so that
+         * reconnects reach the broker spread out instead of in bursts. The window is the time the workers need to
+         * work off the backlog, but never shorter than the minimum or longer than the maximum jitter window. The
+         * MQTT reconnect intervals make good bounds. A handshake never waits for more than half of its remaining
+         * handshake timeout.
+         *
+         * Admission control bounds the number of waiting handshakes. Once the queue is full, further connects fail
+         * right away with ACTION_QUEUE_FULL and are retried by the caller's reconnect backoff, which keeps the work
+         * the pool has accepted finishable within its deadlines.
+         */
+        class OpenSSLHandshakePool {
+        public:
+            /**
+             * @brief Connect and handshake of a single connection, called with the deadline of the handshake
+             */
+            typedef std::function<ResponseCode(const std::chrono::steady_clock::time_point &)> HandshakeFunction;
+
+        protected:
+            /**
+             * @brief A handshake submitted to the pool
+             */
+            struct HandshakeJob {
+                HandshakeFunction handshake;                        ///< Work to run on a worker
+                std::chrono::steady_clock::time_point start_time;   ///< Earliest time a worker may start the job
+                std::chrono::steady_clock::time_point deadline;     ///< Handshake deadline of the connection
+                bool is_started;                                    ///< Set once a worker has taken the job
+                bool is_done;                                       ///< Set once the result is available
+                ResponseCode result;                                ///< Result of the handshake
+                std::condition_variable done_cv;                    ///< Wakes the caller when the job has finished
+            };
+
+            size_t max_queued_;                             ///< Queued handshakes above which new ones are rejected
+            std::chrono::milliseconds min_jitter_window_;   ///< Shortest window a handshake is delayed within
+            std::chrono::milliseconds max_jitter_window_;   ///< Longest window a handshake is delayed within
+
+            std::mutex pool_mutex_;                         ///< Protects everything below
+            std::condition_variable worker_cv_;             ///< Wakes workers for new jobs and on shutdown
+            bool is_running_;                               ///< Cleared when the pool shuts down
+            size_t active_count_;                           ///< Handshakes currently running on a worker
+            int64_t smoothed_handshake_usecs_;              ///< Smoothed duration of a handshake, 0 if none has run
+            uint64_t completed_count_;                      ///< Handshakes run to completion
+            uint64_t rejected_count_;                       ///< Handshakes turned away because the queue was full
+            uint64_t expired_count_;                        ///< Handshakes whose deadline passed before they started
+            std::mt19937 jitter_engine_;                    ///< Source of the scheduling jitter
+            util::Vector<std::shared_ptr<HandshakeJob>> queue_;     ///< Jobs waiting for a worker
+            util::Vector<std::unique_ptr<std::thread>> workers_;    ///< Worker threads
+
+            /**
+             * @brief Pick the delay of a new handshake, must be called with the pool mutex held
+             *
+             * @param std::chrono::steady_clock::time_point deadline - handshake deadline of the connection
+             * @return std::chrono::steady_clock::duration - delay before a worker may start the handshake
+             */
+            std::chrono::steady_clock::duration GetJitterLocked(const std::chrono::steady_clock::time_point &deadline);
+
+            /**
+             * @brief Body of a worker thread, runs due jobs earliest start time first until the pool shuts down
+             */
+            void WorkerThread();
+
+        public:
+            /**
+             * @brief Constructor, starts the workers
+             *
+             * @param size_t worker_count - handshakes run in parallel, 0 for one per hardware thread
+             * @param size_t max_queued - handshakes allowed to wait for a worker
+             * @param std::chrono::milliseconds min_jitter_window - shortest window handshakes are spread over while
+             * the workers are busy, e.g. the minimum reconnect interval
+             * @param std::chrono::milliseconds max_jitter_window - longest window handshakes are spread over, e.g.
+             * the maximum reconnect interval
+             */
+            OpenSSLHandshakePool(size_t worker_count, size_t max_queued, std::chrono::milliseconds min_jitter_window,
+                                 std::chrono::milliseconds max_jitter_window);
+
+            // Disabling copy constructors
+            OpenSSLHandshakePool(const OpenSSLHandshakePool &) = delete;
+            OpenSSLHandshakePool &operator=(const OpenSSLHandshakePool &) = delete;
+
+            /**
+             * @brief Run a handshake on a worker and wait for its result
+             *
+             * The handshake runs on another thread while the caller is blocked, so it may use the caller's state
+             * without further locking. Handshakes that haven't started when their deadline passes are withdrawn.
+             *
+             * @param HandshakeFunction handshake - connect and handshake to run
+             * @param std::chrono::steady_clock::time_point deadline - handshake deadline, passed on to the handshake
+             * @return ResponseCode - result of the handshake, ACTION_QUEUE_FULL if it wasn't admitted or
+             * NETWORK_SSL_CONNECT_TIMEOUT_ERROR if it didn't start before the deadline
+             */
+            ResponseCode Run(HandshakeFunction handshake, const std::chrono::steady_clock::time_point &deadline);
+
+            /**
+             * @brief Get the number of worker threads
+             *
+             * @return size_t - worker count
+             */
+            size_t GetWorkerCount();
+
+            /**
+             * @brief Get the number of handshakes waiting for a worker
+             *
+             * @return size_t - queued handshakes
+             */
+            size_t GetQueuedCount();
+
+            /**
+             * @brief Get the number of handshakes run to completion, successful or not
+             *
+             * @return uint64_t - completed handshakes
+             */
+            uint64_t GetCompletedCount();
+
+            /**
+             * @brief Get the number of handshakes rejected because the queue was full
+             *
+             * @return uint64_t - rejected handshakes
+             */
+            uint64_t GetRejectedCount();
+
+            /**
+             * @brief Get the number of handshakes withdrawn because their deadline passed while queued
+             *
+             * @return uint64_t - expired handshakes
+             */
+            uint64_t GetExpiredCount();
+
+            /**
+             * @brief Destructor, fails the queued handshakes and waits for the running ones
+             */
+            virtual ~OpenSSLHandshakePool();
+        };
+    }
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLReactor.hpp
+ * @brief Defines an event loop driving the sockets of many OpenSSL connections
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "util/memory/stl/Vector.hpp"
+#include "ResponseCode.hpp"
+
+namespace awsiotsdk {
+    namespace network {
+        class OpenSSLConnection;
+
+        /**
+         * @brief Event loop shared by many OpenSSL connections
+         *
+         * A fixed pool of threads waits on a single epoll instance holding the sockets of every attached connection.
+         * When a socket becomes readable one of the threads runs the connection's TLS state machine, decrypting
+         * whole records into the connection's read-ahead buffer, and wakes the MQTT read waiting on that connection.
+         * WANT_WRITE from the TLS layer re-arms the socket for writability instead. A connection is only ever
+         * handled by one reactor thread at a time.
+         *
+         * Only available on Linux. Create() returns nullptr elsewhere and connections then keep driving their own
+         * sockets.
+         */
+        class OpenSSLReactor {
+        public:
+            /**
+             * @brief What a connection wants to wait for next
+             */
+            enum class Interest {
+                NONE = 0,   ///< Nothing, the connection re-arms itself later
+                READ = 1,   ///< Socket readability
+                WRITE = 2   ///< Socket writability, the TLS layer needs to send before it can read
+            };
+
+        protected:
+            /**
+             * @brief Registry entry for an attached connection
+             */
+            struct RegisteredConnection {
+                OpenSSLConnection *p_connection_;   ///< Attached connection, not owned
+                bool is_registered_;                ///< Cleared while the connection is being detached
+                bool is_busy_;                      ///< True while a reactor thread is running the connection
+            };
+
+            int epoll_fd_;                              ///< epoll instance holding every attached socket
+            int wakeup_fd_;                             ///< eventfd used to wake the threads on shutdown
+            std::atomic_bool is_running_;               ///< Stop flag for the reactor threads
+            std::mutex registry_mutex_;                 ///< Protects the registry
+            std::condition_variable registry_cv_;       ///< Signalled whenever a connection stops being busy
+            std::map<int, RegisteredConnection> registry_;  ///< Attached connections, keyed by socket descriptor
+            util::Vector<std::unique_ptr<std::thread>> reactor_threads_;  ///< Fixed pool of reactor threads
+
+            OpenSSLReactor();
+
+            /**
+             * @brief Update the epoll registration of a socket, must be called with the registry mutex held
+             */
+            void RearmLocked(int socket_fd, Interest interest);
+
+            /**
+             * @brief Body of each reactor thread
+             */
+            void ReactorThread();
+
+        public:
+            // Disabling default and copy constructors
+            OpenSSLReactor(const OpenSSLReactor &) = delete;
+            OpenSSLReactor &operator=(const OpenSSLReactor &) = delete;
+
+            /**
+             * @brief Create a reactor and start its threads
+             *
+             * @param size_t thread_count - number of reactor threads, at least one is started
+             * @return std::shared_ptr<OpenSSLReactor> - the reactor, nullptr if it could not be created
+             */
+            static std::shared_ptr<OpenSSLReactor> Create(size_t thread_count);
+
+            /**
+             * @brief Attach a connected socket to the reactor
+             *
+             * @param OpenSSLConnection * - connection to drive, must stay alive until detached
+             * @param int socket_fd - socket of the connection
+             * @return ResponseCode - successful operation or TCP setup error
+             */
+            ResponseCode Register(OpenSSLConnection *p_connection, int socket_fd);
+
+            /**
+             * @brief Watch the socket again after the connection handled an event itself
+             *
+             * @param int socket_fd - socket of the connection
+             * @param Interest interest - readiness to wait for, NONE is ignored
+             */
+            void Rearm(int socket_fd, Interest interest);
+
+            /**
+             * @brief Detach a socket from the reactor
+             *
+             * Blocks until no reactor thread is running the connection any more, so it is safe to close the socket
+             * and free the TLS handle once this returns.
+             *
+             * @param int socket_fd - socket of the connection
+             */
+            void Deregister(int socket_fd);
+
+            /**
+             * @brief Get the number of attached connections
+             *
+             * @return size_t - attached connection count
+             */
+            size_t GetConnectionCount();
+
+            ~OpenSSLReactor();
+        };
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLSocketTuning.hpp
+ * @brief Defines named sets of TCP socket options
+ */
+
+#pragma once
+
+#include <chrono>
+
+#include "util/memory/stl/String.hpp"
+#include "ResponseCode.hpp"
+
+namespace awsiotsdk {
+    namespace network {
+        /**
+         * @brief TCP socket options applied before connecting
+         *
+         * Zero values leave the operating system default in place. Options the platform doesn't support are skipped.
+         */
+        struct OpenSSLSocketTuning {
+            /**
+             * @brief Named tuning profiles
+             */
+            enum class Profile {
+                SYSTEM_DEFAULT = 0,     ///< Leave every option at the operating system default
+                LOW_LATENCY = 1,        ///< Small packets go out at once, dead peers are noticed within seconds
+                BULK_THROUGHPUT = 2,    ///< Large buffers and full segments for big payloads
+                LOW_POWER = 3           ///< Few wakeups, small buffers and rare keepalive probes for battery devices
+            };
+
+            bool no_delay;                          ///< True disables Nagle's algorithm (TCP_NODELAY)
+            int send_buffer_bytes;                  ///< SO_SNDBUF, 0 for the default
+            int receive_buffer_bytes;               ///< SO_RCVBUF, 0 for the default
+            std::chrono::seconds keepalive_idle;    ///< Idle time before the first keepalive probe, 0 disables keepalive
+            std::chrono::seconds keepalive_interval;    ///< Time between keepalive probes
+            int keepalive_probe_count;              ///< Unanswered probes before the connection is dropped
+            std::chrono::milliseconds user_timeout; ///< TCP_USER_TIMEOUT, how long sent data may stay unacknowledged, 0 for the default
+            int not_sent_low_watermark_bytes;       ///< TCP_NOTSENT_LOWAT, unsent bytes above which the socket isn't writable, 0 for the default
+
+            /**
+             * @brief Get the options of a named profile
+             *
+             * @param Profile profile - profile to look up
+             * @return OpenSSLSocketTuning - options of the profile
+             */
+            static OpenSSLSocketTuning ForProfile(Profile profile);
+
+            /**
+             * @brief Look up a profile by its configuration name
+             *
+             * @param util::String name - "system_default", "low_latency", "bulk_throughput" or "low_power"
+             * @param Profile profile_out - reference to store the profile
+             * @return ResponseCode - successful operation or FAILURE for an unknown name
+             */
+            static ResponseCode ParseProfile(const util::String &name, Profile &profile_out);
+
+            /**
+             * @brief Apply the options to a socket, must be called before connecting
+             *
+             * Buffer sizes only affect the TCP window scale negotiated if they are set before the connect. Failures
+             * are logged and the remaining options are still applied.
+             *
+             * @param int socket_fd - socket to update
+             * @return ResponseCode - successful operation or NETWORK_TCP_SETUP_ERROR if an option was rejected
+             */
+            ResponseCode Apply(int socket_fd) const;
+        };
+    }
+}
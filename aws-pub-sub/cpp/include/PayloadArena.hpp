@@ -0,0 +1,92 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file PayloadArena.hpp
+ * @brief Defines a fixed pool of payload buffers that are reused instead of allocated per message
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "util/memory/stl/String.hpp"
+#include "util/memory/stl/Vector.hpp"
+
+namespace awsiotsdk {
+    namespace samples {
+        /**
+         * @brief A fixed number of payload buffers, allocated once
+         *
+         * A publisher acquires a slot, serializes the payload into it and hands the slot to the publish. The slot
+         * comes back when the broker acknowledged the message, so the number of slots also bounds the messages in
+         * flight. Payloads that fit the slot size never allocate, larger ones grow their slot once and keep the
+         * capacity.
+         */
+        class PayloadArena {
+        public:
+            /**
+             * @brief One payload buffer
+             */
+            struct Slot {
+                util::String payload;               ///< Payload, cleared on acquire with its capacity kept
+                PayloadArena *p_arena;              ///< Arena the slot belongs to
+            };
+
+        protected:
+            util::Vector<Slot> slots_;              ///< Every slot, never resized after construction
+            util::Vector<Slot *> free_slots_;       ///< Slots that can be acquired, capacity for all of them
+            std::mutex arena_mutex_;                ///< Protects the free list
+            std::condition_variable released_cv_;   ///< Signalled when a slot is released
+
+        public:
+            /**
+             * @brief Constructor
+             *
+             * @param size_t slot_count - number of slots, at least 1
+             * @param size_t slot_size - bytes reserved per slot
+             */
+            PayloadArena(size_t slot_count, size_t slot_size);
+
+            // Disabling copy constructors
+            PayloadArena(const PayloadArena &) = delete;
+            PayloadArena &operator=(const PayloadArena &) = delete;
+
+            /**
+             * @brief Take a slot, waiting for one to be released if all are in use
+             *
+             * @param std::chrono::milliseconds timeout - longest time to wait
+             * @return Slot * - an empty slot, nullptr if none was released in time
+             */
+            Slot *Acquire(std::chrono::milliseconds timeout);
+
+            /**
+             * @brief Return a slot to its arena
+             *
+             * @param Slot * p_slot - slot acquired from this arena
+             */
+            void Release(Slot *p_slot);
+
+            /**
+             * @brief Get the number of slots not in use
+             *
+             * @return size_t - free slots
+             */
+            size_t GetFreeCount();
+        };
+    }
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file PubSubBenchmark.hpp
+ * @brief Defines a loopback throughput and latency benchmark for the PubSub sample
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <utility>
+
+#include "util/memory/stl/String.hpp"
+#include "util/memory/stl/Vector.hpp"
+#include "ResponseCode.hpp"
+#include "PayloadArena.hpp"
+#include "TopicHandle.hpp"
+
+namespace awsiotsdk {
+    namespace samples {
+        /**
+         * @brief Publishes numbered, timestamped messages and measures how fast and how late they come back
+         *
+         * Every payload starts with "<sequence number> <send time in ns> " and is padded to its drawn size, so the
+         * subscriber side can compute the publish to receive latency without any shared state. Sizes smaller than
+         * that header get the header only. The client must be subscribed to GetTopicFilter() and hand every message
+         * it receives there to OnMessage().
+         *
+         * Payloads are serialized into a PayloadArena with one slot per message that may be in flight, and the topics
+         * are TopicHandles, so publishing allocates nothing on this side. When built with COUNT_ALLOCATIONS the
+         * report includes the process wide allocations per message once the first tenth of the messages warmed up
+         * the client.
+         */
+        class PubSubBenchmark {
+        public:
+            /**
+             * @brief Queues one message for publishing
+             *
+             * Takes over the slot and must return it to its arena once the message no longer needs it. Returns
+             * SUCCESS once the message was handed to the client. ACTION_QUEUE_FULL counts the message as failed and
+             * the benchmark goes on, any other error stops it.
+             */
+            typedef std::function<ResponseCode(const TopicHandle &topic,
+                                               PayloadArena::Slot *p_slot)> PublishFunction;
+
+            /**
+             * @brief Headline numbers of a run, for comparing runs
+             */
+            struct Summary {
+                size_t received_count;          ///< Distinct messages received
+                uint64_t receive_rate;          ///< Messages per second
+                uint64_t receive_byte_rate;     ///< Payload bytes per second
+                uint32_t p50_latency_usecs;     ///< Median publish to receive latency
+                uint32_t p99_latency_usecs;     ///< 99th percentile publish to receive latency
+            };
+
+        protected:
+            size_t message_count_;                                  ///< Messages to publish
+            util::Vector<std::pair<size_t, size_t>> payload_sizes_; ///< Size ranges, picked with equal probability
+            util::Vector<std::shared_ptr<TopicHandle>> topics_;     ///< Topics the messages are spread over
+            PayloadArena payload_arena_;                            ///< One slot per message that may be in flight
+            util::String topic_filter_;                             ///< Filter matching every topic
+            uint32_t target_rate_;                                  ///< Messages per second, 0 for unthrottled
+            std::mt19937 size_engine_;                              ///< Draws the payload sizes, fixed seed
+
+            std::mutex stats_mutex_;                                ///< Protects everything below
+            std::condition_variable received_cv_;                   ///< Signalled when the last message arrived
+            bool is_publishing_done_;                               ///< Run() has returned
+            size_t published_count_;                                ///< Messages handed to the client
+            size_t failed_count_;                                   ///< Messages the client didn't take
+            size_t received_count_;                                 ///< Distinct messages received
+            size_t duplicate_count_;                                ///< Messages received more than once
+            uint64_t published_bytes_;                              ///< Payload bytes handed to the client
+            uint64_t received_bytes_;                               ///< Payload bytes of distinct messages received
+            util::Vector<bool> is_received_;                        ///< Indexed by sequence number
+            util::Vector<uint32_t> latencies_usecs_;                ///< Publish to receive latency per message
+            std::chrono::steady_clock::time_point start_time_;      ///< First publish
+            std::chrono::steady_clock::time_point publish_end_time_;///< Last publish queued
+            std::chrono::steady_clock::time_point last_receive_time_;   ///< Last distinct message received
+            size_t steady_state_count_;                             ///< Messages published after the warm up
+            uint64_t steady_state_allocations_;                     ///< Allocations while publishing those
+
+            /**
+             * @brief Get a latency percentile, must be called with the stats mutex held and latencies sorted
+             *
+             * @param double fraction - percentile as a fraction, e.g. 0.99
+             * @return uint32_t - latency in microseconds, 0 if nothing was received
+             */
+            uint32_t GetPercentileLocked(double fraction) const;
+
+            /**
+             * @brief Compute the summary, must be called with the stats mutex held and latencies sorted
+             *
+             * @return Summary - headline numbers so far
+             */
+            Summary GetSummaryLocked() const;
+
+        public:
+            /**
+             * @brief Constructor
+             *
+             * @param util::String topic_prefix - the topics are "<topic_prefix>/<index>"
+             * @param size_t message_count - messages to publish
+             * @param util::Vector<std::pair<size_t, size_t>> payload_sizes - inclusive size ranges in bytes
+             * @param size_t topic_count - number of topics, at least 1
+             * @param uint32_t target_rate - messages per second, 0 publishes as fast as the client takes them
+             * @param size_t max_in_flight - most messages the publisher keeps unacknowledged, sizes the arena
+             */
+            PubSubBenchmark(const util::String &topic_prefix, size_t message_count,
+                            const util::Vector<std::pair<size_t, size_t>> &payload_sizes, size_t topic_count,
+                            uint32_t target_rate, size_t max_in_flight);
+
+            // Disabling copy constructors
+            PubSubBenchmark(const PubSubBenchmark &) = delete;
+            PubSubBenchmark &operator=(const PubSubBenchmark &) = delete;
+
+            /**
+             * @brief Parse a payload size distribution
+             *
+             * @param util::String sizes - comma separated sizes in bytes, "min-max" entries pick uniformly in between,
+             * e.g. "64,64,1024-4096"
+             * @param util::Vector<std::pair<size_t, size_t>> sizes_out - parsed inclusive ranges
+             * @return ResponseCode - SUCCESS, or FAILURE if an entry is malformed
+             */
+            static ResponseCode ParsePayloadSizes(const util::String &sizes,
+                                                  util::Vector<std::pair<size_t, size_t>> &sizes_out);
+
+            /**
+             * @brief Get the filter to subscribe to
+             *
+             * @return util::String - "<topic_prefix>/#"
+             */
+            util::String GetTopicFilter() const;
+
+            /**
+             * @brief Get the topics the messages are published on
+             *
+             * @return util::Vector<std::shared_ptr<TopicHandle>> - "<topic_prefix>/<index>" topics
+             */
+            const util::Vector<std::shared_ptr<TopicHandle>> &GetTopics() const;
+
+            /**
+             * @brief Publish every message, pacing them to the target rate
+             *
+             * @param PublishFunction publish - queues one message
+             * @param std::chrono::milliseconds slot_timeout - longest wait for an acknowledgement to free a slot,
+             * the message counts as failed after that
+             * @return ResponseCode - SUCCESS, or the error that stopped publishing
+             */
+            ResponseCode Run(const PublishFunction &publish, std::chrono::milliseconds slot_timeout);
+
+            /**
+             * @brief Record a received message
+             *
+             * @param util::String payload - payload as received
+             * @return bool - false if the payload isn't a message of this benchmark
+             */
+            bool OnMessage(const util::String &payload);
+
+            /**
+             * @brief Wait until every published message was received
+             *
+             * @param std::chrono::milliseconds timeout - longest time to wait after publishing ended
+             * @return bool - true if nothing is missing
+             */
+            bool WaitForMessages(std::chrono::milliseconds timeout);
+
+            /**
+             * @brief Print throughput and latency percentiles to stdout
+             */
+            void PrintReport();
+
+            /**
+             * @brief Get the headline numbers once the run is over
+             *
+             * @return Summary - received messages, rates and latency percentiles
+             */
+            Summary GetSummary();
+        };
+    }
+}
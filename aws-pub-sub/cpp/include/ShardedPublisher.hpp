@@ -0,0 +1,209 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file ShardedPublisher.hpp
+ * @brief Defines a publisher that spreads messages over several client connections
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include "mqtt/Client.hpp"
+#include "NetworkConnection.hpp"
+#include "BackpressurePublisher.hpp"
+#include "PayloadArena.hpp"
+#include "TopicHandle.hpp"
+
+namespace awsiotsdk {
+    namespace samples {
+        /**
+         * @brief Publishes over N MQTT clients, each with its own connection, action thread and publish window
+         *
+         * A message goes to the shard its key hashes to, the topic name unless a key is given. Messages with the
+         * same key therefore always travel over the same connection and keep their order, messages with different
+         * keys may overtake each other. Subscribe() subscribes every shard to the topics that hash to it, so a
+         * topic is published and received on the same connection.
+         *
+         * The clients use the command timeout, keep alive and clean session settings of ConfigCommon.
+         */
+        class ShardedPublisher {
+        public:
+            /**
+             * @brief Creates and initializes a new network connection for one shard
+             */
+            typedef std::function<ResponseCode(std::shared_ptr<NetworkConnection> &p_connection_out)>
+                ConnectionFactory;
+
+        protected:
+            /**
+             * @brief One client connection and the window of publishes in flight on it
+             */
+            struct Shard {
+                std::shared_ptr<MqttClient> p_client;                   ///< Connected client
+                std::shared_ptr<BackpressurePublisher> p_publisher;     ///< Publishes through the client
+            };
+
+            ConnectionFactory create_connection_;                       ///< Creates the shards' connections
+            size_t max_window_;                                         ///< Window limit of every shard
+            std::chrono::milliseconds queue_full_backoff_;              ///< Retry delay of every shard
+            util::Vector<Shard> shards_;                                ///< Connected shards
+
+            /**
+             * @brief Called by the clients when a connection was lost
+             *
+             * @param util::String client_id - client id of the shard
+             * @param std::shared_ptr<DisconnectCallbackContextData> p_app_handler_data - unused
+             * @return ResponseCode - SUCCESS
+             */
+            ResponseCode DisconnectCallback(util::String client_id,
+                                            std::shared_ptr<DisconnectCallbackContextData> p_app_handler_data);
+
+        public:
+            /**
+             * @brief Constructor
+             *
+             * @param ConnectionFactory create_connection - creates one network connection per shard
+             * @param size_t max_window - most unacknowledged publishes per shard
+             * @param std::chrono::milliseconds queue_full_backoff - see BackpressurePublisher
+             */
+            ShardedPublisher(const ConnectionFactory &create_connection, size_t max_window,
+                             std::chrono::milliseconds queue_full_backoff);
+
+            // Disabling copy constructors
+            ShardedPublisher(const ShardedPublisher &) = delete;
+            ShardedPublisher &operator=(const ShardedPublisher &) = delete;
+
+            /**
+             * @brief Destructor, disconnects every shard
+             */
+            ~ShardedPublisher();
+
+            /**
+             * @brief Open the connections
+             *
+             * @param size_t shard_count - number of connections, at least 1
+             * @param util::String client_id_prefix - shard i connects as "<client_id_prefix><i>"
+             * @return ResponseCode - SUCCESS once every shard is connected, otherwise the first error, in which case
+             * the shards connected so far are disconnected again
+             */
+            ResponseCode Connect(size_t shard_count, const util::String &client_id_prefix);
+
+            /**
+             * @brief Subscribe every shard to the topics that hash to it
+             *
+             * @param util::Vector<std::shared_ptr<TopicHandle>> topics - topics to subscribe to
+             * @param mqtt::QoS qos - maximum QoS of the subscriptions
+             * @param mqtt::Subscription::ApplicationCallbackHandlerPtr p_handler - called for every message, from
+             * the receiving shard's thread
+             * @return ResponseCode - SUCCESS once every shard got its SUBACK, otherwise the first error
+             */
+            ResponseCode Subscribe(const util::Vector<std::shared_ptr<TopicHandle>> &topics, mqtt::QoS qos,
+                                   const mqtt::Subscription::ApplicationCallbackHandlerPtr &p_handler);
+
+            /**
+             * @brief Disconnect every shard
+             *
+             * Each client is destroyed before its publisher, so acknowledgement handlers it still holds never run
+             * against a freed publisher, even if WaitForAcks() timed out.
+             *
+             * @return ResponseCode - SUCCESS, or the first error
+             */
+            ResponseCode Disconnect();
+
+            /**
+             * @brief Get the shard a key is published on
+             *
+             * @param util::String key - ordering key
+             * @return size_t - shard index, 0 if not connected
+             */
+            size_t GetShardIndex(const util::String &key) const;
+
+            /**
+             * @brief Publish on the shard of the topic
+             *
+             * @param TopicHandle topic - topic to publish on, also the ordering key
+             * @param mqtt::QoS qos - QoS of the publish
+             * @param PayloadArena::Slot * p_slot - payload, see BackpressurePublisher::Publish()
+             * @param uint16_t packet_id_out - reference to store the packet id, only unique within the shard
+             * @param std::chrono::milliseconds timeout - longest time to wait for room in the shard's window
+             * @return ResponseCode - see BackpressurePublisher::Publish()
+             */
+            ResponseCode Publish(const TopicHandle &topic, mqtt::QoS qos, PayloadArena::Slot *p_slot,
+                                 uint16_t &packet_id_out, std::chrono::milliseconds timeout);
+
+            /**
+             * @brief Publish on the shard of a key
+             *
+             * @param util::String key - ordering key, e.g. a device or session id
+             * @param TopicHandle topic - topic to publish on
+             * @param mqtt::QoS qos - QoS of the publish
+             * @param PayloadArena::Slot * p_slot - payload, see BackpressurePublisher::Publish()
+             * @param uint16_t packet_id_out - reference to store the packet id, only unique within the shard
+             * @param std::chrono::milliseconds timeout - longest time to wait for room in the shard's window
+             * @return ResponseCode - see BackpressurePublisher::Publish()
+             */
+            ResponseCode Publish(const util::String &key, const TopicHandle &topic, mqtt::QoS qos,
+                                 PayloadArena::Slot *p_slot, uint16_t &packet_id_out,
+                                 std::chrono::milliseconds timeout);
+
+            /**
+             * @brief Wait until no shard has publishes in flight
+             *
+             * @param std::chrono::milliseconds timeout - longest time to wait for all shards together
+             * @return bool - true if nothing is in flight anymore
+             */
+            bool WaitForAcks(std::chrono::milliseconds timeout);
+
+            /**
+             * @brief Get the number of connected shards
+             *
+             * @return size_t - shards
+             */
+            size_t GetShardCount() const;
+
+            /**
+             * @brief Get the number of publishes not acknowledged yet, over all shards
+             *
+             * @return size_t - publishes in flight
+             */
+            size_t GetInFlightCount();
+
+            /**
+             * @brief Get the number of acknowledged publishes, over all shards
+             *
+             * @return uint64_t - acknowledged publishes
+             */
+            uint64_t GetAckedCount();
+
+            /**
+             * @brief Get the number of publishes that failed after being queued, over all shards
+             *
+             * @return uint64_t - failed publishes
+             */
+            uint64_t GetFailedCount();
+
+            /**
+             * @brief Get the number of times a shard's action queue was full, over all shards
+             *
+             * @return uint64_t - queue full count
+             */
+            uint64_t GetQueueFullCount();
+        };
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file TopicHandle.hpp
+ * @brief Defines a topic name validated once and published to many times
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "util/memory/stl/String.hpp"
+
+namespace awsiotsdk {
+    namespace samples {
+        /**
+         * @brief A topic name that is known to be valid for publishing
+         *
+         * Checking the name once at creation means the publish path never has to handle a topic the client would
+         * refuse, and keeps the name in one place instead of rebuilding it for every message.
+         */
+        class TopicHandle {
+        protected:
+            util::String topic_name_;                   ///< Validated topic name
+
+            TopicHandle(const util::String &topic_name);
+
+        public:
+            // Disabling copy constructors
+            TopicHandle(const TopicHandle &) = delete;
+            TopicHandle &operator=(const TopicHandle &) = delete;
+
+            /**
+             * @brief Create a handle
+             *
+             * @param util::String topic_name - topic to publish to, must be valid UTF-8 without wildcards
+             * @return std::shared_ptr<TopicHandle> - the handle, nullptr if the name can't be published to
+             */
+            static std::shared_ptr<TopicHandle> Create(const util::String &topic_name);
+
+            /**
+             * @brief Get the topic name
+             *
+             * @return util::String - the validated name
+             */
+            const util::String &GetName() const { return topic_name_; }
+        };
+    }
+}
@@ -0,0 +1,680 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file IoUringConnection.cpp
+ * @brief
+ *
+ */
+
+// Only built when selected, the default build doesn't link liburing
+#ifdef USE_IO_URING
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <openssl/x509v3.h>
+
+#include "IoUringConnection.hpp"
+#include "util/logging/LogMacros.hpp"
+
+#define IO_URING_WRAPPER_LOG_TAG "[io_uring Wrapper]"
+
+// Room for a receive, a send and a connect with its linked timeout
+#define IO_URING_QUEUE_DEPTH 16
+// Largest receive queued at once
+#define IO_URING_RECV_BUFFER_SIZE 65536
+// Capacity of each direction of the TLS engine's BIO pair
+#define IO_URING_BIO_BUFFER_SIZE 65536
+// Low bits of the user data hold the Operation, the rest the generation it was queued in
+#define IO_URING_OPERATION_BITS 8
+
+namespace awsiotsdk {
+    namespace network {
+        IoUringConnection::IoUringConnection(util::String endpoint, uint16_t endpoint_port,
+                                             util::String root_ca_location, util::String device_cert_location,
+                                             util::String device_private_key_location,
+                                             std::chrono::milliseconds tls_handshake_timeout,
+                                             std::chrono::milliseconds tls_read_timeout,
+                                             std::chrono::milliseconds tls_write_timeout,
+                                             bool server_verification_flag) {
+            endpoint_ = endpoint;
+            endpoint_port_ = endpoint_port;
+            root_ca_location_ = root_ca_location;
+            device_cert_location_ = device_cert_location;
+            device_private_key_location_ = device_private_key_location;
+            server_verification_flag_ = server_verification_flag;
+            tls_handshake_timeout_ = tls_handshake_timeout;
+            tls_read_timeout_ = tls_read_timeout;
+            tls_write_timeout_ = tls_write_timeout;
+
+            is_connected_ = false;
+            server_tcp_socket_fd_ = -1;
+            is_ring_initialized_ = false;
+            is_reaping_ = false;
+            is_recv_in_flight_ = false;
+            is_send_in_flight_ = false;
+            send_in_flight_length_ = 0;
+            is_connect_in_flight_ = false;
+            connect_result_ = 0;
+            has_peer_closed_ = false;
+            socket_error_ = 0;
+            submit_call_count_ = 0;
+            completion_count_ = 0;
+            operation_generation_ = 0;
+        }
+
+        ResponseCode IoUringConnection::Initialize() {
+            ResponseCode rc = OpenSSLContext::InitializeLibrary();
+            if (ResponseCode::SUCCESS != rc) {
+                return rc;
+            }
+
+            std::lock_guard<std::mutex> engine_guard(engine_mutex_);
+            if (is_ring_initialized_) {
+                return ResponseCode::SUCCESS;
+            }
+
+            int ret = io_uring_queue_init(IO_URING_QUEUE_DEPTH, &ring_, 0);
+            if (0 > ret) {
+                AWS_LOG_ERROR(IO_URING_WRAPPER_LOG_TAG, "io_uring_queue_init - %s", strerror(-ret));
+                return ResponseCode::NETWORK_TCP_SETUP_ERROR;
+            }
+            // Completions are waited for without the mutex, which needs timeouts that don't go through the SQ ring
+            if (0 == (ring_.features & IORING_FEAT_EXT_ARG)) {
+                AWS_LOG_ERROR(IO_URING_WRAPPER_LOG_TAG, "io_uring timeout waits are not supported, Linux 5.11 required");
+                io_uring_queue_exit(&ring_);
+                return ResponseCode::NETWORK_TCP_SETUP_ERROR;
+            }
+            recv_buffer_.resize(IO_URING_RECV_BUFFER_SIZE);
+            is_ring_initialized_ = true;
+
+            return ResponseCode::SUCCESS;
+        }
+
+        bool IoUringConnection::IsConnected() {
+            return is_connected_;
+        }
+
+        bool IoUringConnection::IsPhysicalLayerConnected() {
+            // Use this to add implementation which can check for physical layer disconnect
+            return true;
+        }
+
+        void IoUringConnection::QueueIOLocked() {
+            if (nullptr == p_tls_engine_ || -1 == server_tcp_socket_fd_ || 0 != socket_error_) {
+                return;
+            }
+
+            unsigned int queued_count = 0;
+            if (!is_send_in_flight_) {
+                const char *p_data = nullptr;
+                size_t length = p_tls_engine_->PeekOutgoingCiphertext(&p_data);
+                struct io_uring_sqe *p_sqe = 0 < length ? io_uring_get_sqe(&ring_) : nullptr;
+                if (nullptr != p_sqe) {
+                    // Sent straight out of the BIO pair, the block stays in place until the send completes
+                    io_uring_prep_send(p_sqe, server_tcp_socket_fd_, p_data, length, MSG_NOSIGNAL);
+                    io_uring_sqe_set_data(p_sqe, GetOperationData(Operation::SEND));
+                    is_send_in_flight_ = true;
+                    send_in_flight_length_ = length;
+                    queued_count++;
+                }
+            }
+
+            if (!is_recv_in_flight_ && !has_peer_closed_) {
+                // Never receive more than the engine can take, so a completed receive is always accepted whole
+                size_t length = std::min(recv_buffer_.size(), p_tls_engine_->GetIncomingCiphertextSpace());
+                struct io_uring_sqe *p_sqe = 0 < length ? io_uring_get_sqe(&ring_) : nullptr;
+                if (nullptr != p_sqe) {
+                    io_uring_prep_recv(p_sqe, server_tcp_socket_fd_, &recv_buffer_[0], length, 0);
+                    io_uring_sqe_set_data(p_sqe, GetOperationData(Operation::RECV));
+                    is_recv_in_flight_ = true;
+                    queued_count++;
+                }
+            }
+
+            if (0 < queued_count) {
+                io_uring_submit(&ring_);
+                submit_call_count_++;
+            }
+        }
+
+        void IoUringConnection::ProcessCompletionsLocked() {
+            struct io_uring_cqe *p_cqe = nullptr;
+
+            while (0 == io_uring_peek_cqe(&ring_, &p_cqe) && nullptr != p_cqe) {
+                uintptr_t data = (uintptr_t) io_uring_cqe_get_data(p_cqe);
+                int result = p_cqe->res;
+                io_uring_cqe_seen(&ring_, p_cqe);
+                completion_count_++;
+                Operation operation = (Operation) (data & ((1 << IO_URING_OPERATION_BITS) - 1));
+                uintptr_t generation = data >> IO_URING_OPERATION_BITS;
+                if (generation != operation_generation_) {
+                    // Left behind by a closed connection, the kernel is done with its memory now
+                    for (size_t itr = 0; itr < abandoned_operations_.size(); itr++) {
+                        if (generation == abandoned_operations_[itr].generation &&
+                            operation == abandoned_operations_[itr].operation) {
+                            abandoned_operations_.erase(abandoned_operations_.begin() + itr);
+                            break;
+                        }
+                    }
+                    continue;
+                }
+
+                switch (operation) {
+                    case Operation::RECV:
+                        is_recv_in_flight_ = false;
+                        if (0 < result) {
+                            if (nullptr != p_tls_engine_) {
+                                p_tls_engine_->WriteIncomingCiphertext(&recv_buffer_[0], (size_t) result);
+                            }
+                        } else if (0 == result) {
+                            has_peer_closed_ = true;
+                            if (nullptr != p_tls_engine_) {
+                                p_tls_engine_->SetIncomingEndOfStream();
+                            }
+                        } else if (-ECANCELED != result && 0 == socket_error_) {
+                            socket_error_ = -result;
+                        }
+                        break;
+                    case Operation::SEND:
+                        is_send_in_flight_ = false;
+                        send_in_flight_length_ = 0;
+                        if (0 < result) {
+                            if (nullptr != p_tls_engine_) {
+                                p_tls_engine_->ConsumeOutgoingCiphertext((size_t) result);
+                            }
+                        } else if (0 == socket_error_) {
+                            socket_error_ = 0 == result ? EPIPE : -result;
+                        }
+                        break;
+                    case Operation::CONNECT:
+                        is_connect_in_flight_ = false;
+                        connect_result_ = result;
+                        break;
+                    case Operation::LINK_TIMEOUT:
+                    case Operation::CANCEL:
+                    default:
+                        break;
+                }
+            }
+        }
+
+        bool IoUringConnection::WaitForCompletionsLocked(std::unique_lock<std::mutex> &engine_lock,
+                                                         const std::chrono::steady_clock::time_point &deadline) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                return false;
+            }
+
+            if (is_reaping_) {
+                // The reaping thread processes our completions too and wakes us up
+                engine_cv_.wait_until(engine_lock, deadline);
+                return std::chrono::steady_clock::now() < deadline;
+            }
+
+            std::chrono::nanoseconds remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+            struct __kernel_timespec timeout;
+            timeout.tv_sec = (long long) std::chrono::duration_cast<std::chrono::seconds>(remaining).count();
+            timeout.tv_nsec = (long long) (remaining.count() % 1000000000);
+
+            is_reaping_ = true;
+            engine_lock.unlock();
+            struct io_uring_cqe *p_cqe = nullptr;
+            int ret = io_uring_wait_cqe_timeout(&ring_, &p_cqe, &timeout);
+            engine_lock.lock();
+            is_reaping_ = false;
+
+            ProcessCompletionsLocked();
+            // Chain the next send and re-arm the receive
+            QueueIOLocked();
+            engine_cv_.notify_all();
+
+            return -ETIME != ret || std::chrono::steady_clock::now() < deadline;
+        }
+
+        ResponseCode IoUringConnection::ConnectTCPSocketLocked(std::unique_lock<std::mutex> &engine_lock,
+                                                               const std::chrono::steady_clock::time_point &deadline) {
+            struct addrinfo hints;
+            struct addrinfo *p_result = nullptr;
+            memset(&hints, 0, sizeof(hints));
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+
+            util::String port_str = std::to_string(endpoint_port_);
+            int gai_status = getaddrinfo(endpoint_.c_str(), port_str.c_str(), &hints, &p_result);
+            if (0 != gai_status) {
+                AWS_LOG_ERROR(IO_URING_WRAPPER_LOG_TAG, "getaddrinfo - %s", gai_strerror(gai_status));
+                return ResponseCode::NETWORK_TCP_NO_ENDPOINT_SPECIFIED;
+            }
+
+            ResponseCode rc = ResponseCode::NETWORK_TCP_CONNECT_ERROR;
+            for (struct addrinfo *p_addr = p_result; nullptr != p_addr && ResponseCode::SUCCESS != rc;
+                 p_addr = p_addr->ai_next) {
+                std::chrono::nanoseconds remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    deadline - std::chrono::steady_clock::now());
+                if (0 >= remaining.count()) {
+                    break;
+                }
+
+                int socket_fd = socket(p_addr->ai_family, p_addr->ai_socktype | SOCK_CLOEXEC, p_addr->ai_protocol);
+                if (-1 == socket_fd) {
+                    continue;
+                }
+
+                struct __kernel_timespec timeout;
+                timeout.tv_sec = (long long) std::chrono::duration_cast<std::chrono::seconds>(remaining).count();
+                timeout.tv_nsec = (long long) (remaining.count() % 1000000000);
+
+                // The connect is bounded by a linked timeout instead of polling a non-blocking socket
+                struct io_uring_sqe *p_sqe = io_uring_get_sqe(&ring_);
+                io_uring_prep_connect(p_sqe, socket_fd, p_addr->ai_addr, p_addr->ai_addrlen);
+                io_uring_sqe_set_data(p_sqe, GetOperationData(Operation::CONNECT));
+                p_sqe->flags |= IOSQE_IO_LINK;
+                p_sqe = io_uring_get_sqe(&ring_);
+                io_uring_prep_link_timeout(p_sqe, &timeout, 0);
+                io_uring_sqe_set_data(p_sqe, GetOperationData(Operation::LINK_TIMEOUT));
+                is_connect_in_flight_ = true;
+                io_uring_submit(&ring_);
+                submit_call_count_++;
+
+                // The linked timeout completes the connect, allow a little slack for its completion to arrive
+                std::chrono::steady_clock::time_point wait_deadline = deadline + std::chrono::seconds(1);
+                while (is_connect_in_flight_ && WaitForCompletionsLocked(engine_lock, wait_deadline)) {
+                }
+
+                if (!is_connect_in_flight_ && 0 == connect_result_) {
+                    server_tcp_socket_fd_ = socket_fd;
+                    rc = ResponseCode::SUCCESS;
+                } else {
+                    AWS_LOG_DEBUG(IO_URING_WRAPPER_LOG_TAG, "connect - %s",
+                                  is_connect_in_flight_ ? "timed out" : strerror(-connect_result_));
+                    close(socket_fd);
+                }
+            }
+            freeaddrinfo(p_result);
+
+            if (ResponseCode::SUCCESS == rc) {
+                // MQTT packets are small, don't hold them back waiting for ACKs
+                int flag = 1;
+                setsockopt(server_tcp_socket_fd_, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+            }
+
+            return rc;
+        }
+
+        ResponseCode IoUringConnection::HandshakeLocked(std::unique_lock<std::mutex> &engine_lock,
+                                                        const std::chrono::steady_clock::time_point &deadline) {
+            while (true) {
+                int ssl_error = p_tls_engine_->Handshake();
+                // Sends the next handshake flight and keeps a receive armed, in one submit
+                QueueIOLocked();
+                if (SSL_ERROR_NONE == ssl_error) {
+                    return ResponseCode::SUCCESS;
+                }
+                if (SSL_ERROR_WANT_READ != ssl_error && SSL_ERROR_WANT_WRITE != ssl_error) {
+                    AWS_LOG_ERROR(IO_URING_WRAPPER_LOG_TAG, " SSL Handshake failed - %d", ssl_error);
+                    return ResponseCode::NETWORK_SSL_CONNECT_ERROR;
+                }
+                if (has_peer_closed_ || 0 != socket_error_) {
+                    AWS_LOG_ERROR(IO_URING_WRAPPER_LOG_TAG, " Connection lost during the handshake");
+                    return ResponseCode::NETWORK_SSL_CONNECT_ERROR;
+                }
+                if (!WaitForCompletionsLocked(engine_lock, deadline)) {
+                    return ResponseCode::NETWORK_SSL_CONNECT_TIMEOUT_ERROR;
+                }
+            }
+        }
+
+        ResponseCode IoUringConnection::ConnectInternal() {
+            std::unique_lock<std::mutex> engine_lock(engine_mutex_);
+            if (!is_ring_initialized_) {
+                AWS_LOG_ERROR(IO_URING_WRAPPER_LOG_TAG, "Initialize() must succeed before connecting");
+                return ResponseCode::NETWORK_TCP_SETUP_ERROR;
+            }
+
+            // Don't leak the socket of a connection that was never disconnected
+            CloseLocked(engine_lock);
+
+            ResponseCode networkResponse = ResponseCode::SUCCESS;
+            if (nullptr == p_tls_context_ ||
+                !p_tls_context_->Matches(root_ca_location_, device_cert_location_, device_private_key_location_)) {
+                networkResponse = OpenSSLContext::Acquire(root_ca_location_, device_cert_location_,
+                                                          device_private_key_location_, p_tls_context_);
+                if (ResponseCode::SUCCESS != networkResponse) {
+                    p_tls_context_.reset();
+                    return networkResponse;
+                }
+            }
+
+            p_tls_engine_ = OpenSSLMemoryBIOEngine::Create(p_tls_context_->GetSSLContext(), IO_URING_BIO_BUFFER_SIZE);
+            if (nullptr == p_tls_engine_) {
+                return ResponseCode::NETWORK_SSL_INIT_ERROR;
+            }
+            SSL *p_ssl_handle = p_tls_engine_->GetSSLHandle();
+
+            if (server_verification_flag_) {
+                X509_VERIFY_PARAM *param = SSL_get0_param(p_ssl_handle);
+                X509_VERIFY_PARAM_set_hostflags(param, X509_CHECK_FLAG_NO_PARTIAL_WILDCARDS);
+
+                // Check if it is an IPv4 or an IPv6 address to enable ip checking
+                // Enable host name check otherwise
+                char dst[INET6_ADDRSTRLEN];
+                if (inet_pton(AF_INET, endpoint_.c_str(), (void *) dst) ||
+                    inet_pton(AF_INET6, endpoint_.c_str(), (void *) dst)) {
+                    X509_VERIFY_PARAM_set1_ip_asc(param, endpoint_.c_str());
+                } else {
+                    X509_VERIFY_PARAM_set1_host(param, endpoint_.c_str(), 0);
+                }
+            }
+            SSL_set_verify(p_ssl_handle, SSL_VERIFY_PEER, nullptr);
+
+            has_peer_closed_ = false;
+            socket_error_ = 0;
+
+            // TCP connect and handshake share a single deadline
+            std::chrono::steady_clock::time_point deadline =
+                std::chrono::steady_clock::now() + tls_handshake_timeout_;
+
+            networkResponse = ConnectTCPSocketLocked(engine_lock, deadline);
+            if (ResponseCode::SUCCESS != networkResponse) {
+                AWS_LOG_ERROR(IO_URING_WRAPPER_LOG_TAG, "TCP Connection error");
+                p_tls_engine_.reset();
+                return networkResponse;
+            }
+
+            networkResponse = HandshakeLocked(engine_lock, deadline);
+            if (ResponseCode::SUCCESS == networkResponse) {
+                if (X509_V_OK != SSL_get_verify_result(p_ssl_handle)) {
+                    AWS_LOG_ERROR(IO_URING_WRAPPER_LOG_TAG, " Server Certificate Verification failed.");
+                    networkResponse = ResponseCode::NETWORK_SSL_CONNECT_ERROR;
+                } else if (nullptr == SSL_get_peer_certificate(p_ssl_handle)) {
+                    // ensure you have a valid certificate returned, otherwise no certificate exchange happened
+                    AWS_LOG_ERROR(IO_URING_WRAPPER_LOG_TAG, " No certificate exchange happened");
+                    networkResponse = ResponseCode::NETWORK_SSL_CONNECT_ERROR;
+                }
+            }
+
+            if (ResponseCode::SUCCESS != networkResponse) {
+                CloseLocked(engine_lock);
+                return networkResponse;
+            }
+
+            is_connected_ = true;
+            return ResponseCode::SUCCESS;
+        }
+
+        ResponseCode IoUringConnection::WriteInternal(const util::String &buf, size_t &size_written_bytes_out) {
+            std::unique_lock<std::mutex> engine_lock(engine_mutex_);
+            if (!is_connected_ || nullptr == p_tls_engine_) {
+                return ResponseCode::NETWORK_DISCONNECTED_ERROR;
+            }
+
+            // Picks up finished sends without a system call
+            if (!is_reaping_) {
+                ProcessCompletionsLocked();
+            }
+
+            ResponseCode rc = ResponseCode::SUCCESS;
+            size_t total_written_length = 0;
+            std::chrono::steady_clock::time_point deadline;
+            bool has_waited = false;
+
+            while (total_written_length < buf.length()) {
+                if (0 != socket_error_) {
+                    rc = ResponseCode::NETWORK_SSL_WRITE_ERROR;
+                    break;
+                }
+
+                size_t cur_written_length = 0;
+                int ssl_error = p_tls_engine_->Write((const unsigned char *) buf.c_str() + total_written_length,
+                                                     buf.length() - total_written_length, cur_written_length);
+                if (SSL_ERROR_NONE == ssl_error) {
+                    total_written_length += cur_written_length;
+                    continue;
+                }
+                if (SSL_ERROR_WANT_WRITE != ssl_error && SSL_ERROR_WANT_READ != ssl_error) {
+                    rc = ResponseCode::NETWORK_SSL_WRITE_ERROR;
+                    break;
+                }
+
+                // The engine's outgoing buffer is full, wait for sends to drain it
+                QueueIOLocked();
+                if (!has_waited) {
+                    deadline = std::chrono::steady_clock::now() + tls_write_timeout_;
+                    has_waited = true;
+                }
+                if (!WaitForCompletionsLocked(engine_lock, deadline)) {
+                    rc = ResponseCode::NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+                    break;
+                }
+                if (nullptr == p_tls_engine_) {
+                    rc = ResponseCode::NETWORK_DISCONNECTED_ERROR;
+                    break;
+                }
+            }
+
+            if (ResponseCode::SUCCESS == rc) {
+                QueueIOLocked();
+                // Ciphertext queued behind a send in flight is chained by whichever thread reaps that send. If no
+                // thread is reaping, reap it here so it isn't left behind.
+                while (!is_reaping_ && is_send_in_flight_ && nullptr != p_tls_engine_ &&
+                    p_tls_engine_->GetOutgoingCiphertextLength() > send_in_flight_length_) {
+                    if (!has_waited) {
+                        deadline = std::chrono::steady_clock::now() + tls_write_timeout_;
+                        has_waited = true;
+                    }
+                    if (!WaitForCompletionsLocked(engine_lock, deadline)) {
+                        rc = ResponseCode::NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+                        break;
+                    }
+                }
+            }
+
+            if (ResponseCode::SUCCESS == rc) {
+                size_written_bytes_out = total_written_length;
+            }
+            return rc;
+        }
+
+        ResponseCode IoUringConnection::ReadInternal(util::Vector<unsigned char> &buf, size_t buf_read_offset,
+                                                     size_t size_bytes_to_read, size_t &size_read_bytes_out) {
+            std::unique_lock<std::mutex> engine_lock(engine_mutex_);
+            ResponseCode errorStatus = ResponseCode::SUCCESS;
+            size_t total_read_length = buf_read_offset;
+            size_t remaining_bytes_to_read = size_bytes_to_read;
+            std::chrono::steady_clock::time_point deadline;
+            bool has_waited = false;
+
+            while (0 < remaining_bytes_to_read) {
+                if (!is_connected_ || nullptr == p_tls_engine_) {
+                    errorStatus = ResponseCode::NETWORK_DISCONNECTED_ERROR;
+                    break;
+                }
+                if (!is_reaping_) {
+                    ProcessCompletionsLocked();
+                }
+
+                size_t cur_read_length = 0;
+                int ssl_error = p_tls_engine_->Read(&buf[total_read_length], remaining_bytes_to_read,
+                                                    cur_read_length);
+                if (SSL_ERROR_NONE == ssl_error) {
+                    total_read_length += cur_read_length;
+                    remaining_bytes_to_read -= cur_read_length;
+                    continue;
+                }
+
+                if (SSL_ERROR_WANT_READ == ssl_error || SSL_ERROR_WANT_WRITE == ssl_error) {
+                    if (has_peer_closed_) {
+                        errorStatus = ResponseCode::NETWORK_SSL_CONNECTION_CLOSED_ERROR;
+                        break;
+                    }
+                    if (0 != socket_error_) {
+                        errorStatus = ResponseCode::NETWORK_SSL_READ_ERROR;
+                        break;
+                    }
+                    QueueIOLocked();
+                    if (!has_waited) {
+                        deadline = std::chrono::steady_clock::now() + tls_read_timeout_;
+                        has_waited = true;
+                    }
+                    if (!WaitForCompletionsLocked(engine_lock, deadline)) {
+                        errorStatus = ResponseCode::NETWORK_SSL_NOTHING_TO_READ;
+                        break;
+                    }
+                } else if (SSL_ERROR_ZERO_RETURN == ssl_error || has_peer_closed_) {
+                    errorStatus = ResponseCode::NETWORK_SSL_CONNECTION_CLOSED_ERROR;
+                    break;
+                } else {
+                    errorStatus = ResponseCode::NETWORK_SSL_READ_ERROR;
+                    break;
+                }
+            }
+
+            if (ResponseCode::SUCCESS == errorStatus) {
+                size_read_bytes_out = total_read_length;
+            }
+            return errorStatus;
+        }
+
+        void *IoUringConnection::GetOperationData(Operation operation) const {
+            return (void *) ((operation_generation_ << IO_URING_OPERATION_BITS) | (uintptr_t) operation);
+        }
+
+        void IoUringConnection::CancelInFlightLocked() {
+            unsigned int queued_count = 0;
+            Operation operations[] = {Operation::SEND, Operation::RECV};
+            bool is_in_flight[] = {is_send_in_flight_, is_recv_in_flight_};
+            for (size_t itr = 0; itr < 2; itr++) {
+                struct io_uring_sqe *p_sqe = is_in_flight[itr] ? io_uring_get_sqe(&ring_) : nullptr;
+                if (nullptr != p_sqe) {
+                    io_uring_prep_cancel(p_sqe, GetOperationData(operations[itr]), 0);
+                    io_uring_sqe_set_data(p_sqe, GetOperationData(Operation::CANCEL));
+                    queued_count++;
+                }
+            }
+            if (0 < queued_count) {
+                io_uring_submit(&ring_);
+                submit_call_count_++;
+            }
+        }
+
+        void IoUringConnection::AbandonInFlightLocked() {
+            AWS_LOG_ERROR(IO_URING_WRAPPER_LOG_TAG, "Operations still outstanding after cancel, keeping their buffers");
+            if (is_send_in_flight_) {
+                // The kernel may still read the ciphertext out of the engine
+                AbandonedOperation abandoned_send;
+                abandoned_send.generation = operation_generation_;
+                abandoned_send.operation = Operation::SEND;
+                abandoned_send.p_tls_engine = std::move(p_tls_engine_);
+                abandoned_operations_.push_back(std::move(abandoned_send));
+            }
+            if (is_recv_in_flight_) {
+                // The kernel may still write into the receive buffer, the next connection gets a new one
+                AbandonedOperation abandoned_recv;
+                abandoned_recv.generation = operation_generation_;
+                abandoned_recv.operation = Operation::RECV;
+                abandoned_recv.recv_buffer.swap(recv_buffer_);
+                abandoned_operations_.push_back(std::move(abandoned_recv));
+                recv_buffer_.resize(IO_URING_RECV_BUFFER_SIZE);
+            }
+            // Their completions must not be taken for the next connection's operations
+            operation_generation_++;
+            is_send_in_flight_ = false;
+            send_in_flight_length_ = 0;
+            is_recv_in_flight_ = false;
+        }
+
+        void IoUringConnection::CloseLocked(std::unique_lock<std::mutex> &engine_lock) {
+            if (-1 != server_tcp_socket_fd_) {
+                // Stops QueueIOLocked() from queueing anything new
+                if (0 == socket_error_) {
+                    socket_error_ = ESHUTDOWN;
+                }
+                // Completes the outstanding receive and any stuck send
+                shutdown(server_tcp_socket_fd_, SHUT_RDWR);
+
+                // Sends point into the engine and receives into the receive buffer, neither can be freed before they
+                // completed
+                std::chrono::steady_clock::time_point deadline =
+                    std::chrono::steady_clock::now() + tls_write_timeout_;
+                while ((is_recv_in_flight_ || is_send_in_flight_) && WaitForCompletionsLocked(engine_lock, deadline)) {
+                }
+                if (is_recv_in_flight_ || is_send_in_flight_) {
+                    AWS_LOG_WARN(IO_URING_WRAPPER_LOG_TAG, "Operations still outstanding after socket shutdown");
+                    CancelInFlightLocked();
+                    deadline = std::chrono::steady_clock::now() + tls_write_timeout_;
+                    while ((is_recv_in_flight_ || is_send_in_flight_) &&
+                        WaitForCompletionsLocked(engine_lock, deadline)) {
+                    }
+                }
+                if (is_recv_in_flight_ || is_send_in_flight_) {
+                    AbandonInFlightLocked();
+                }
+
+                close(server_tcp_socket_fd_);
+                server_tcp_socket_fd_ = -1;
+            }
+            p_tls_engine_.reset();
+        }
+
+        ResponseCode IoUringConnection::DisconnectInternal() {
+            std::unique_lock<std::mutex> engine_lock(engine_mutex_);
+
+            if (is_connected_ && nullptr != p_tls_engine_) {
+                is_connected_ = false;
+
+                // Best effort close_notify
+                p_tls_engine_->Shutdown();
+                QueueIOLocked();
+                std::chrono::steady_clock::time_point deadline =
+                    std::chrono::steady_clock::now() + tls_write_timeout_;
+                while (0 == socket_error_ && nullptr != p_tls_engine_ &&
+                    (is_send_in_flight_ || 0 < p_tls_engine_->GetOutgoingCiphertextLength()) &&
+                    WaitForCompletionsLocked(engine_lock, deadline)) {
+                }
+            }
+            is_connected_ = false;
+            CloseLocked(engine_lock);
+
+            return ResponseCode::SUCCESS;
+        }
+
+        IoUringConnection::~IoUringConnection() {
+            if (is_connected_) {
+                Disconnect();
+            }
+            {
+                std::unique_lock<std::mutex> engine_lock(engine_mutex_);
+                CloseLocked(engine_lock);
+            }
+            if (is_ring_initialized_) {
+                io_uring_queue_exit(&ring_);
+            }
+            // Only now that the ring is gone can nothing write into or read from them anymore
+            abandoned_operations_.clear();
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file IoUringConnection.hpp
+ * @brief Defines a TLS connection driving its socket through io_uring
+ */
+
+#pragma once
+
+// Only built when selected, the default build doesn't link liburing
+#ifdef USE_IO_URING
+
+#include <liburing.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "NetworkConnection.hpp"
+#include "ResponseCode.hpp"
+#include "OpenSSLContext.hpp"
+#include "OpenSSLMemoryBIOEngine.hpp"
+
+namespace awsiotsdk {
+    namespace network {
+        /**
+         * @brief io_uring TLS connection
+         *
+         * TLS runs in an OpenSSLMemoryBIOEngine and the socket is only ever touched through io_uring. A receive is
+         * kept armed for as long as the connection is up, so incoming records land without a system call on the read
+         * path. Writes append ciphertext to the engine and submit a send together with any other queued operation in
+         * a single io_uring_enter. While a send is in flight, further writes are coalesced behind it and go out with
+         * the next send without a system call of their own.
+         *
+         * Read and write may be called from different threads. Whichever thread has to wait reaps completions for
+         * both, the other one waits to be woken up.
+         *
+         * Requires liburing and Linux 5.11 or newer.
+         */
+        class IoUringConnection : public NetworkConnection {
+        protected:
+            /**
+             * @brief Operations tagged in the submission user data
+             */
+            enum class Operation {
+                RECV = 1,           ///< Receive into the receive buffer
+                SEND = 2,           ///< Send straight out of the engine's outgoing buffer
+                CONNECT = 3,        ///< TCP connect
+                LINK_TIMEOUT = 4,   ///< Timeout linked to the TCP connect
+                CANCEL = 5          ///< Cancellation of a receive or send
+            };
+
+            /**
+             * @brief Memory a given up operation may still point into, kept until it completes
+             */
+            struct AbandonedOperation {
+                uintptr_t generation;                                   ///< Generation the operation was queued in
+                Operation operation;                                    ///< RECV or SEND
+                std::unique_ptr<OpenSSLMemoryBIOEngine> p_tls_engine;   ///< Engine the send reads from
+                util::Vector<unsigned char> recv_buffer;                ///< Buffer the receive writes into
+            };
+
+            util::String root_ca_location_;             ///< Pointer to string containing the filename (including path) of the root CA file.
+            util::String device_cert_location_;         ///< Pointer to string containing the filename (including path) of the device certificate.
+            util::String device_private_key_location_;  ///< Pointer to string containing the filename (including path) of the device private key file.
+            bool server_verification_flag_;             ///< Boolean.  True = perform server certificate hostname validation.  False = skip validation \b NOT recommended.
+            std::atomic_bool is_connected_;             ///< Boolean indicating connection status
+            std::chrono::milliseconds tls_handshake_timeout_;   ///< Timeout for TCP connect and TLS handshake together
+            std::chrono::milliseconds tls_read_timeout_;        ///< Timeout for the TLS Read command
+            std::chrono::milliseconds tls_write_timeout_;       ///< Timeout for the TLS Write command
+
+            // Endpoint information
+            uint16_t endpoint_port_;                    ///< Endpoint port
+            util::String endpoint_;                     ///< Endpoint for this connection
+
+            std::shared_ptr<OpenSSLContext> p_tls_context_;         ///< Shared SSL Context holding the parsed credentials
+            std::unique_ptr<OpenSSLMemoryBIOEngine> p_tls_engine_;  ///< TLS engine for the current connection
+            int server_tcp_socket_fd_;                  ///< Server Socket descriptor
+
+            // io_uring state, all protected by the engine mutex
+            struct io_uring ring_;                      ///< Submission and completion rings
+            bool is_ring_initialized_;                  ///< True once the ring was set up
+            std::mutex engine_mutex_;                   ///< Protects the TLS engine, the ring and the operation state
+            std::condition_variable engine_cv_;         ///< Signalled after completions were processed
+            bool is_reaping_;                           ///< True while a thread waits for completions without the mutex
+            bool is_recv_in_flight_;                    ///< A receive is queued
+            bool is_send_in_flight_;                    ///< A send is queued
+            size_t send_in_flight_length_;              ///< Length of the queued send, ciphertext past it is still unsent
+            bool is_connect_in_flight_;                 ///< A TCP connect is queued
+            int connect_result_;                        ///< Result of the last TCP connect
+            bool has_peer_closed_;                      ///< The peer closed its side of the socket
+            int socket_error_;                          ///< errno of the last failed receive or send, 0 if none
+            util::Vector<unsigned char> recv_buffer_;   ///< Receive buffer, copied into the engine once a receive completes
+            uintptr_t operation_generation_;            ///< Tags queued operations, completions of older ones are ignored
+            util::Vector<AbandonedOperation> abandoned_operations_; ///< Given up operations that haven't completed yet
+
+            // Statistics
+            std::atomic<uint64_t> submit_call_count_;   ///< Number of io_uring_submit calls, each one system call
+            std::atomic<uint64_t> completion_count_;    ///< Number of completions processed
+
+            /**
+             * @brief Queue a send of pending ciphertext and a receive if none are in flight, and submit them
+             *
+             * Must be called with the engine mutex held. Both operations go out in a single submit.
+             */
+            void QueueIOLocked();
+
+            /**
+             * @brief Process all available completions, must be called with the engine mutex held
+             */
+            void ProcessCompletionsLocked();
+
+            /**
+             * @brief Wait for at least one completion to be processed
+             *
+             * If no other thread is reaping, releases the mutex and waits on the completion ring, otherwise waits to be
+             * woken up by the reaping thread.
+             *
+             * @param std::unique_lock<std::mutex> - lock on the engine mutex
+             * @param std::chrono::steady_clock::time_point - deadline of the current operation
+             * @return bool - false if the deadline expired
+             */
+            bool WaitForCompletionsLocked(std::unique_lock<std::mutex> &engine_lock,
+                                          const std::chrono::steady_clock::time_point &deadline);
+
+            /**
+             * @brief Resolve the endpoint and connect to the first address that accepts
+             *
+             * @return ResponseCode - successful connection or TCP error
+             */
+            ResponseCode ConnectTCPSocketLocked(std::unique_lock<std::mutex> &engine_lock,
+                                                const std::chrono::steady_clock::time_point &deadline);
+
+            /**
+             * @brief Run the TLS handshake to completion
+             *
+             * @return ResponseCode - successful connection or TLS error
+             */
+            ResponseCode HandshakeLocked(std::unique_lock<std::mutex> &engine_lock,
+                                         const std::chrono::steady_clock::time_point &deadline);
+
+            /**
+             * @brief Get the user data of an operation queued now
+             *
+             * @param Operation operation - the operation
+             * @return void * - operation and current generation
+             */
+            void *GetOperationData(Operation operation) const;
+
+            /**
+             * @brief Queue a cancellation of the receive and send in flight, must be called with the engine mutex held
+             */
+            void CancelInFlightLocked();
+
+            /**
+             * @brief Give up on a receive or send the kernel didn't complete
+             *
+             * Must be called with the engine mutex held. The memory they point into moves to the abandoned operations
+             * and is freed when their completion arrives, or at the latest after the ring is gone. Moves on to a new
+             * operation generation, so their completions are never taken for the next connection's operations.
+             */
+            void AbandonInFlightLocked();
+
+            /**
+             * @brief Cancel outstanding operations, close the socket and free the engine
+             */
+            void CloseLocked(std::unique_lock<std::mutex> &engine_lock);
+
+            /**
+             * @brief Create a TLS socket and open the connection
+             *
+             * Creates an open socket connection including TLS handshake.
+             *
+             * @return ResponseCode - successful connection or TLS error
+             */
+            ResponseCode ConnectInternal();
+
+            /**
+             * @brief Write bytes to the network socket
+             *
+             * Returns once the data is encrypted and its send is queued.
+             *
+             * @param util::String - const reference to buffer which should be written to socket
+             * @return size_t - number of bytes written or Network error
+             * @return ResponseCode - successful write or Network error code
+             */
+            ResponseCode WriteInternal(const util::String &buf, size_t &size_written_bytes_out);
+
+            /**
+             * @brief Read bytes from the network socket
+             *
+             * @param util::String - reference to buffer where read bytes should be copied
+             * @param size_t - number of bytes to read
+             * @param size_t - reference to store number of bytes read
+             * @return ResponseCode - successful read or TLS error code
+             */
+            ResponseCode ReadInternal(util::Vector<unsigned char> &buf, size_t buf_read_offset,
+                                      size_t size_bytes_to_read, size_t &size_read_bytes_out);
+
+            /**
+             * @brief Disconnect from network socket
+             *
+             * @return ResponseCode - successful read or TLS error code
+             */
+            ResponseCode DisconnectInternal();
+
+        public:
+            /**
+             * @brief Constructor for the io_uring TLS implementation
+             *
+             * @param util::String endpoint - The target endpoint to connect to
+             * @param uint16_t endpoint_port - The port on the target to connect to
+             * @param util::String root_ca_location - Path of the location of the Root CA
+             * @param util::String device_cert_location - Path to the location of the Device Cert
+             * @param util::String device_private_key_location - Path to the location of the device private key file
+             * @param std::chrono::milliseconds tls_handshake_timeout - The value to use for timeout of handshake operation
+             * @param std::chrono::milliseconds tls_read_timeout - The value to use for timeout of read operation
+             * @param std::chrono::milliseconds tls_write_timeout - The value to use for timeout of write operation
+             * @param bool server_verification_flag - used to decide whether server verification is needed or not
+             *
+             */
+            IoUringConnection(util::String endpoint, uint16_t endpoint_port, util::String root_ca_location,
+                              util::String device_cert_location, util::String device_private_key_location,
+                              std::chrono::milliseconds tls_handshake_timeout,
+                              std::chrono::milliseconds tls_read_timeout, std::chrono::milliseconds tls_write_timeout,
+                              bool server_verification_flag);
+
+            /**
+             * @brief Initialize the OpenSSL library and the io_uring instance
+             *
+             * @return ResponseCode - successful operation, TLS init error or TCP setup error if io_uring is unavailable
+             */
+            ResponseCode Initialize();
+
+            /**
+             * @brief Check if TLS layer is still connected
+             *
+             * @return bool - indicating status of network TLS layer connection
+             */
+            bool IsConnected();
+
+            /**
+             * @brief Check if Network Physical layer is still connected
+             *
+             * @return bool - indicating status of network physical layer connection
+             */
+            bool IsPhysicalLayerConnected();
+
+            /**
+             * @brief Get the number of io_uring_submit calls made, each of which is one system call
+             *
+             * @return uint64_t - submit count
+             */
+            uint64_t GetSubmitCallCount() const { return submit_call_count_; }
+
+            /**
+             * @brief Get the number of completions processed
+             *
+             * @return uint64_t - completion count
+             */
+            uint64_t GetCompletionCount() const { return completion_count_; }
+
+            virtual ~IoUringConnection();
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLByteSpan.hpp
+ * @brief Defines non-owning views of byte ranges passed to and from the TLS layer
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include "util/memory/stl/String.hpp"
+#include "util/memory/stl/Vector.hpp"
+
+namespace awsiotsdk {
+    namespace network {
+        /**
+         * @brief Read-only view of bytes owned by someone else
+         *
+         * The bytes must stay valid and unchanged until the call the span was passed to has returned.
+         */
+        struct ByteSpan {
+            const unsigned char *p_data;    ///< First byte, may be nullptr if the length is 0
+            size_t length;                  ///< Number of bytes
+
+            ByteSpan() : p_data(nullptr), length(0) {}
+
+            ByteSpan(const void *p_bytes, size_t byte_count)
+                : p_data(static_cast<const unsigned char *>(p_bytes)), length(byte_count) {}
+
+            explicit ByteSpan(const util::String &str)
+                : p_data(reinterpret_cast<const unsigned char *>(str.data())), length(str.length()) {}
+        };
+
+        /**
+         * @brief Writable view of bytes owned by someone else
+         */
+        struct MutableByteSpan {
+            unsigned char *p_data;          ///< First byte, may be nullptr if the length is 0
+            size_t length;                  ///< Number of bytes
+
+            MutableByteSpan() : p_data(nullptr), length(0) {}
+
+            MutableByteSpan(void *p_bytes, size_t byte_count)
+                : p_data(static_cast<unsigned char *>(p_bytes)), length(byte_count) {}
+
+            /**
+             * @brief View of part of a vector, the range must lie within the vector's current size
+             *
+             * @param util::Vector<unsigned char> buf - vector to view
+             * @param size_t offset - index of the first byte
+             * @param size_t byte_count - number of bytes
+             */
+            MutableByteSpan(util::Vector<unsigned char> &buf, size_t offset, size_t byte_count)
+                : p_data(buf.empty() ? nullptr : &buf[0] + offset), length(byte_count) {}
+        };
+    }
+}
@@ -19,7 +19,10 @@
  *
  */
 
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <util/memory/stl/Vector.hpp>
 
 #include "OpenSSLConnection.hpp"
@@ -37,8 +40,119 @@
 
 #define OPENSSL_WRAPPER_LOG_TAG "[OpenSSL Wrapper]"
 
+// Large enough to hold one full TLS record of plaintext
+#define OPENSSL_DEFAULT_READ_AHEAD_BUFFER_SIZE 16384
+#define OPENSSL_DEFAULT_DNS_CACHE_TTL_SECS 60
+// Delay before racing the next address candidate, see RFC 8305
+#define OPENSSL_CONNECTION_ATTEMPT_DELAY_MSECS 250
+// Maximum plaintext carried by a single TLS record
+#define OPENSSL_MAX_RECORD_PLAINTEXT_LENGTH 16384
+// Record size used in lean mode, must match the TLSEXT_max_fragment_length_* value requested
+#define OPENSSL_LEAN_MAX_FRAGMENT_LENGTH 4096
+// Largest TLS record on the wire, header and expansion included
+#define OPENSSL_MAX_RECORD_CIPHERTEXT_LENGTH (16384 + 2048 + 5)
+#define OPENSSL_DEFAULT_MEMORY_BIO_BUFFER_SIZE 65536
+// First line of the session cache file, "<host>:<port>", longest DNS name plus port and newline
+#define OPENSSL_SESSION_CACHE_HEADER_LENGTH 272
+
 namespace awsiotsdk {
     namespace network {
+        namespace {
+            struct ResolvedAddress {
+                sockaddr_storage address;
+                socklen_t address_length;
+            };
+
+            struct ResolvedEndpoint {
+                util::Vector<ResolvedAddress> addresses;
+                std::chrono::steady_clock::time_point resolved_at;
+            };
+
+            std::mutex dns_cache_mutex;
+            std::map<util::String, ResolvedEndpoint> dns_cache;
+
+            void CloseSocket(int socket_fd) {
+#ifdef WIN32
+                closesocket(socket_fd);
+#else
+                close(socket_fd);
+#endif
+            }
+
+            ResponseCode ResolveEndpoint(const util::String &endpoint, uint16_t endpoint_port,
+                                         std::chrono::seconds dns_cache_ttl,
+                                         util::Vector<ResolvedAddress> &addresses_out) {
+                util::String port_str = std::to_string(endpoint_port);
+                util::String cache_key = endpoint + ":" + port_str;
+
+                if (0 < dns_cache_ttl.count()) {
+                    std::lock_guard<std::mutex> cache_guard(dns_cache_mutex);
+                    std::map<util::String, ResolvedEndpoint>::iterator itr = dns_cache.find(cache_key);
+                    if (dns_cache.end() != itr &&
+                        std::chrono::steady_clock::now() - itr->second.resolved_at < dns_cache_ttl) {
+                        addresses_out = itr->second.addresses;
+                        return ResponseCode::SUCCESS;
+                    }
+                }
+
+                struct addrinfo hints;
+                struct addrinfo *p_result = nullptr;
+                memset(&hints, 0, sizeof(hints));
+                hints.ai_family = AF_UNSPEC;
+                hints.ai_socktype = SOCK_STREAM;
+                hints.ai_flags = AI_ADDRCONFIG;
+
+                int gai_status = getaddrinfo(endpoint.c_str(), port_str.c_str(), &hints, &p_result);
+                if (0 != gai_status || nullptr == p_result) {
+                    AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "getaddrinfo - %s", gai_strerror(gai_status));
+                    return ResponseCode::NETWORK_TCP_NO_ENDPOINT_SPECIFIED;
+                }
+
+                // Interleave address families, starting with the resolver's preferred one (RFC 8305 section 4)
+                util::Vector<ResolvedAddress> preferred_family;
+                util::Vector<ResolvedAddress> other_family;
+                for (struct addrinfo *p_info = p_result; nullptr != p_info; p_info = p_info->ai_next) {
+                    if (p_info->ai_addrlen > sizeof(sockaddr_storage)) {
+                        continue;
+                    }
+                    ResolvedAddress resolved_address;
+                    memset(&resolved_address.address, 0, sizeof(resolved_address.address));
+                    memcpy(&resolved_address.address, p_info->ai_addr, p_info->ai_addrlen);
+                    resolved_address.address_length = static_cast<socklen_t>(p_info->ai_addrlen);
+                    if (p_info->ai_family == p_result->ai_family) {
+                        preferred_family.push_back(resolved_address);
+                    } else {
+                        other_family.push_back(resolved_address);
+                    }
+                }
+                freeaddrinfo(p_result);
+
+                addresses_out.clear();
+                for (size_t itr = 0; itr < std::max(preferred_family.size(), other_family.size()); itr++) {
+                    if (itr < preferred_family.size()) {
+                        addresses_out.push_back(preferred_family[itr]);
+                    }
+                    if (itr < other_family.size()) {
+                        addresses_out.push_back(other_family[itr]);
+                    }
+                }
+
+                if (0 < dns_cache_ttl.count()) {
+                    std::lock_guard<std::mutex> cache_guard(dns_cache_mutex);
+                    ResolvedEndpoint &cache_entry = dns_cache[cache_key];
+                    cache_entry.addresses = addresses_out;
+                    cache_entry.resolved_at = std::chrono::steady_clock::now();
+                }
+
+                return ResponseCode::SUCCESS;
+            }
+
+            void InvalidateResolvedEndpoint(const util::String &endpoint, uint16_t endpoint_port) {
+                std::lock_guard<std::mutex> cache_guard(dns_cache_mutex);
+                dns_cache.erase(endpoint + ":" + std::to_string(endpoint_port));
+            }
+        }
+
         OpenSSLConnection::OpenSSLConnection(util::String endpoint, uint16_t endpoint_port,
                                              std::chrono::milliseconds tls_handshake_timeout,
                                              std::chrono::milliseconds tls_read_timeout,
@@ -47,14 +161,41 @@ namespace awsiotsdk {
             endpoint_ = endpoint;
             endpoint_port_ = endpoint_port;
             server_verification_flag_ = server_verification_flag;
-            int timeout_ms = static_cast<int>(tls_handshake_timeout.count());
-            tls_handshake_timeout_ = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
-            timeout_ms = static_cast<int>(tls_read_timeout.count());
-            tls_read_timeout_ = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
-            timeout_ms = static_cast<int>(tls_write_timeout.count());
-            tls_write_timeout_ = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+            tls_handshake_timeout_ = tls_handshake_timeout;
+            tls_read_timeout_ = tls_read_timeout;
+            tls_write_timeout_ = tls_write_timeout;
+            stats_dump_interval_ = std::chrono::seconds(0);
+            is_stats_dump_thread_running_ = false;
 
             is_connected_ = false;
+            server_tcp_socket_fd_ = -1;
+            epoll_read_fd_ = -1;
+            epoll_write_fd_ = -1;
+            dns_cache_ttl_ = std::chrono::seconds(OPENSSL_DEFAULT_DNS_CACHE_TTL_SECS);
+            socket_tuning_ = OpenSSLSocketTuning::ForProfile(OpenSSLSocketTuning::Profile::SYSTEM_DEFAULT);
+            write_cork_window_ = std::chrono::microseconds(0);
+            kernel_tls_enabled_ = false;
+            lean_mode_enabled_ = false;
+            memory_bio_engine_enabled_ = false;
+            memory_bio_buffer_size_ = OPENSSL_DEFAULT_MEMORY_BIO_BUFFER_SIZE;
+            has_ciphertext_eof_ = false;
+            cork_flush_status_ = ResponseCode::SUCCESS;
+            is_cork_flush_thread_running_ = false;
+            is_reactor_attached_ = false;
+            inbound_status_ = ResponseCode::SUCCESS;
+            is_inbound_paused_ = false;
+
+            read_ahead_buffer_size_ = OPENSSL_DEFAULT_READ_AHEAD_BUFFER_SIZE;
+            read_ahead_start_ = 0;
+            read_ahead_end_ = 0;
+            read_ahead_allocated_bytes_ = 0;
+
+            p_ssl_handle_ = nullptr;
+            p_ssl_session_ = nullptr;
+            last_handshake_duration_usecs_ = 0;
+
+            early_data_enabled_ = false;
+            is_early_data_pending_ = false;
         }
 
         OpenSSLConnection::OpenSSLConnection(util::String endpoint,
@@ -112,81 +253,469 @@ namespace awsiotsdk {
             }
 #endif
 
-            const SSL_METHOD *method;
+            return OpenSSLContext::InitializeLibrary();
+        }
+
+        bool OpenSSLConnection::IsPhysicalLayerConnected() {
+            // Use this to add implementation which can check for physical layer disconnect
+            return true;
+        }
 
-            OpenSSL_add_all_algorithms();
-            ERR_load_BIO_strings();
-            ERR_load_crypto_strings();
-            SSL_load_error_strings();
+        bool OpenSSLConnection::IsConnected() {
+            return is_connected_;
+        }
 
-            if (SSL_library_init() < 0) {
+        ResponseCode OpenSSLConnection::ApplyCipherPreferences() {
+            if (0 < tls_cipher_list_.length() && 1 != SSL_set_cipher_list(p_ssl_handle_, tls_cipher_list_.c_str())) {
+                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " Unsupported cipher list %s", tls_cipher_list_.c_str());
+                return ResponseCode::NETWORK_SSL_INIT_ERROR;
+            }
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+            if (0 < tls_ciphersuites_.length() && 1 != SSL_set_ciphersuites(p_ssl_handle_, tls_ciphersuites_.c_str())) {
+                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " Unsupported ciphersuites %s", tls_ciphersuites_.c_str());
+                return ResponseCode::NETWORK_SSL_INIT_ERROR;
+            }
+#else
+            if (0 < tls_ciphersuites_.length()) {
+                AWS_LOG_WARN(OPENSSL_WRAPPER_LOG_TAG, "TLS 1.3 ciphersuites require OpenSSL 1.1.1, ignoring them");
+            }
+#endif
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+            if (0 < tls_groups_.length() && 1 != SSL_set1_groups_list(p_ssl_handle_, tls_groups_.c_str())) {
+#else
+            if (0 < tls_groups_.length() && 1 != SSL_set1_curves_list(p_ssl_handle_, tls_groups_.c_str())) {
+#endif
+                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " Unsupported groups %s", tls_groups_.c_str());
                 return ResponseCode::NETWORK_SSL_INIT_ERROR;
             }
+            return ResponseCode::SUCCESS;
+        }
+
+        util::String OpenSSLConnection::GetNegotiatedCipher() {
+            util::String negotiated_cipher;
+            if (nullptr == p_ssl_handle_ || !SSL_is_init_finished(p_ssl_handle_)) {
+                return negotiated_cipher;
+            }
+            negotiated_cipher.append(SSL_get_version(p_ssl_handle_));
+            negotiated_cipher.append(" ");
+            negotiated_cipher.append(SSL_get_cipher_name(p_ssl_handle_));
+            return negotiated_cipher;
+        }
 
-            method = TLSv1_2_method();
+        bool OpenSSLConnection::IsKernelTLSSendActive() {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+            return nullptr != p_ssl_handle_ && BIO_get_ktls_send(SSL_get_wbio(p_ssl_handle_));
+#else
+            return false;
+#endif
+        }
 
-            if ((p_ssl_context_ = SSL_CTX_new(method)) == NULL) {
-                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " SSL INIT Failed - Unable to create SSL Context");
-                return ResponseCode::NETWORK_SSL_INIT_ERROR;
+        bool OpenSSLConnection::IsKernelTLSReceiveActive() {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+            return nullptr != p_ssl_handle_ && BIO_get_ktls_recv(SSL_get_rbio(p_ssl_handle_));
+#else
+            return false;
+#endif
+        }
+
+        std::chrono::microseconds OpenSSLConnection::GetTcpRtt() {
+#ifdef __linux__
+            struct tcp_info info;
+            socklen_t info_length = sizeof(info);
+            if (-1 != server_tcp_socket_fd_ &&
+                0 == getsockopt(server_tcp_socket_fd_, IPPROTO_TCP, TCP_INFO, &info, &info_length)) {
+                return std::chrono::microseconds(info.tcpi_rtt);
             }
+#endif
+            return std::chrono::microseconds(0);
+        }
 
-            return ResponseCode::SUCCESS;
+        void OpenSSLConnection::ReportTransportError(ResponseCode rc) {
+            // Read timeouts are normal on an idle MQTT connection, anything else means the connection is gone
+            if (nullptr != p_endpoint_pool_ &&
+                (ResponseCode::NETWORK_SSL_READ_ERROR == rc ||
+                 ResponseCode::NETWORK_SSL_CONNECTION_CLOSED_ERROR == rc ||
+                 ResponseCode::NETWORK_SSL_WRITE_ERROR == rc ||
+                 ResponseCode::NETWORK_SSL_WRITE_TIMEOUT_ERROR == rc)) {
+                p_endpoint_pool_->ReportFailure(endpoint_, endpoint_port_);
+            }
         }
 
-        bool OpenSSLConnection::IsPhysicalLayerConnected() {
-            // Use this to add implementation which can check for physical layer disconnect
-            return true;
+        bool OpenSSLConnection::IsSessionReused() {
+            return nullptr != p_ssl_handle_ && 1 == SSL_session_reused(p_ssl_handle_);
         }
 
-        bool OpenSSLConnection::IsConnected() {
-            return is_connected_;
+        void OpenSSLConnection::ClearCachedSession() {
+            if (nullptr != p_ssl_session_) {
+                SSL_SESSION_free(p_ssl_session_);
+                p_ssl_session_ = nullptr;
+            }
+            ssl_session_endpoint_.clear();
+        }
+
+        void OpenSSLConnection::LoadPersistedSession() {
+            FILE *session_file = fopen(ssl_session_cache_path_.c_str(), "r");
+            if (nullptr == session_file) {
+                return;
+            }
+
+            // Only resume against the endpoint and port the session was negotiated with
+            util::String session_endpoint = endpoint_ + ":" + std::to_string(endpoint_port_);
+            char header[OPENSSL_SESSION_CACHE_HEADER_LENGTH];
+            if (nullptr == fgets(header, sizeof(header), session_file) ||
+                session_endpoint + "\n" != header) {
+                fclose(session_file);
+                return;
+            }
+
+            SSL_SESSION *p_session = PEM_read_SSL_SESSION(session_file, nullptr, nullptr, nullptr);
+            fclose(session_file);
+            if (nullptr == p_session) {
+                AWS_LOG_WARN(OPENSSL_WRAPPER_LOG_TAG, "Ignoring unreadable TLS session cache %s",
+                             ssl_session_cache_path_.c_str());
+                return;
+            }
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+            // The SNI the session was negotiated with, if any, has to match as well
+            const char *session_host = SSL_SESSION_get0_hostname(p_session);
+            if (nullptr != session_host && endpoint_ != session_host) {
+                SSL_SESSION_free(p_session);
+                return;
+            }
+#endif
+
+            ClearCachedSession();
+            p_ssl_session_ = p_session;
+            ssl_session_endpoint_ = session_endpoint;
+        }
+
+        void OpenSSLConnection::UpdateCachedSession() {
+            if (nullptr == p_ssl_handle_) {
+                return;
+            }
+
+            SSL_SESSION *p_session = SSL_get1_session(p_ssl_handle_);
+            if (nullptr == p_session) {
+                return;
+            }
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+            if (!SSL_SESSION_is_resumable(p_session)) {
+                SSL_SESSION_free(p_session);
+                return;
+            }
+#endif
+            if (p_session == p_ssl_session_) {
+                // Nothing new to cache
+                SSL_SESSION_free(p_session);
+                return;
+            }
+
+            ClearCachedSession();
+            p_ssl_session_ = p_session;
+            ssl_session_endpoint_ = endpoint_ + ":" + std::to_string(endpoint_port_);
+
+            if (0 == ssl_session_cache_path_.length()) {
+                return;
+            }
+
+            // Write to a temporary file first so a crash never leaves a truncated cache behind
+            util::String temp_path = ssl_session_cache_path_ + ".tmp";
+#ifdef WIN32
+            FILE *session_file = fopen(temp_path.c_str(), "w");
+#else
+            FILE *session_file = nullptr;
+            int session_fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+            if (-1 != session_fd) {
+                session_file = fdopen(session_fd, "w");
+                if (nullptr == session_file) {
+                    close(session_fd);
+                }
+            }
+#endif
+            if (nullptr == session_file) {
+                AWS_LOG_WARN(OPENSSL_WRAPPER_LOG_TAG, "Unable to write TLS session cache %s", temp_path.c_str());
+                return;
+            }
+
+            int write_status = 0;
+            if (0 <= fprintf(session_file, "%s\n", ssl_session_endpoint_.c_str())) {
+                write_status = PEM_write_SSL_SESSION(session_file, p_ssl_session_);
+            }
+            fclose(session_file);
+            if (1 != write_status || 0 != rename(temp_path.c_str(), ssl_session_cache_path_.c_str())) {
+                AWS_LOG_WARN(OPENSSL_WRAPPER_LOG_TAG, "Unable to write TLS session cache %s",
+                             ssl_session_cache_path_.c_str());
+                remove(temp_path.c_str());
+            }
         }
 
-        ResponseCode OpenSSLConnection::ConnectTCPSocket() {
+        ResponseCode OpenSSLConnection::ConnectTCPSocket(const std::chrono::steady_clock::time_point &deadline) {
             const char *endpoint_char = endpoint_.c_str();
             if (nullptr == endpoint_char) {
                 return ResponseCode::NETWORK_TCP_NO_ENDPOINT_SPECIFIED;
             }
 
-            hostent *host = gethostbyname(endpoint_char);
-            if (nullptr == host) {
-                return ResponseCode::NETWORK_TCP_NO_ENDPOINT_SPECIFIED;
+            util::Vector<ResolvedAddress> addresses;
+            ResponseCode ret_val = ResolveEndpoint(endpoint_, endpoint_port_, dns_cache_ttl_, addresses);
+            if (ResponseCode::SUCCESS != ret_val) {
+                return ret_val;
+            }
+
+            const std::chrono::milliseconds attempt_delay(OPENSSL_CONNECTION_ATTEMPT_DELAY_MSECS);
+            std::chrono::steady_clock::time_point next_attempt_at = std::chrono::steady_clock::now();
+            util::Vector<struct pollfd> pending_attempts;
+            size_t next_address = 0;
+
+            server_tcp_socket_fd_ = -1;
+            while (-1 == server_tcp_socket_fd_) {
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if (now >= deadline) {
+                    AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "TCP connect timed out");
+                    break;
+                }
+
+                // Start the next candidate once the previous one had its head start, or right away if none is left
+                if (next_address < addresses.size() && (pending_attempts.empty() || now >= next_attempt_at)) {
+                    const ResolvedAddress &candidate = addresses[next_address++];
+                    next_attempt_at = now + attempt_delay;
+
+                    int socket_fd = static_cast<int>(socket(candidate.address.ss_family, SOCK_STREAM, 0));
+                    if (-1 == socket_fd) {
+                        continue;
+                    }
+                    if (ResponseCode::SUCCESS != SetSocketToNonBlocking(socket_fd)) {
+                        CloseSocket(socket_fd);
+                        continue;
+                    }
+                    // Best effort, options the platform rejects are logged and the connection goes ahead without them
+                    socket_tuning_.Apply(socket_fd);
+
+                    int connect_status = connect(socket_fd, (const sockaddr *) &candidate.address,
+                                                 candidate.address_length);
+                    if (0 == connect_status) {
+                        server_tcp_socket_fd_ = socket_fd;
+                        break;
+                    }
+#ifdef WIN32
+                    bool in_progress = (WSAEWOULDBLOCK == WSAGetLastError());
+#else
+                    bool in_progress = (EINPROGRESS == errno);
+#endif
+                    if (!in_progress) {
+                        CloseSocket(socket_fd);
+                        continue;
+                    }
+
+                    struct pollfd attempt;
+                    attempt.fd = socket_fd;
+                    attempt.events = POLLOUT;
+                    attempt.revents = 0;
+                    pending_attempts.push_back(attempt);
+                    continue;
+                }
+
+                if (pending_attempts.empty()) {
+                    // Every candidate failed
+                    break;
+                }
+
+                std::chrono::steady_clock::time_point wait_until = deadline;
+                if (next_address < addresses.size()) {
+                    wait_until = std::min(deadline, next_attempt_at);
+                }
+                int timeout_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    wait_until - now).count()) + 1;
+#ifdef WIN32
+                int poll_status = WSAPoll(&pending_attempts[0], (ULONG) pending_attempts.size(), timeout_ms);
+#else
+                int poll_status = poll(&pending_attempts[0], (nfds_t) pending_attempts.size(), timeout_ms);
+#endif
+                if (0 > poll_status) {
+                    if (EINTR == errno) {
+                        continue;
+                    }
+                    AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "poll - %s", strerror(errno));
+                    break;
+                }
+
+                for (size_t itr = 0; itr < pending_attempts.size();) {
+                    if (0 == pending_attempts[itr].revents) {
+                        itr++;
+                        continue;
+                    }
+                    int socket_error = 0;
+                    socklen_t socket_error_length = sizeof(socket_error);
+                    if (0 == getsockopt(pending_attempts[itr].fd, SOL_SOCKET, SO_ERROR,
+                                        (char *) &socket_error, &socket_error_length) && 0 == socket_error) {
+                        server_tcp_socket_fd_ = pending_attempts[itr].fd;
+                        pending_attempts.erase(pending_attempts.begin() + itr);
+                        break;
+                    }
+                    CloseSocket(pending_attempts[itr].fd);
+                    pending_attempts.erase(pending_attempts.begin() + itr);
+                    // Don't hold back the next candidate behind one that already failed
+                    next_attempt_at = now;
+                }
+            }
+
+            // Abandon the attempts that lost the race
+            for (size_t itr = 0; itr < pending_attempts.size(); itr++) {
+                CloseSocket(pending_attempts[itr].fd);
+            }
+
+            if (-1 == server_tcp_socket_fd_) {
+                // Addresses may be stale, resolve again on the next attempt
+                InvalidateResolvedEndpoint(endpoint_, endpoint_port_);
+                return ResponseCode::NETWORK_TCP_CONNECT_ERROR;
             }
 
-            ResponseCode ret_val = ResponseCode::NETWORK_TCP_CONNECT_ERROR;
-            sockaddr_in dest_addr;
+            return ResponseCode::SUCCESS;
+        }
+
+        ResponseCode OpenSSLConnection::SetupSocketReadiness() {
+#ifdef __linux__
+            CloseSocketReadiness();
 
-            dest_addr.sin_family = AF_INET;
-            dest_addr.sin_port = htons(endpoint_port_);
-            dest_addr.sin_addr.s_addr = *(uint32_t *) (host->h_addr);
-            memset(&(dest_addr.sin_zero), '\0', 8);
+            // One instance per direction. The read thread and a writer blocked on WANT_WRITE wait at the same time,
+            // a shared instance would hand one of them the other's event. Level-triggered, so a wakeup is never
+            // used up before the waiter for it gets to see it. The TLS loops only wait after EAGAIN, so this doesn't
+            // spin.
+            int *p_epoll_fds[] = {&epoll_read_fd_, &epoll_write_fd_};
+            const uint32_t events[] = {EPOLLIN | EPOLLRDHUP, EPOLLOUT};
+            for (size_t itr = 0; itr < 2; itr++) {
+                *p_epoll_fds[itr] = epoll_create1(EPOLL_CLOEXEC);
+                if (-1 == *p_epoll_fds[itr]) {
+                    AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "epoll_create1 - %s", strerror(errno));
+                    CloseSocketReadiness();
+                    return ResponseCode::NETWORK_TCP_SETUP_ERROR;
+                }
+
+                struct epoll_event event;
+                memset(&event, 0, sizeof(event));
+                event.events = events[itr];
+                event.data.fd = server_tcp_socket_fd_;
+                if (-1 == epoll_ctl(*p_epoll_fds[itr], EPOLL_CTL_ADD, server_tcp_socket_fd_, &event)) {
+                    AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "epoll_ctl - %s", strerror(errno));
+                    CloseSocketReadiness();
+                    return ResponseCode::NETWORK_TCP_SETUP_ERROR;
+                }
+            }
+#endif
+            return ResponseCode::SUCCESS;
+        }
 
-            int connect_status = connect(server_tcp_socket_fd_, (sockaddr *) &dest_addr, sizeof(sockaddr));
-            if (-1 != connect_status) {
-                ret_val = ResponseCode::SUCCESS;
+        void OpenSSLConnection::CloseSocketReadiness() {
+#ifdef __linux__
+            if (-1 != epoll_read_fd_) {
+                close(epoll_read_fd_);
+                epoll_read_fd_ = -1;
+            }
+            if (-1 != epoll_write_fd_) {
+                close(epoll_write_fd_);
+                epoll_write_fd_ = -1;
             }
+#endif
+        }
 
-            return ret_val;
+        int OpenSSLConnection::WaitForSocket(bool wait_for_write,
+                                             const std::chrono::steady_clock::time_point &deadline) {
+            std::chrono::steady_clock::time_point wait_start = std::chrono::steady_clock::now();
+            int ready_count = WaitForSocketReadiness(wait_for_write, deadline);
+            stats_.RecordLatency(OpenSSLConnectionStats::Latency::SOCKET_WAIT,
+                                 std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now() - wait_start), 0 == ready_count);
+            return ready_count;
+        }
+
+        int OpenSSLConnection::WaitForSocketReadiness(bool wait_for_write,
+                                                      const std::chrono::steady_clock::time_point &deadline) {
+            int ready_count = 0;
+#ifdef __linux__
+            int epoll_fd = wait_for_write ? epoll_write_fd_ : epoll_read_fd_;
+            struct epoll_event event;
+
+            for (;;) {
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if (now >= deadline) {
+                    return 0;
+                }
+                // Round up so we never wake just before the deadline and spin on a zero timeout
+                int timeout_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - now + std::chrono::microseconds(999)).count());
+                ready_count = epoll_wait(epoll_fd, &event, 1, timeout_ms);
+                if (0 > ready_count) {
+                    if (EINTR == errno) {
+                        continue;
+                    }
+                    return -1;
+                }
+                if (0 < ready_count) {
+                    return ready_count;
+                }
+            }
+#else
+            fd_set fds;
+            do {
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if (now >= deadline) {
+                    return 0;
+                }
+                std::chrono::microseconds remaining =
+                    std::chrono::duration_cast<std::chrono::microseconds>(deadline - now);
+                struct timeval timeout;
+                timeout.tv_sec = static_cast<long>(remaining.count() / 1000000);
+                timeout.tv_usec = static_cast<long>(remaining.count() % 1000000);
+                FD_ZERO(&fds);
+                FD_SET(server_tcp_socket_fd_, &fds);
+                if (wait_for_write) {
+                    ready_count = select(server_tcp_socket_fd_ + 1, NULL, &fds, NULL, &timeout);
+                } else {
+                    ready_count = select(server_tcp_socket_fd_ + 1, &fds, NULL, NULL, &timeout);
+                }
+            } while (0 == ready_count);
+            return ready_count;
+#endif
+        }
+
+        void OpenSSLConnection::RecordBlockingOperation(OperationType operation,
+                                                        const std::chrono::steady_clock::time_point &start,
+                                                        bool timed_out) {
+            stats_.RecordLatency(static_cast<OpenSSLConnectionStats::Latency>(operation),
+                                 std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now() - start), timed_out);
+        }
+
+        void OpenSSLConnection::CountRecordCallback(int write_p, int version, int content_type, const void *buf,
+                                                    size_t len, SSL *ssl, void *arg) {
+#ifdef SSL3_RT_HEADER
+            // Called with the header of every record, plus once per handshake message and alert, which are ignored
+            if (SSL3_RT_HEADER == content_type) {
+                static_cast<OpenSSLConnection *>(arg)->stats_.Increment(
+                    write_p ? OpenSSLConnectionStats::Counter::RECORDS_WRITTEN
+                            : OpenSSLConnectionStats::Counter::RECORDS_READ);
+            }
+#endif
         }
 
-        ResponseCode OpenSSLConnection::SetSocketToNonBlocking() {
+        ResponseCode OpenSSLConnection::SetSocketToNonBlocking(int socket_fd) {
             int status;
             ResponseCode ret_val = ResponseCode::SUCCESS;
 #if defined(WIN32) || defined(WIN64)
             u_long flag = 1L;
-            status = ioctlsocket(server_tcp_socket_fd_, FIONBIO, &flag);
+            status = ioctlsocket(socket_fd, FIONBIO, &flag);
             if (0 > status) {
                 AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "ioctlsocket - %s", strerror(errno));
                 ret_val = ResponseCode::NETWORK_TCP_CONNECT_ERROR;
             }
 #else
-            int flags = fcntl(server_tcp_socket_fd_, F_GETFL, 0);
+            int flags = fcntl(socket_fd, F_GETFL, 0);
             // set underlying socket to non blocking
             if (0 > flags) {
                 ret_val = ResponseCode::NETWORK_TCP_CONNECT_ERROR;
             }
 
-            status = fcntl(server_tcp_socket_fd_, F_SETFL, flags | O_NONBLOCK);
+            status = fcntl(socket_fd, F_SETFL, flags | O_NONBLOCK);
             if (0 > status) {
                 AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "fcntl - %s", strerror(errno));
                 ret_val = ResponseCode::NETWORK_TCP_CONNECT_ERROR;
@@ -196,18 +725,134 @@ namespace awsiotsdk {
             return ret_val;
         }
 
-        ResponseCode OpenSSLConnection::AttemptConnect() {
+        int OpenSSLConnection::WaitForTLSProgress(bool wait_for_write,
+                                                  const std::chrono::steady_clock::time_point &deadline) {
+            stats_.Increment(wait_for_write ? OpenSSLConnectionStats::Counter::WANT_WRITE_WAITS
+                                            : OpenSSLConnectionStats::Counter::WANT_READ_WAITS);
+            if (nullptr == p_tls_engine_) {
+                return WaitForSocket(wait_for_write, deadline);
+            }
+
+            if (wait_for_write) {
+                // The BIO pair is full, make room by sending what it holds
+                bool has_waited = false;
+                ResponseCode rc = FlushOutgoingCiphertext(deadline, has_waited);
+                if (ResponseCode::SUCCESS == rc) {
+                    return 1;
+                }
+                return ResponseCode::NETWORK_SSL_WRITE_TIMEOUT_ERROR == rc ? 0 : -1;
+            }
+
+            for (;;) {
+                int received = ReceiveIncomingCiphertext();
+                if (0 != received) {
+                    return received;
+                }
+                int select_retCode = WaitForSocket(false, deadline);
+                if (0 >= select_retCode) {
+                    return select_retCode;
+                }
+            }
+        }
+
+        ResponseCode OpenSSLConnection::FlushOutgoingCiphertext(const std::chrono::steady_clock::time_point &deadline,
+                                                                bool &waited_out) {
+            while (0 < p_tls_engine_->GetOutgoingCiphertextLength()) {
+                const char *p_data = nullptr;
+                size_t length = p_tls_engine_->PeekOutgoingCiphertext(&p_data);
+#ifdef MSG_NOSIGNAL
+                ssize_t sent_length = send(server_tcp_socket_fd_, p_data, length, MSG_NOSIGNAL);
+#else
+                ssize_t sent_length = send(server_tcp_socket_fd_, p_data, length, 0);
+#endif
+                stats_.Increment(OpenSSLConnectionStats::Counter::CIPHERTEXT_SENDS);
+                if (0 < sent_length) {
+                    p_tls_engine_->ConsumeOutgoingCiphertext((size_t) sent_length);
+                    continue;
+                }
+                if (-1 == sent_length && EINTR == errno) {
+                    continue;
+                }
+                if (-1 == sent_length && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+                    waited_out = true;
+                    int select_retCode = WaitForSocket(true, deadline);
+                    if (0 == select_retCode) {
+                        return ResponseCode::NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+                    } else if (-1 == select_retCode) {
+                        return ResponseCode::NETWORK_SSL_WRITE_ERROR;
+                    }
+                    continue;
+                }
+                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "send - %s", strerror(errno));
+                return ResponseCode::NETWORK_SSL_WRITE_ERROR;
+            }
+            return ResponseCode::SUCCESS;
+        }
+
+        int OpenSSLConnection::ReceiveIncomingCiphertext() {
+            if (has_ciphertext_eof_) {
+                return -1;
+            }
+
+            size_t total_received_length = 0;
+            for (;;) {
+                char *p_space = nullptr;
+                size_t space = p_tls_engine_->PeekIncomingCiphertextSpace(&p_space);
+                if (0 == space) {
+                    // Full, OpenSSL has a complete record to process, see the buffer size floor in ConnectInternal()
+                    return 1;
+                }
+                ssize_t received_length = recv(server_tcp_socket_fd_, p_space, space, 0);
+                stats_.Increment(OpenSSLConnectionStats::Counter::CIPHERTEXT_RECVS);
+                if (0 < received_length) {
+                    p_tls_engine_->CommitIncomingCiphertext((size_t) received_length);
+                    total_received_length += (size_t) received_length;
+                    // The free space wraps around the end of the ring, go on with the part at the start
+                    if ((size_t) received_length == space) {
+                        continue;
+                    }
+                    return 1;
+                }
+                if (0 == received_length) {
+                    // Let OpenSSL report the closure once it has consumed what is already buffered
+                    has_ciphertext_eof_ = true;
+                    p_tls_engine_->SetIncomingEndOfStream();
+                    return 1;
+                }
+                if (EINTR == errno) {
+                    continue;
+                }
+                if (EAGAIN == errno || EWOULDBLOCK == errno) {
+                    return 0 < total_received_length ? 1 : 0;
+                }
+                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "recv - %s", strerror(errno));
+                return -1;
+            }
+        }
+
+        ResponseCode OpenSSLConnection::AttemptConnect(const std::chrono::steady_clock::time_point &deadline) {
             ResponseCode ret_val = ResponseCode::FAILURE;
             int rc = 0;
-            fd_set readFds;
-            fd_set writeFds;
-            struct timeval timeout = {tls_handshake_timeout_.tv_sec, tls_handshake_timeout_.tv_usec};
             int errorCode = 0;
             int select_retCode = 0;
 
             do {
                 rc = SSL_connect(p_ssl_handle_);
 
+                if (nullptr != p_tls_engine_) {
+                    // Send the flight the handshake just produced, the last one included, before waiting for a reply
+                    bool has_waited = false;
+                    ResponseCode flush_rc = FlushOutgoingCiphertext(deadline, has_waited);
+                    if (ResponseCode::NETWORK_SSL_WRITE_TIMEOUT_ERROR == flush_rc) {
+                        AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " SSL Connect time out while waiting for write");
+                        ret_val = ResponseCode::NETWORK_SSL_CONNECT_TIMEOUT_ERROR;
+                        break;
+                    } else if (ResponseCode::SUCCESS != flush_rc) {
+                        ret_val = ResponseCode::NETWORK_SSL_CONNECT_ERROR;
+                        break;
+                    }
+                }
+
                 if (1 == rc) { //1 = SSL_CONNECTED, <= 0 is Error
                     ret_val = ResponseCode::SUCCESS;
                     break;
@@ -216,9 +861,7 @@ namespace awsiotsdk {
                 errorCode = SSL_get_error(p_ssl_handle_, rc);
 
                 if (SSL_ERROR_WANT_READ == errorCode) {
-                    FD_ZERO(&readFds);
-                    FD_SET(server_tcp_socket_fd_, &readFds);
-                    select_retCode = select(server_tcp_socket_fd_ + 1, &readFds, NULL, NULL, &timeout);
+                    select_retCode = WaitForTLSProgress(false, deadline);
                     if (0 == select_retCode) { // 0 == SELECT_TIMEOUT
                         AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " SSL Connect time out while waiting for read");
                         ret_val = ResponseCode::NETWORK_SSL_CONNECT_TIMEOUT_ERROR;
@@ -227,9 +870,7 @@ namespace awsiotsdk {
                         ret_val = ResponseCode::NETWORK_SSL_CONNECT_ERROR;
                     }
                 } else if (SSL_ERROR_WANT_WRITE == errorCode) {
-                    FD_ZERO(&writeFds);
-                    FD_SET(server_tcp_socket_fd_, &writeFds);
-                    select_retCode = select(server_tcp_socket_fd_ + 1, NULL, &writeFds, NULL, &timeout);
+                    select_retCode = WaitForTLSProgress(true, deadline);
                     if (0 == select_retCode) { // 0 == SELECT_TIMEOUT
                         AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " SSL Connect time out while waiting for write");
                         ret_val = ResponseCode::NETWORK_SSL_CONNECT_TIMEOUT_ERROR;
@@ -250,37 +891,115 @@ namespace awsiotsdk {
         }
 
         ResponseCode OpenSSLConnection::ConnectInternal() {
+            std::chrono::steady_clock::time_point handshake_deadline =
+                std::chrono::steady_clock::now() + tls_handshake_timeout_;
+            if (nullptr == p_endpoint_pool_) {
+                return ConnectEndpoint(handshake_deadline, tls_handshake_timeout_);
+            }
+
+            util::Vector<OpenSSLEndpointPool::Endpoint> candidates = p_endpoint_pool_->GetCandidates();
+            if (candidates.empty()) {
+                return ConnectEndpoint(handshake_deadline, tls_handshake_timeout_);
+            }
+
+            ResponseCode networkResponse = ResponseCode::NETWORK_SSL_CONNECT_TIMEOUT_ERROR;
+            for (size_t itr = 0; itr < candidates.size(); itr++) {
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if (now >= handshake_deadline) {
+                    break;
+                }
+                endpoint_ = candidates[itr].host;
+                endpoint_port_ = candidates[itr].port;
+
+                // An unreachable endpoint costs at most one read timeout while there are others left to try. Only the
+                // TCP connect is bounded by it, a slow handshake still gets the whole handshake timeout.
+                std::chrono::milliseconds connect_timeout = tls_handshake_timeout_;
+                if (itr + 1 < candidates.size()) {
+                    connect_timeout = std::min(connect_timeout, tls_read_timeout_);
+                }
+
+                networkResponse = ConnectEndpoint(handshake_deadline, connect_timeout);
+                if (ResponseCode::SUCCESS == networkResponse) {
+                    // A deferred handshake has nothing to measure yet, see OpenSSLEndpointPool::ReportSuccess()
+                    p_endpoint_pool_->ReportSuccess(endpoint_, endpoint_port_,
+                                                    is_early_data_pending_ ? std::chrono::microseconds(0)
+                                                                           : GetLastHandshakeDuration(),
+                                                    GetTcpRtt());
+                    return networkResponse;
+                }
+
+                p_endpoint_pool_->ReportFailure(endpoint_, endpoint_port_);
+                if (-1 != server_tcp_socket_fd_) {
+                    CloseSocket(server_tcp_socket_fd_);
+                    server_tcp_socket_fd_ = -1;
+                }
+                CloseSocketReadiness();
+                if (itr + 1 < candidates.size()) {
+                    AWS_LOG_WARN(OPENSSL_WRAPPER_LOG_TAG, "Unable to connect to %s:%u, failing over to %s:%u",
+                                 endpoint_.c_str(), (unsigned int) endpoint_port_, candidates[itr + 1].host.c_str(),
+                                 (unsigned int) candidates[itr + 1].port);
+                }
+            }
+            return networkResponse;
+        }
+
+        ResponseCode OpenSSLConnection::ConnectEndpoint(
+            const std::chrono::steady_clock::time_point &handshake_deadline, std::chrono::milliseconds connect_timeout) {
             ResponseCode networkResponse = ResponseCode::SUCCESS;
 
+            // Don't leave a flush thread or reactor registration behind from a connection that was never disconnected
+            StopCorkFlushThread();
+            StopStatsDumpThread();
+            DetachFromReactor();
+            is_early_data_pending_ = false;
+            util::String().swap(early_data_buffer_);
+
             X509_VERIFY_PARAM *param = nullptr;
 
-            server_tcp_socket_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-            if (-1 == server_tcp_socket_fd_) {
-                return ResponseCode::NETWORK_TCP_SETUP_ERROR;
+            // Credentials are parsed once and shared, only re-acquire if the paths changed since the last connect
+            if (nullptr == p_tls_context_ ||
+                !p_tls_context_->Matches(root_ca_location_, device_cert_location_, device_private_key_location_)) {
+                networkResponse = OpenSSLContext::Acquire(root_ca_location_, device_cert_location_,
+                                                          device_private_key_location_, p_tls_context_);
+                if (ResponseCode::SUCCESS != networkResponse) {
+                    p_tls_context_.reset();
+                    return networkResponse;
+                }
             }
 
-            AWS_LOG_DEBUG(OPENSSL_WRAPPER_LOG_TAG, "Root CA : %s", root_ca_location_.c_str());
-            if (!SSL_CTX_load_verify_locations(p_ssl_context_, root_ca_location_.c_str(), NULL)) {
-                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " Root CA Loading error");
-                return ResponseCode::NETWORK_SSL_ROOT_CRT_PARSE_ERROR;
+            // The engine's side of the BIO pair goes first, the SSL handle owns the other one
+            p_tls_engine_.reset();
+            if (nullptr != p_ssl_handle_) {
+                SSL_free(p_ssl_handle_);
             }
+            p_ssl_handle_ = SSL_new(p_tls_context_->GetSSLContext());
 
-            if (0 < device_cert_location_.length() && 0 < device_private_key_location_.length()) {
-                AWS_LOG_DEBUG(OPENSSL_WRAPPER_LOG_TAG, "Device crt : %s", device_cert_location_.c_str());
-                if (!SSL_CTX_use_certificate_file(p_ssl_context_, device_cert_location_.c_str(), SSL_FILETYPE_PEM)) {
-                    AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " Device Certificate Loading error");
-                    return ResponseCode::NETWORK_SSL_DEVICE_CRT_PARSE_ERROR;
-                }
-                AWS_LOG_DEBUG(OPENSSL_WRAPPER_LOG_TAG, "Device privkey : %s", device_private_key_location_.c_str());
-                if (1 != SSL_CTX_use_PrivateKey_file(p_ssl_context_,
-                                                     device_private_key_location_.c_str(),
-                                                     SSL_FILETYPE_PEM)) {
-                    AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " Device Private Key Loading error");
-                    return ResponseCode::NETWORK_SSL_KEY_PARSE_ERROR;
-                }
+            networkResponse = ApplyCipherPreferences();
+            if (ResponseCode::SUCCESS != networkResponse) {
+                return networkResponse;
             }
+            SSL_set_msg_callback(p_ssl_handle_, &OpenSSLConnection::CountRecordCallback);
+            SSL_set_msg_callback_arg(p_ssl_handle_, this);
 
-            p_ssl_handle_ = SSL_new(p_ssl_context_);
+            // Name the endpoint in SNI unless it is an address literal, sessions are bound to it
+            char address[INET6_ADDRSTRLEN];
+            bool is_address_literal = inet_pton(AF_INET, endpoint_.c_str(), (void *) address) ||
+                                      inet_pton(AF_INET6, endpoint_.c_str(), (void *) address);
+            if (!is_address_literal && 1 != SSL_set_tlsext_host_name(p_ssl_handle_, endpoint_.c_str())) {
+                AWS_LOG_WARN(OPENSSL_WRAPPER_LOG_TAG, "Unable to set SNI to %s", endpoint_.c_str());
+            }
+
+            // Offer the last session negotiated with this endpoint, falling back to a full handshake if refused
+            util::String session_endpoint = endpoint_ + ":" + std::to_string(endpoint_port_);
+            if (nullptr != p_ssl_session_ && session_endpoint != ssl_session_endpoint_) {
+                ClearCachedSession();
+            }
+            if (nullptr == p_ssl_session_ && 0 < ssl_session_cache_path_.length()) {
+                LoadPersistedSession();
+            }
+            if (nullptr != p_ssl_session_ && 1 != SSL_set_session(p_ssl_handle_, p_ssl_session_)) {
+                ClearCachedSession();
+            }
 
             // Requires OpenSSL v1.0.2 and above
             if (server_verification_flag_) {
@@ -290,9 +1009,7 @@ namespace awsiotsdk {
 
                 // Check if it is an IPv4 or an IPv6 address to enable ip checking
                 // Enable host name check otherwise
-                char dst[INET6_ADDRSTRLEN];
-                if (inet_pton(AF_INET, endpoint_.c_str(), (void *) dst) ||
-                    inet_pton(AF_INET6, endpoint_.c_str(), (void *) dst)) {
+                if (is_address_literal) {
                     X509_VERIFY_PARAM_set1_ip_asc(param, endpoint_.c_str());
                 } else {
                     X509_VERIFY_PARAM_set1_host(param, endpoint_.c_str(), 0);
@@ -302,24 +1019,130 @@ namespace awsiotsdk {
             // Configure a non-zero callback if desired
             SSL_set_verify(p_ssl_handle_, SSL_VERIFY_PEER, nullptr);
 
-            networkResponse = ConnectTCPSocket();
-            if (ResponseCode::SUCCESS != networkResponse) {
-                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "TCP Connection error");
-                return networkResponse;
+#ifdef SSL_OP_ENABLE_KTLS
+            if (kernel_tls_enabled_ && !memory_bio_engine_enabled_) {
+                SSL_set_options(p_ssl_handle_, SSL_OP_ENABLE_KTLS);
             }
+#endif
 
-            SSL_set_fd(p_ssl_handle_, server_tcp_socket_fd_);
-
-            networkResponse = SetSocketToNonBlocking();
-            if (ResponseCode::SUCCESS != networkResponse) {
-                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " Unable to set the socket to Non-Blocking");
-                return networkResponse;
+            if (lean_mode_enabled_) {
+                // Record buffers are freed whenever they run empty instead of living as long as the handle
+                SSL_set_mode(p_ssl_handle_, SSL_MODE_RELEASE_BUFFERS);
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+                // Servers without support for the extension ignore it and keep sending full sized records
+                SSL_set_tlsext_max_fragment_length(p_ssl_handle_, TLSEXT_max_fragment_length_4096);
+#endif
+                SSL_set_max_send_fragment(p_ssl_handle_, OPENSSL_LEAN_MAX_FRAGMENT_LENGTH);
             }
 
-            networkResponse = AttemptConnect();
-            if (X509_V_OK != SSL_get_verify_result(p_ssl_handle_)) {
-                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " Server Certificate Verification failed.");
-                networkResponse = ResponseCode::NETWORK_SSL_CONNECT_ERROR;
+            if (nullptr != p_handshake_pool_) {
+                // Runs on a pool worker while this thread waits, so the connection's state needs no extra locking
+                networkResponse = p_handshake_pool_->Run(
+                    [this, connect_timeout](const std::chrono::steady_clock::time_point &deadline) {
+                        return OpenSession(deadline, connect_timeout);
+                    },
+                    handshake_deadline);
+            } else {
+                networkResponse = OpenSession(handshake_deadline, connect_timeout);
+            }
+
+            if (ResponseCode::SUCCESS == networkResponse) {
+                is_connected_ = true;
+                if (0 < write_cork_window_.count()) {
+                    is_cork_flush_thread_running_ = true;
+                    p_cork_flush_thread_ = std::unique_ptr<std::thread>(
+                        new std::thread(&OpenSSLConnection::CorkFlushThread, this));
+                }
+                if (0 < stats_dump_interval_.count()) {
+                    is_stats_dump_thread_running_ = true;
+                    p_stats_dump_thread_ = std::unique_ptr<std::thread>(
+                        new std::thread(&OpenSSLConnection::StatsDumpThread, this));
+                }
+                if (nullptr != p_reactor_) {
+                    {
+                        std::lock_guard<std::mutex> inbound_guard(inbound_mutex_);
+                        inbound_status_ = ResponseCode::SUCCESS;
+                        is_inbound_paused_ = false;
+                    }
+                    // Set first so reads never run on the caller's thread while a reactor thread is reading too
+                    is_reactor_attached_ = true;
+                    if (ResponseCode::SUCCESS != p_reactor_->Register(this, server_tcp_socket_fd_)) {
+                        is_reactor_attached_ = false;
+                        AWS_LOG_WARN(OPENSSL_WRAPPER_LOG_TAG,
+                                     "Unable to attach to the reactor, reads will wait on the socket directly");
+                    }
+                }
+            }
+
+            return networkResponse;
+        }
+
+        ResponseCode OpenSSLConnection::OpenSession(const std::chrono::steady_clock::time_point &handshake_deadline,
+                                                    std::chrono::milliseconds connect_timeout) {
+            ResponseCode networkResponse = ResponseCode::SUCCESS;
+
+            // TCP connect and handshake share the handshake deadline, the connect may be bounded tighter
+            std::chrono::steady_clock::time_point handshake_start = std::chrono::steady_clock::now();
+            std::chrono::steady_clock::time_point connect_deadline =
+                std::min(handshake_deadline,
+                         handshake_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                             connect_timeout));
+
+            networkResponse = ConnectTCPSocket(connect_deadline);
+            if (ResponseCode::SUCCESS != networkResponse) {
+                RecordBlockingOperation(OperationType::HANDSHAKE, handshake_start,
+                                        std::chrono::steady_clock::now() >= connect_deadline);
+                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "TCP Connection error");
+                return networkResponse;
+            }
+
+            if (memory_bio_engine_enabled_) {
+                // Every direction has to hold at least one full record, or OpenSSL could never make progress
+                p_tls_engine_ = OpenSSLMemoryBIOEngine::Attach(
+                    p_ssl_handle_, std::max(memory_bio_buffer_size_, (size_t) OPENSSL_MAX_RECORD_CIPHERTEXT_LENGTH));
+                if (nullptr == p_tls_engine_) {
+                    AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " Unable to set up the memory BIO engine");
+                    return ResponseCode::NETWORK_SSL_INIT_ERROR;
+                }
+                has_ciphertext_eof_ = false;
+            } else {
+                // The socket is already non-blocking, see ConnectTCPSocket()
+                SSL_set_fd(p_ssl_handle_, server_tcp_socket_fd_);
+            }
+
+            read_ahead_start_ = 0;
+            read_ahead_end_ = 0;
+            if (lean_mode_enabled_) {
+                ReleaseIdleReadBuffer();
+            } else {
+                AllocateReadAheadBuffer();
+            }
+
+            networkResponse = SetupSocketReadiness();
+            if (ResponseCode::SUCCESS != networkResponse) {
+                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " Unable to set up socket readiness notification");
+                return networkResponse;
+            }
+
+            if (CanSendEarlyData()) {
+                // The handshake completes on the first read, writes made until then ride in the first flight
+                early_handshake_start_ = std::chrono::steady_clock::time_point();
+                is_early_data_pending_ = true;
+            } else {
+                networkResponse = CompleteHandshake(AttemptConnect(handshake_deadline), handshake_start);
+            }
+
+            return networkResponse;
+        }
+
+        ResponseCode OpenSSLConnection::CompleteHandshake(ResponseCode handshake_rc,
+                                                          const std::chrono::steady_clock::time_point &handshake_start) {
+            ResponseCode networkResponse = handshake_rc;
+            RecordBlockingOperation(OperationType::HANDSHAKE, handshake_start,
+                                    ResponseCode::NETWORK_SSL_CONNECT_TIMEOUT_ERROR == networkResponse);
+            if (X509_V_OK != SSL_get_verify_result(p_ssl_handle_)) {
+                AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, " Server Certificate Verification failed.");
+                networkResponse = ResponseCode::NETWORK_SSL_CONNECT_ERROR;
             } else {
                 // ensure you have a valid certificate returned, otherwise no certificate exchange happened
                 if (nullptr == SSL_get_peer_certificate(p_ssl_handle_)) {
@@ -329,31 +1152,509 @@ namespace awsiotsdk {
             }
 
             if (ResponseCode::SUCCESS == networkResponse) {
-                is_connected_ = true;
+                last_handshake_duration_usecs_ = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - handshake_start).count();
+                if (IsSessionReused()) {
+                    stats_.Increment(OpenSSLConnectionStats::Counter::RESUMED_HANDSHAKES);
+                    AWS_LOG_DEBUG(OPENSSL_WRAPPER_LOG_TAG, "TLS session resumed");
+                } else {
+                    stats_.Increment(OpenSSLConnectionStats::Counter::FULL_HANDSHAKES);
+                }
+                UpdateCachedSession();
+                if (kernel_tls_enabled_) {
+                    AWS_LOG_INFO(OPENSSL_WRAPPER_LOG_TAG, "Kernel TLS offload - send : %s, receive : %s",
+                                 IsKernelTLSSendActive() ? "active" : "unavailable",
+                                 IsKernelTLSReceiveActive() ? "active" : "unavailable");
+                }
+                AWS_LOG_DEBUG(OPENSSL_WRAPPER_LOG_TAG, "Negotiated %s", GetNegotiatedCipher().c_str());
+            } else if (nullptr != p_ssl_session_) {
+                // Don't keep offering a session that led to a failed connection
+                ClearCachedSession();
             }
 
             return networkResponse;
         }
 
+        bool OpenSSLConnection::CanSendEarlyData() {
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+            // Reactor threads would race the caller over who completes the handshake
+            return early_data_enabled_ && nullptr == p_reactor_ && nullptr != p_ssl_session_ &&
+                0 < SSL_SESSION_get_max_early_data(p_ssl_session_);
+#else
+            return false;
+#endif
+        }
+
+        ResponseCode OpenSSLConnection::WriteEarlyData(const char *p_data, size_t bytes_to_write,
+                                                       size_t &size_written_bytes_out) {
+            ResponseCode rc = ResponseCode::SUCCESS;
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+            size_t max_early_data = SSL_SESSION_get_max_early_data(SSL_get0_session(p_ssl_handle_));
+            if (early_data_buffer_.length() + bytes_to_write <= max_early_data) {
+                // The handshake starts with the first early write, not when the TCP connection came up
+                if (std::chrono::steady_clock::time_point() == early_handshake_start_) {
+                    early_handshake_start_ = std::chrono::steady_clock::now();
+                    early_handshake_deadline_ = early_handshake_start_ + tls_handshake_timeout_;
+                }
+
+                size_t cur_written_length = 0;
+                for (;;) {
+                    stats_.Increment(OpenSSLConnectionStats::Counter::SSL_WRITE_CALLS);
+                    if (1 == SSL_write_early_data(p_ssl_handle_, p_data, bytes_to_write, &cur_written_length)) {
+                        stats_.Increment(OpenSSLConnectionStats::Counter::BYTES_WRITTEN, cur_written_length);
+                        break;
+                    }
+                    int error_code = SSL_get_error(p_ssl_handle_, 0);
+                    if (SSL_ERROR_WANT_WRITE != error_code && SSL_ERROR_WANT_READ != error_code) {
+                        rc = ResponseCode::NETWORK_SSL_WRITE_ERROR;
+                        break;
+                    }
+                    int select_retCode = WaitForTLSProgress(SSL_ERROR_WANT_WRITE == error_code,
+                                                            early_handshake_deadline_);
+                    if (0 == select_retCode) {
+                        rc = ResponseCode::NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+                        break;
+                    } else if (-1 == select_retCode) {
+                        rc = ResponseCode::NETWORK_SSL_WRITE_ERROR;
+                        break;
+                    }
+                }
+                if (ResponseCode::SUCCESS == rc && nullptr != p_tls_engine_) {
+                    bool has_waited = false;
+                    rc = FlushOutgoingCiphertext(early_handshake_deadline_, has_waited);
+                }
+                if (ResponseCode::SUCCESS == rc) {
+                    early_data_buffer_.append(p_data, bytes_to_write);
+                    size_written_bytes_out = bytes_to_write;
+                }
+                return rc;
+            }
+#endif
+            // Over the server's limit, the rest has to wait for the handshake
+            rc = FinishEarlyDataHandshake();
+            if (ResponseCode::SUCCESS != rc) {
+                return rc;
+            }
+            return WriteBytesInternal(p_data, bytes_to_write, size_written_bytes_out);
+        }
+
+        ResponseCode OpenSSLConnection::FinishEarlyDataHandshake() {
+            is_early_data_pending_ = false;
+            if (std::chrono::steady_clock::time_point() == early_handshake_start_) {
+                early_handshake_start_ = std::chrono::steady_clock::now();
+                early_handshake_deadline_ = early_handshake_start_ + tls_handshake_timeout_;
+            }
+
+            ResponseCode rc = CompleteHandshake(AttemptConnect(early_handshake_deadline_), early_handshake_start_);
+            if (ResponseCode::SUCCESS != rc) {
+                if (nullptr != p_endpoint_pool_) {
+                    p_endpoint_pool_->ReportFailure(endpoint_, endpoint_port_);
+                }
+                is_connected_ = false;
+                util::String().swap(early_data_buffer_);
+                return rc;
+            }
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+            if (SSL_EARLY_DATA_ACCEPTED == SSL_get_early_data_status(p_ssl_handle_)) {
+                stats_.Increment(OpenSSLConnectionStats::Counter::EARLY_DATA_ACCEPTED);
+            } else if (!early_data_buffer_.empty()) {
+                stats_.Increment(OpenSSLConnectionStats::Counter::EARLY_DATA_REJECTED);
+                AWS_LOG_INFO(OPENSSL_WRAPPER_LOG_TAG, "Early data rejected, resending %zu bytes",
+                             early_data_buffer_.length());
+                size_t size_written_bytes = 0;
+                rc = WriteBytesInternal(early_data_buffer_.c_str(), early_data_buffer_.length(), size_written_bytes);
+            }
+#endif
+            util::String().swap(early_data_buffer_);
+            return rc;
+        }
+
         ResponseCode OpenSSLConnection::WriteInternal(const util::String &buf, size_t &size_written_bytes_out) {
+            ByteSpan span(buf);
+            return WriteSpansInternal(&span, 1, size_written_bytes_out);
+        }
+
+        ResponseCode OpenSSLConnection::WriteSpansInternal(const ByteSpan *p_bufs, size_t buf_count,
+                                                           size_t &size_written_bytes_out) {
+            ResponseCode rc = ResponseCode::SUCCESS;
+            size_t total_written_length = 0;
+            if (0 < write_cork_window_.count()) {
+                rc = CorkWriteInternal(p_bufs, buf_count, total_written_length);
+            } else if (1 == buf_count) {
+                rc = WriteBytesInternal(reinterpret_cast<const char *>(p_bufs[0].p_data), p_bufs[0].length,
+                                        total_written_length);
+            } else {
+                // Small buffers are packed so they share records, full records go out from the caller's memory
+                write_coalesce_buffer_.clear();
+                for (size_t itr = 0; ResponseCode::SUCCESS == rc && itr <= buf_count; itr++) {
+                    bool is_end = (itr == buf_count);
+                    if (!is_end && OPENSSL_MAX_RECORD_PLAINTEXT_LENGTH > p_bufs[itr].length) {
+                        write_coalesce_buffer_.append(reinterpret_cast<const char *>(p_bufs[itr].p_data),
+                                                      p_bufs[itr].length);
+                        continue;
+                    }
+                    size_t size_written_bytes = 0;
+                    if (!write_coalesce_buffer_.empty()) {
+                        rc = WriteBytesInternal(write_coalesce_buffer_.c_str(), write_coalesce_buffer_.length(),
+                                                size_written_bytes);
+                        total_written_length += size_written_bytes;
+                        write_coalesce_buffer_.clear();
+                    }
+                    if (ResponseCode::SUCCESS == rc && !is_end) {
+                        rc = WriteBytesInternal(reinterpret_cast<const char *>(p_bufs[itr].p_data),
+                                                p_bufs[itr].length, size_written_bytes);
+                        total_written_length += size_written_bytes;
+                    }
+                }
+                ReleaseIdleWriteBuffers();
+            }
+            if (ResponseCode::SUCCESS == rc) {
+                size_written_bytes_out = total_written_length;
+            }
+            ReportTransportError(rc);
+            return rc;
+        }
+
+        ResponseCode OpenSSLConnection::WriteBatch(const util::Vector<util::String> &bufs,
+                                                   size_t &size_written_bytes_out) {
+            std::lock_guard<std::mutex> write_guard(write_mutex_);
+            if (!is_connected_) {
+                return ResponseCode::NETWORK_DISCONNECTED_ERROR;
+            }
+
+            util::Vector<ByteSpan> spans;
+            spans.reserve(bufs.size());
+            for (size_t itr = 0; itr < bufs.size(); itr++) {
+                spans.push_back(ByteSpan(bufs[itr]));
+            }
+            return WriteSpansInternal(spans.empty() ? nullptr : &spans[0], spans.size(), size_written_bytes_out);
+        }
+
+        ResponseCode OpenSSLConnection::Write(ByteSpan buf, size_t &size_written_bytes_out) {
+            std::lock_guard<std::mutex> write_guard(write_mutex_);
+            if (!is_connected_) {
+                return ResponseCode::NETWORK_DISCONNECTED_ERROR;
+            }
+            return WriteSpansInternal(&buf, 1, size_written_bytes_out);
+        }
+
+        ResponseCode OpenSSLConnection::Write(const util::Vector<ByteSpan> &bufs, size_t &size_written_bytes_out) {
+            std::lock_guard<std::mutex> write_guard(write_mutex_);
+            if (!is_connected_) {
+                return ResponseCode::NETWORK_DISCONNECTED_ERROR;
+            }
+            return WriteSpansInternal(bufs.empty() ? nullptr : &bufs[0], bufs.size(), size_written_bytes_out);
+        }
+
+        ResponseCode OpenSSLConnection::Read(MutableByteSpan buf, size_t &size_read_bytes_out) {
+            std::lock_guard<std::mutex> read_guard(read_mutex_);
+            if (!is_connected_) {
+                return ResponseCode::NETWORK_DISCONNECTED_ERROR;
+            }
+            return ReadBytesInternal(buf, size_read_bytes_out);
+        }
+
+        void OpenSSLConnection::ReleaseIdleWriteBuffers() {
+            if (lean_mode_enabled_) {
+                util::String().swap(write_coalesce_buffer_);
+            }
+        }
+
+        void OpenSSLConnection::AllocateReadAheadBuffer() {
+            size_t capacity = read_ahead_buffer_size_;
+            if (is_reactor_attached_ && 0 == capacity) {
+                // Read-ahead is disabled, but the reactor still needs somewhere to decrypt records to
+                capacity = OPENSSL_MAX_RECORD_PLAINTEXT_LENGTH;
+            }
+            if (lean_mode_enabled_) {
+                // Nothing is gained by reading ahead more than one record
+                capacity = std::min(capacity, (size_t) OPENSSL_LEAN_MAX_FRAGMENT_LENGTH);
+            }
+            if (read_ahead_buffer_.size() != capacity) {
+                read_ahead_buffer_.resize(capacity);
+                read_ahead_buffer_.shrink_to_fit();
+            }
+            read_ahead_allocated_bytes_ = read_ahead_buffer_.capacity();
+        }
+
+        void OpenSSLConnection::ReleaseIdleReadBuffer() {
+            if (lean_mode_enabled_ && read_ahead_start_ == read_ahead_end_ && 0 < read_ahead_buffer_.capacity()) {
+                util::Vector<unsigned char>().swap(read_ahead_buffer_);
+                read_ahead_start_ = 0;
+                read_ahead_end_ = 0;
+                read_ahead_allocated_bytes_ = 0;
+            }
+        }
+
+        size_t OpenSSLConnection::GetBufferFootprint() {
+            std::lock_guard<std::mutex> write_guard(write_mutex_);
+            std::lock_guard<std::mutex> cork_guard(cork_mutex_);
+            size_t bio_pair_bytes = 0;
+            if (nullptr != p_tls_engine_) {
+                bio_pair_bytes = 2 * std::max(memory_bio_buffer_size_, (size_t) OPENSSL_MAX_RECORD_CIPHERTEXT_LENGTH);
+            }
+            return read_ahead_allocated_bytes_ + write_coalesce_buffer_.capacity() + cork_buffer_.capacity() +
+                bio_pair_bytes;
+        }
+
+        size_t OpenSSLConnection::GetProcessResidentMemory() {
+#ifdef __linux__
+            FILE *statm_file = fopen("/proc/self/statm", "r");
+            if (nullptr == statm_file) {
+                return 0;
+            }
+            unsigned long total_pages = 0;
+            unsigned long resident_pages = 0;
+            int matched = fscanf(statm_file, "%lu %lu", &total_pages, &resident_pages);
+            fclose(statm_file);
+            if (2 != matched) {
+                return 0;
+            }
+            return (size_t) resident_pages * (size_t) sysconf(_SC_PAGESIZE);
+#else
+            return 0;
+#endif
+        }
+
+#ifndef WIN32
+        ResponseCode OpenSSLConnection::SendFile(int file_fd, off_t offset, size_t size,
+                                                 size_t &size_written_bytes_out) {
+            std::lock_guard<std::mutex> write_guard(write_mutex_);
+            if (!is_connected_) {
+                return ResponseCode::NETWORK_DISCONNECTED_ERROR;
+            }
+
+            ResponseCode rc = ResponseCode::SUCCESS;
+            if (0 < write_cork_window_.count()) {
+                // Keep ordering with writes that are still held back
+                std::lock_guard<std::mutex> cork_guard(cork_mutex_);
+                rc = FlushCorkBufferLocked();
+                if (ResponseCode::SUCCESS != rc) {
+                    return rc;
+                }
+            }
+
+            size_t total_written_length = 0;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+            if (IsKernelTLSSendActive()) {
+                std::chrono::steady_clock::time_point write_start;
+                std::chrono::steady_clock::time_point deadline;
+                bool has_waited = false;
+
+                while (is_connected_ && total_written_length < size && ResponseCode::SUCCESS == rc) {
+                    ossl_ssize_t cur_written_length = SSL_sendfile(p_ssl_handle_, file_fd,
+                                                                   offset + (off_t) total_written_length,
+                                                                   size - total_written_length, 0);
+                    stats_.Increment(OpenSSLConnectionStats::Counter::SSL_WRITE_CALLS);
+                    if (0 < cur_written_length) {
+                        stats_.Increment(OpenSSLConnectionStats::Counter::BYTES_WRITTEN, (uint64_t) cur_written_length);
+                        total_written_length += (size_t) cur_written_length;
+                    } else if (SSL_ERROR_WANT_WRITE == SSL_get_error(p_ssl_handle_, (int) cur_written_length)) {
+                        stats_.Increment(OpenSSLConnectionStats::Counter::WANT_WRITE_WAITS);
+                        if (!has_waited) {
+                            write_start = std::chrono::steady_clock::now();
+                            deadline = write_start + tls_write_timeout_;
+                            has_waited = true;
+                        }
+                        int select_retCode = WaitForSocket(true, deadline);
+                        if (0 == select_retCode) {
+                            rc = ResponseCode::NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+                        } else if (-1 == select_retCode) {
+                            rc = ResponseCode::NETWORK_SSL_WRITE_ERROR;
+                        }
+                    } else {
+                        rc = ResponseCode::NETWORK_SSL_WRITE_ERROR;
+                    }
+                }
+
+                if (has_waited) {
+                    RecordBlockingOperation(OperationType::WRITE, write_start,
+                                            ResponseCode::NETWORK_SSL_WRITE_TIMEOUT_ERROR == rc);
+                }
+                if (ResponseCode::SUCCESS == rc && total_written_length < size) {
+                    // Closed while sending
+                    rc = ResponseCode::NETWORK_DISCONNECTED_ERROR;
+                }
+                size_written_bytes_out = total_written_length;
+                return rc;
+            }
+#endif
+
+            // User space fallback, one full record at a time
+            write_coalesce_buffer_.resize(OPENSSL_MAX_RECORD_PLAINTEXT_LENGTH);
+            while (total_written_length < size && ResponseCode::SUCCESS == rc) {
+                size_t chunk_length = std::min(size - total_written_length, write_coalesce_buffer_.size());
+                ssize_t cur_read_length = pread(file_fd, &write_coalesce_buffer_[0], chunk_length,
+                                                offset + (off_t) total_written_length);
+                if (0 == cur_read_length) {
+                    AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "pread - unexpected end of file after %u of %u bytes",
+                                  (unsigned int) total_written_length, (unsigned int) size);
+                    rc = ResponseCode::FILE_OPEN_ERROR;
+                    break;
+                } else if (0 > cur_read_length) {
+                    AWS_LOG_ERROR(OPENSSL_WRAPPER_LOG_TAG, "pread - %s", strerror(errno));
+                    rc = ResponseCode::FILE_OPEN_ERROR;
+                    break;
+                }
+                size_t cur_written_length = 0;
+                rc = WriteBytesInternal(write_coalesce_buffer_.c_str(), (size_t) cur_read_length, cur_written_length);
+                total_written_length += cur_written_length;
+            }
+            ReleaseIdleWriteBuffers();
+
+            size_written_bytes_out = total_written_length;
+            return rc;
+        }
+#endif
+
+        ResponseCode OpenSSLConnection::CorkWriteInternal(const ByteSpan *p_bufs, size_t buf_count,
+                                                          size_t &size_written_bytes_out) {
+            std::lock_guard<std::mutex> cork_guard(cork_mutex_);
+            ResponseCode rc = cork_flush_status_;
+            if (ResponseCode::SUCCESS != rc) {
+                cork_flush_status_ = ResponseCode::SUCCESS;
+                return rc;
+            }
+
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            size_t queued_length = 0;
+            if (cork_buffer_.empty()) {
+                cork_started_at_ = now;
+                cork_cv_.notify_one();
+            }
+            for (size_t itr = 0; itr < buf_count; itr++) {
+                cork_buffer_.append(reinterpret_cast<const char *>(p_bufs[itr].p_data), p_bufs[itr].length);
+                queued_length += p_bufs[itr].length;
+            }
+
+            if (OPENSSL_MAX_RECORD_PLAINTEXT_LENGTH <= cork_buffer_.length() ||
+                now - cork_started_at_ >= write_cork_window_) {
+                rc = FlushCorkBufferLocked();
+            }
+
+            if (ResponseCode::SUCCESS == rc) {
+                size_written_bytes_out = queued_length;
+            }
+            return rc;
+        }
+
+        ResponseCode OpenSSLConnection::FlushCorkBufferLocked() {
+            if (cork_buffer_.empty()) {
+                return ResponseCode::SUCCESS;
+            }
+            size_t size_written_bytes = 0;
+            ResponseCode rc = WriteBytesInternal(cork_buffer_.c_str(), cork_buffer_.length(), size_written_bytes);
+            cork_buffer_.clear();
+            if (lean_mode_enabled_) {
+                util::String().swap(cork_buffer_);
+            }
+            return rc;
+        }
+
+        void OpenSSLConnection::CorkFlushThread() {
+            std::unique_lock<std::mutex> cork_lock(cork_mutex_);
+            while (is_cork_flush_thread_running_) {
+                if (cork_buffer_.empty()) {
+                    cork_cv_.wait(cork_lock);
+                    continue;
+                }
+                std::chrono::steady_clock::time_point flush_at = cork_started_at_ + write_cork_window_;
+                if (std::chrono::steady_clock::now() < flush_at) {
+                    cork_cv_.wait_until(cork_lock, flush_at);
+                    continue;
+                }
+
+                // Lock order is write mutex first, then cork mutex. If a writer holds the write mutex it flushes the
+                // expired window itself, so don't wait for it.
+                cork_lock.unlock();
+                {
+                    std::unique_lock<std::mutex> write_lock(write_mutex_, std::try_to_lock);
+                    if (write_lock.owns_lock()) {
+                        std::lock_guard<std::mutex> cork_guard(cork_mutex_);
+                        ResponseCode rc = FlushCorkBufferLocked();
+                        if (ResponseCode::SUCCESS != rc) {
+                            cork_flush_status_ = rc;
+                        }
+                    }
+                }
+                cork_lock.lock();
+                if (!cork_buffer_.empty()) {
+                    cork_cv_.wait_for(cork_lock, write_cork_window_);
+                }
+            }
+        }
+
+        void OpenSSLConnection::StopCorkFlushThread() {
+            if (nullptr != p_cork_flush_thread_) {
+                {
+                    std::lock_guard<std::mutex> cork_guard(cork_mutex_);
+                    is_cork_flush_thread_running_ = false;
+                    cork_cv_.notify_all();
+                }
+                p_cork_flush_thread_->join();
+                p_cork_flush_thread_.reset();
+            }
+
+            // Best effort, the connection is going away
+            std::lock_guard<std::mutex> cork_guard(cork_mutex_);
+            FlushCorkBufferLocked();
+            cork_flush_status_ = ResponseCode::SUCCESS;
+        }
+
+        void OpenSSLConnection::StatsDumpThread() {
+            std::unique_lock<std::mutex> stats_dump_lock(stats_dump_mutex_);
+            while (is_stats_dump_thread_running_) {
+                if (std::cv_status::timeout == stats_dump_cv_.wait_for(stats_dump_lock, stats_dump_interval_)) {
+                    AWS_LOG_INFO(OPENSSL_WRAPPER_LOG_TAG, "Stats %s:%u - %s", endpoint_.c_str(),
+                                 (unsigned int) endpoint_port_, stats_.ToString().c_str());
+                }
+            }
+        }
+
+        void OpenSSLConnection::StopStatsDumpThread() {
+            if (nullptr != p_stats_dump_thread_) {
+                {
+                    std::lock_guard<std::mutex> stats_dump_guard(stats_dump_mutex_);
+                    is_stats_dump_thread_running_ = false;
+                    stats_dump_cv_.notify_all();
+                }
+                p_stats_dump_thread_->join();
+                p_stats_dump_thread_.reset();
+            }
+        }
+
+        ResponseCode OpenSSLConnection::WriteBytesInternal(const char *p_data, size_t bytes_to_write,
+                                                           size_t &size_written_bytes_out) {
+            if (is_early_data_pending_) {
+                return WriteEarlyData(p_data, bytes_to_write, size_written_bytes_out);
+            }
+
             int error_code = 0;
             int select_retCode = -1;
             int cur_written_length = 0;
             size_t total_written_length = 0;
             ResponseCode rc = ResponseCode::SUCCESS;
-            fd_set write_fds;
-            size_t bytes_to_write = buf.length();
-            struct timeval timeout = {tls_write_timeout_.tv_sec, tls_write_timeout_.tv_usec};
+            std::chrono::steady_clock::time_point write_start;
+            std::chrono::steady_clock::time_point deadline;
+            bool has_waited = false;
 
             do {
-                cur_written_length = SSL_write(p_ssl_handle_, buf.c_str(), bytes_to_write);
+                cur_written_length = SSL_write(p_ssl_handle_, p_data + total_written_length,
+                                               (int) (bytes_to_write - total_written_length));
+                stats_.Increment(OpenSSLConnectionStats::Counter::SSL_WRITE_CALLS);
                 error_code = SSL_get_error(p_ssl_handle_, cur_written_length);
                 if (0 < cur_written_length) {
+                    stats_.Increment(OpenSSLConnectionStats::Counter::BYTES_WRITTEN, (uint64_t) cur_written_length);
                     total_written_length += (size_t) cur_written_length;
                 } else if (SSL_ERROR_WANT_WRITE == error_code) {
-                    FD_ZERO(&write_fds);
-                    FD_SET(server_tcp_socket_fd_, &write_fds);
-                    select_retCode = select(server_tcp_socket_fd_ + 1, NULL, &write_fds, NULL, &timeout);
+                    // Only look at the clock once the write actually has to wait
+                    if (!has_waited) {
+                        write_start = std::chrono::steady_clock::now();
+                        deadline = write_start + tls_write_timeout_;
+                        has_waited = true;
+                    }
+                    select_retCode = WaitForTLSProgress(true, deadline);
                     if (0 == select_retCode) { //0 == SELECT_TIMEOUT
                         rc = ResponseCode::NETWORK_SSL_WRITE_TIMEOUT_ERROR;
                     } else if (-1 == select_retCode) { //-1 == SELECT_TIMEOUT
@@ -367,6 +1668,20 @@ namespace awsiotsdk {
                 ResponseCode::NETWORK_SSL_WRITE_TIMEOUT_ERROR != rc &&
                 total_written_length < bytes_to_write);
 
+            if (ResponseCode::SUCCESS == rc && nullptr != p_tls_engine_) {
+                // Everything this write encrypted goes out together
+                if (!has_waited) {
+                    write_start = std::chrono::steady_clock::now();
+                    deadline = write_start + tls_write_timeout_;
+                }
+                rc = FlushOutgoingCiphertext(deadline, has_waited);
+            }
+
+            if (has_waited) {
+                RecordBlockingOperation(OperationType::WRITE, write_start,
+                                        ResponseCode::NETWORK_SSL_WRITE_TIMEOUT_ERROR == rc);
+            }
+
             if (ResponseCode::SUCCESS == rc) {
                 size_written_bytes_out = total_written_length;
             }
@@ -374,29 +1689,178 @@ namespace awsiotsdk {
             return rc;
         }
 
+        ResponseCode OpenSSLConnection::FillReadAheadBuffer(size_t min_buffered_bytes,
+                                                            const std::chrono::steady_clock::time_point &deadline,
+                                                            bool &waited_out) {
+            int ssl_retcode;
+            int select_retCode;
+            int cur_read_len = 0;
+            ResponseCode errorStatus = ResponseCode::SUCCESS;
+
+            // Move any unconsumed bytes to the front so the whole tail is available to SSL_read
+            if (0 < read_ahead_start_) {
+                memmove(&read_ahead_buffer_[0], &read_ahead_buffer_[read_ahead_start_],
+                        read_ahead_end_ - read_ahead_start_);
+                read_ahead_end_ -= read_ahead_start_;
+                read_ahead_start_ = 0;
+            }
+
+            do {
+                cur_read_len = SSL_read(p_ssl_handle_, &read_ahead_buffer_[read_ahead_end_],
+                                        (int) (read_ahead_buffer_.size() - read_ahead_end_));
+                stats_.Increment(OpenSSLConnectionStats::Counter::SSL_READ_CALLS);
+                if (0 < cur_read_len) {
+                    stats_.Increment(OpenSSLConnectionStats::Counter::BYTES_READ, (uint64_t) cur_read_len);
+                    read_ahead_end_ += (size_t) cur_read_len;
+                    // Keep going while the current record still holds decrypted bytes
+                    if (read_ahead_end_ >= min_buffered_bytes &&
+                        (0 == SSL_pending(p_ssl_handle_) || read_ahead_end_ == read_ahead_buffer_.size())) {
+                        break;
+                    }
+                } else {
+                    ssl_retcode = SSL_get_error(p_ssl_handle_, cur_read_len);
+                    switch (ssl_retcode) {
+                        case SSL_ERROR_WANT_READ:
+                            if (read_ahead_end_ >= min_buffered_bytes) {
+                                break;
+                            }
+                            waited_out = true;
+                            select_retCode = WaitForTLSProgress(false, deadline);
+                            if (0 < select_retCode) {
+                                continue;
+                            } else if (0 == select_retCode) { //0 == SELECT_TIMEOUT
+                                errorStatus = ResponseCode::NETWORK_SSL_NOTHING_TO_READ;
+                            } else { // SELECT_ERROR
+                                errorStatus = ResponseCode::NETWORK_SSL_READ_ERROR;
+                            }
+                            break;
+                        case SSL_ERROR_ZERO_RETURN:
+                            errorStatus = ResponseCode::NETWORK_SSL_CONNECTION_CLOSED_ERROR;
+                            break;
+                        default:
+                            errorStatus = ResponseCode::NETWORK_SSL_READ_ERROR;
+                            break;
+                    }
+                    if (ResponseCode::SUCCESS != errorStatus || read_ahead_end_ >= min_buffered_bytes) {
+                        break;
+                    }
+                }
+            } while (is_connected_);
+
+            if (ResponseCode::SUCCESS == errorStatus && read_ahead_end_ < min_buffered_bytes) {
+                errorStatus = ResponseCode::NETWORK_SSL_READ_ERROR;
+            }
+
+            return errorStatus;
+        }
+
         ResponseCode OpenSSLConnection::ReadInternal(util::Vector<unsigned char> &buf, size_t buf_read_offset,
                                                      size_t size_bytes_to_read, size_t &size_read_bytes_out) {
+            size_t size_read_bytes = 0;
+            ResponseCode rc = ReadBytesInternal(MutableByteSpan(buf, buf_read_offset, size_bytes_to_read),
+                                                size_read_bytes);
+            if (ResponseCode::SUCCESS == rc) {
+                size_read_bytes_out = buf_read_offset + size_read_bytes;
+            }
+            return rc;
+        }
+
+        ResponseCode OpenSSLConnection::ReadBytesInternal(MutableByteSpan buf, size_t &size_read_bytes_out) {
+            if (is_early_data_pending_) {
+                // Whatever is read next is the server's answer, the early data phase is over. Lock order is read
+                // mutex first, then write mutex.
+                std::lock_guard<std::mutex> write_guard(write_mutex_);
+                if (is_early_data_pending_) {
+                    ResponseCode rc = FinishEarlyDataHandshake();
+                    if (ResponseCode::SUCCESS != rc) {
+                        return rc;
+                    }
+                }
+            }
+
+            ResponseCode rc;
+            if (is_reactor_attached_) {
+                rc = ReactorReadInternal(buf, size_read_bytes_out);
+            } else {
+                rc = DirectReadInternal(buf, size_read_bytes_out);
+            }
+            ReportTransportError(rc);
+            return rc;
+        }
+
+        ResponseCode OpenSSLConnection::DirectReadInternal(MutableByteSpan buf, size_t &size_read_bytes_out) {
             int ssl_retcode;
             int select_retCode;
-            size_t total_read_length = buf_read_offset;
-            size_t remaining_bytes_to_read = size_bytes_to_read;
+            size_t total_read_length = 0;
+            size_t remaining_bytes_to_read = buf.length;
             int cur_read_len = 0;
             ResponseCode errorStatus = ResponseCode::SUCCESS;
-            fd_set readFds;
-            struct timeval timeout = {tls_read_timeout_.tv_sec, tls_read_timeout_.tv_usec};
+            size_t buffered_bytes = read_ahead_end_ - read_ahead_start_;
 
-            do {
-                cur_read_len = SSL_read(p_ssl_handle_, &buf[total_read_length], (int) remaining_bytes_to_read);
+            if (buffered_bytes >= remaining_bytes_to_read) {
+                // Served from memory, no need to look at the clock
+                stats_.Increment(OpenSSLConnectionStats::Counter::READ_AHEAD_HITS);
+                memcpy(buf.p_data, &read_ahead_buffer_[read_ahead_start_], remaining_bytes_to_read);
+                read_ahead_start_ += remaining_bytes_to_read;
+                if (read_ahead_start_ == read_ahead_end_) {
+                    read_ahead_start_ = 0;
+                    read_ahead_end_ = 0;
+                    ReleaseIdleReadBuffer();
+                }
+                size_read_bytes_out = remaining_bytes_to_read;
+                return ResponseCode::SUCCESS;
+            }
+
+            // One deadline for the whole read, however many partial records arrive
+            std::chrono::steady_clock::time_point read_start = std::chrono::steady_clock::now();
+            std::chrono::steady_clock::time_point deadline = read_start + tls_read_timeout_;
+            bool has_waited = false;
+
+            stats_.Increment(OpenSSLConnectionStats::Counter::READ_AHEAD_MISSES);
+            if (read_ahead_buffer_.empty()) {
+                AllocateReadAheadBuffer();
+            }
+            if (remaining_bytes_to_read <= read_ahead_buffer_.size()) {
+                errorStatus = FillReadAheadBuffer(remaining_bytes_to_read, deadline, has_waited);
+                if (has_waited) {
+                    RecordBlockingOperation(OperationType::READ, read_start,
+                                            ResponseCode::NETWORK_SSL_NOTHING_TO_READ == errorStatus);
+                    has_waited = false;
+                }
+                if (ResponseCode::SUCCESS != errorStatus) {
+                    ReleaseIdleReadBuffer();
+                    return errorStatus;
+                }
+                buffered_bytes = read_ahead_end_ - read_ahead_start_;
+            }
+
+            // Serve what we can from the read-ahead buffer
+            if (0 < buffered_bytes) {
+                size_t copy_length = std::min(buffered_bytes, remaining_bytes_to_read);
+                memcpy(buf.p_data + total_read_length, &read_ahead_buffer_[read_ahead_start_], copy_length);
+                read_ahead_start_ += copy_length;
+                total_read_length += copy_length;
+                remaining_bytes_to_read -= copy_length;
+                if (read_ahead_start_ == read_ahead_end_) {
+                    read_ahead_start_ = 0;
+                    read_ahead_end_ = 0;
+                }
+            }
+
+            // Requests larger than the read-ahead buffer are read straight into the caller's buffer
+            while (is_connected_ && 0 < remaining_bytes_to_read) {
+                cur_read_len = SSL_read(p_ssl_handle_, buf.p_data + total_read_length, (int) remaining_bytes_to_read);
+                stats_.Increment(OpenSSLConnectionStats::Counter::SSL_READ_CALLS);
                 if (0 < cur_read_len) {
+                    stats_.Increment(OpenSSLConnectionStats::Counter::BYTES_READ, (uint64_t) cur_read_len);
                     total_read_length += (size_t) cur_read_len;
                     remaining_bytes_to_read -= cur_read_len;
                 } else {
                     ssl_retcode = SSL_get_error(p_ssl_handle_, cur_read_len);
                     switch (ssl_retcode) {
                         case SSL_ERROR_WANT_READ:
-                            FD_ZERO(&readFds);
-                            FD_SET(server_tcp_socket_fd_, &readFds);
-                            select_retCode = select(server_tcp_socket_fd_ + 1, &readFds, NULL, NULL, &timeout);
+                            has_waited = true;
+                            select_retCode = WaitForTLSProgress(false, deadline);
                             if (0 < select_retCode) {
                                 continue;
                             } else if (0 == select_retCode) { //0 == SELECT_TIMEOUT
@@ -418,7 +1882,13 @@ namespace awsiotsdk {
                     ResponseCode::NETWORK_SSL_CONNECTION_CLOSED_ERROR == errorStatus) {
                     break;
                 }
-            } while (is_connected_ && total_read_length < size_bytes_to_read);
+            }
+
+            if (has_waited) {
+                RecordBlockingOperation(OperationType::READ, read_start,
+                                        ResponseCode::NETWORK_SSL_NOTHING_TO_READ == errorStatus);
+            }
+            ReleaseIdleReadBuffer();
 
             if (ResponseCode::SUCCESS == errorStatus) {
                 size_read_bytes_out = total_read_length;
@@ -427,14 +1897,194 @@ namespace awsiotsdk {
             return errorStatus;
         }
 
+        ResponseCode OpenSSLConnection::ReactorReadInternal(MutableByteSpan buf, size_t &size_read_bytes_out) {
+            std::unique_lock<std::mutex> inbound_lock(inbound_mutex_);
+            size_t size_bytes_to_read = buf.length;
+            ResponseCode errorStatus = ResponseCode::SUCCESS;
+            std::chrono::steady_clock::time_point read_start;
+            std::chrono::steady_clock::time_point deadline;
+            bool has_waited = false;
+
+            if (read_ahead_buffer_.empty()) {
+                AllocateReadAheadBuffer();
+            }
+            // Requests are served whole, so make room for packets larger than the buffer
+            if (read_ahead_buffer_.size() < size_bytes_to_read) {
+                if (0 < read_ahead_start_) {
+                    memmove(&read_ahead_buffer_[0], &read_ahead_buffer_[read_ahead_start_],
+                            read_ahead_end_ - read_ahead_start_);
+                    read_ahead_end_ -= read_ahead_start_;
+                    read_ahead_start_ = 0;
+                }
+                read_ahead_buffer_.resize(size_bytes_to_read);
+                read_ahead_allocated_bytes_ = read_ahead_buffer_.capacity();
+            }
+
+            while (read_ahead_end_ - read_ahead_start_ < size_bytes_to_read) {
+                if (ResponseCode::SUCCESS != inbound_status_) {
+                    errorStatus = inbound_status_;
+                    break;
+                }
+                if (is_inbound_paused_) {
+                    // The reactor stopped because the buffer was full, there is room again
+                    is_inbound_paused_ = false;
+                    p_reactor_->Rearm(server_tcp_socket_fd_, PumpInboundLocked());
+                    continue;
+                }
+                if (!has_waited) {
+                    read_start = std::chrono::steady_clock::now();
+                    deadline = read_start + tls_read_timeout_;
+                    has_waited = true;
+                }
+                if (std::cv_status::timeout == inbound_cv_.wait_until(inbound_lock, deadline) &&
+                    read_ahead_end_ - read_ahead_start_ < size_bytes_to_read &&
+                    ResponseCode::SUCCESS == inbound_status_) {
+                    errorStatus = ResponseCode::NETWORK_SSL_NOTHING_TO_READ;
+                    break;
+                }
+            }
+
+            if (has_waited) {
+                stats_.Increment(OpenSSLConnectionStats::Counter::READ_AHEAD_MISSES);
+                RecordBlockingOperation(OperationType::READ, read_start,
+                                        ResponseCode::NETWORK_SSL_NOTHING_TO_READ == errorStatus);
+            } else {
+                stats_.Increment(OpenSSLConnectionStats::Counter::READ_AHEAD_HITS);
+            }
+
+            if (ResponseCode::SUCCESS == errorStatus) {
+                memcpy(buf.p_data, &read_ahead_buffer_[read_ahead_start_], size_bytes_to_read);
+                read_ahead_start_ += size_bytes_to_read;
+                if (read_ahead_start_ == read_ahead_end_) {
+                    read_ahead_start_ = 0;
+                    read_ahead_end_ = 0;
+                }
+                size_read_bytes_out = size_bytes_to_read;
+                if (is_inbound_paused_) {
+                    is_inbound_paused_ = false;
+                    p_reactor_->Rearm(server_tcp_socket_fd_, PumpInboundLocked());
+                }
+            }
+            if (read_ahead_start_ == read_ahead_end_) {
+                ReleaseIdleReadBuffer();
+            }
+
+            return errorStatus;
+        }
+
+        OpenSSLReactor::Interest OpenSSLConnection::OnReactorEvent() {
+            std::lock_guard<std::mutex> inbound_guard(inbound_mutex_);
+            return PumpInboundLocked();
+        }
+
+        OpenSSLReactor::Interest OpenSSLConnection::PumpInboundLocked() {
+            if (ResponseCode::SUCCESS != inbound_status_ || is_inbound_paused_) {
+                return OpenSSLReactor::Interest::NONE;
+            }
+
+            if (read_ahead_buffer_.empty()) {
+                AllocateReadAheadBuffer();
+            }
+            if (0 < read_ahead_start_) {
+                memmove(&read_ahead_buffer_[0], &read_ahead_buffer_[read_ahead_start_],
+                        read_ahead_end_ - read_ahead_start_);
+                read_ahead_end_ -= read_ahead_start_;
+                read_ahead_start_ = 0;
+            }
+
+            while (read_ahead_end_ < read_ahead_buffer_.size()) {
+                int cur_read_len = SSL_read(p_ssl_handle_, &read_ahead_buffer_[read_ahead_end_],
+                                            (int) (read_ahead_buffer_.size() - read_ahead_end_));
+                stats_.Increment(OpenSSLConnectionStats::Counter::SSL_READ_CALLS);
+                if (0 < cur_read_len) {
+                    stats_.Increment(OpenSSLConnectionStats::Counter::BYTES_READ, (uint64_t) cur_read_len);
+                    read_ahead_end_ += (size_t) cur_read_len;
+                    inbound_cv_.notify_all();
+                    continue;
+                }
+
+                OpenSSLReactor::Interest interest = OpenSSLReactor::Interest::NONE;
+                switch (SSL_get_error(p_ssl_handle_, cur_read_len)) {
+                    case SSL_ERROR_WANT_READ:
+                        if (nullptr != p_tls_engine_) {
+                            int received = ReceiveIncomingCiphertext();
+                            if (0 < received) {
+                                continue;
+                            } else if (0 > received) {
+                                inbound_status_ = ResponseCode::NETWORK_SSL_READ_ERROR;
+                                inbound_cv_.notify_all();
+                                break;
+                            }
+                        }
+                        stats_.Increment(OpenSSLConnectionStats::Counter::WANT_READ_WAITS);
+                        interest = OpenSSLReactor::Interest::READ;
+                        break;
+                    case SSL_ERROR_WANT_WRITE:
+                        stats_.Increment(OpenSSLConnectionStats::Counter::WANT_WRITE_WAITS);
+                        interest = OpenSSLReactor::Interest::WRITE;
+                        break;
+                    case SSL_ERROR_ZERO_RETURN:
+                        inbound_status_ = ResponseCode::NETWORK_SSL_CONNECTION_CLOSED_ERROR;
+                        inbound_cv_.notify_all();
+                        break;
+                    default:
+                        inbound_status_ = ResponseCode::NETWORK_SSL_READ_ERROR;
+                        inbound_cv_.notify_all();
+                        break;
+                }
+                // Nothing buffered and nothing in flight, don't hold on to the buffer in lean mode
+                if (OpenSSLReactor::Interest::READ == interest && read_ahead_start_ == read_ahead_end_) {
+                    ReleaseIdleReadBuffer();
+                }
+                return interest;
+            }
+
+            // Full, the socket stays unwatched until a read makes room
+            is_inbound_paused_ = true;
+            return OpenSSLReactor::Interest::NONE;
+        }
+
+        void OpenSSLConnection::DetachFromReactor() {
+            if (!is_reactor_attached_) {
+                return;
+            }
+            p_reactor_->Deregister(server_tcp_socket_fd_);
+            is_reactor_attached_ = false;
+
+            std::lock_guard<std::mutex> inbound_guard(inbound_mutex_);
+            if (ResponseCode::SUCCESS == inbound_status_) {
+                inbound_status_ = ResponseCode::NETWORK_DISCONNECTED_ERROR;
+            }
+            inbound_cv_.notify_all();
+        }
+
         ResponseCode OpenSSLConnection::DisconnectInternal() {
+            StopCorkFlushThread();
+            StopStatsDumpThread();
+            DetachFromReactor();
             is_connected_ = false;
+            is_early_data_pending_ = false;
+            util::String().swap(early_data_buffer_);
+            {
+                std::lock_guard<std::mutex> inbound_guard(inbound_mutex_);
+                read_ahead_start_ = 0;
+                read_ahead_end_ = 0;
+                ReleaseIdleReadBuffer();
+            }
+            UpdateCachedSession();
             SSL_shutdown(p_ssl_handle_);
+            if (nullptr != p_tls_engine_) {
+                // Best effort, don't wait for the socket to send the close_notify
+                bool has_waited = false;
+                FlushOutgoingCiphertext(std::chrono::steady_clock::now(), has_waited);
+                p_tls_engine_.reset();
+            }
 #ifdef WIN32
             closesocket(server_tcp_socket_fd_);
 #else
             close(server_tcp_socket_fd_);
 #endif
+            CloseSocketReadiness();
             return ResponseCode::SUCCESS;
         }
 
@@ -442,8 +2092,10 @@ namespace awsiotsdk {
             if (is_connected_) {
                 Disconnect();
             }
+            p_tls_engine_.reset();
+            CloseSocketReadiness();
             SSL_free(p_ssl_handle_);
-            SSL_CTX_free(p_ssl_context_);
+            ClearCachedSession();
 #ifdef WIN32
             WSACleanup();
 #endif
@@ -28,13 +28,19 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/select.h>
+#include <poll.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <openssl/pem.h>
@@ -42,9 +48,20 @@
 #include <openssl/x509v3.h>
 #include <openssl/x509_vfy.h>
 #include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
 
 #include "NetworkConnection.hpp"
 #include "ResponseCode.hpp"
+#include "OpenSSLContext.hpp"
+#include "OpenSSLReactor.hpp"
+#include "OpenSSLMemoryBIOEngine.hpp"
+#include "OpenSSLConnectionStats.hpp"
+#include "OpenSSLEndpointPool.hpp"
+#include "OpenSSLHandshakePool.hpp"
+#include "OpenSSLSocketTuning.hpp"
+#include "OpenSSLByteSpan.hpp"
 
 namespace awsiotsdk {
     namespace network {
@@ -54,59 +71,253 @@ namespace awsiotsdk {
          * Defines a reference wrapper for OpenSSL libraries
          */
         class OpenSSLConnection : public NetworkConnection {
+            friend class OpenSSLReactor;
+
+        public:
+            /**
+             * @brief Blocking operations tracked by the timeout statistics, indexes the matching latency histograms
+             */
+            enum class OperationType {
+                HANDSHAKE = 0,  ///< TCP connect and TLS handshake
+                READ = 1,       ///< TLS read
+                WRITE = 2       ///< TLS write
+            };
+
         protected:
             util::String root_ca_location_;             ///< Pointer to string containing the filename (including path) of the root CA file.
             util::String device_cert_location_;         ///< Pointer to string containing the filename (including path) of the device certificate.
             util::String device_private_key_location_;  ///< Pointer to string containing the filename (including path) of the device private key file.
             bool server_verification_flag_;             ///< Boolean.  True = perform server certificate hostname validation.  False = skip validation \b NOT recommended.
             bool is_connected_;                         ///< Boolean indicating connection status
-            struct timeval tls_handshake_timeout_;      ///< Timeout for TLS handshake command
-            struct timeval tls_read_timeout_;           ///< Timeout for the TLS Read command
-            struct timeval tls_write_timeout_;          ///< Timeout for the TLS Write command
+            std::chrono::milliseconds tls_handshake_timeout_;   ///< Timeout for TCP connect and TLS handshake together
+            std::chrono::milliseconds tls_read_timeout_;        ///< Timeout for the TLS Read command
+            std::chrono::milliseconds tls_write_timeout_;       ///< Timeout for the TLS Write command
+
+            // Statistics
+            OpenSSLConnectionStats stats_;                      ///< I/O counters and latency histograms
+            std::chrono::seconds stats_dump_interval_;          ///< How often the statistics are logged, 0 disables the dump
+            std::mutex stats_dump_mutex_;                       ///< Protects the dump thread's stop flag
+            std::condition_variable stats_dump_cv_;             ///< Wakes the dump thread on disconnect
+            bool is_stats_dump_thread_running_;                 ///< Stop flag for the dump thread
+            std::unique_ptr<std::thread> p_stats_dump_thread_;  ///< Logs the statistics every dump interval
+
+            // Write coalescing
+            util::String write_coalesce_buffer_;                ///< Reused buffer that batched writes are packed into
+            std::chrono::microseconds write_cork_window_;       ///< How long small writes may be held back, 0 disables corking
+            std::mutex cork_mutex_;                             ///< Protects the cork buffer and flush status
+            std::condition_variable cork_cv_;                   ///< Wakes the flush thread when the cork buffer fills or on disconnect
+            util::String cork_buffer_;                          ///< Writes held back until the cork window expires
+            std::chrono::steady_clock::time_point cork_started_at_; ///< When the oldest byte in the cork buffer was queued
+            ResponseCode cork_flush_status_;                    ///< Error from a background flush, reported by the next write
+            std::atomic_bool is_cork_flush_thread_running_;     ///< Stop flag for the flush thread
+            std::unique_ptr<std::thread> p_cork_flush_thread_;  ///< Flushes the cork buffer once the window expires
 
             // Endpoint information
             uint16_t endpoint_port_;                    ///< Endpoint port
             util::String endpoint_;                     ///< Endpoint for this connection
+            std::chrono::seconds dns_cache_ttl_;        ///< How long resolved endpoint addresses are reused, 0 disables caching
+            std::shared_ptr<OpenSSLEndpointPool> p_endpoint_pool_;  ///< Endpoints to fail over between, nullptr to only use the endpoint
+            std::shared_ptr<OpenSSLHandshakePool> p_handshake_pool_;    ///< Runs the handshakes, nullptr to run them on the caller's thread
+            OpenSSLSocketTuning socket_tuning_;         ///< Socket options applied to every TCP connection attempt
 
-            SSL_CTX *p_ssl_context_;                    ///< SSL Context instance
+            std::shared_ptr<OpenSSLContext> p_tls_context_; ///< Shared SSL Context holding the parsed credentials
             SSL *p_ssl_handle_;                         ///< SSL Handle
+            util::String tls_cipher_list_;              ///< OpenSSL cipher list for TLS 1.2, empty for the library default
+            util::String tls_ciphersuites_;             ///< TLS 1.3 ciphersuites in order of preference, empty for the library default
+            util::String tls_groups_;                   ///< Key exchange groups in order of preference, empty for the library default
+            bool kernel_tls_enabled_;                   ///< Boolean.  True = ask OpenSSL to hand record crypto to the kernel (kTLS)
+            bool lean_mode_enabled_;                    ///< Boolean.  True = trade some per-read allocations for a small idle footprint
+            bool memory_bio_engine_enabled_;            ///< Boolean.  True = run TLS over a memory BIO pair and move ciphertext ourselves
+            size_t memory_bio_buffer_size_;             ///< Capacity of each direction of the BIO pair, the largest chunk per send or recv
+            std::unique_ptr<OpenSSLMemoryBIOEngine> p_tls_engine_;  ///< Memory BIO engine of the current connection, nullptr when TLS runs on the socket
+            bool has_ciphertext_eof_;                   ///< The peer closed the socket, only used by the memory BIO engine
             int server_tcp_socket_fd_;                  ///< Server Socket descriptor
+            int epoll_read_fd_;                         ///< epoll instance watching the server socket for reads (Linux only)
+            int epoll_write_fd_;                        ///< epoll instance watching the server socket for writes (Linux only)
+
+            // Read-ahead buffer
+            size_t read_ahead_buffer_size_;                     ///< Configured read-ahead capacity in bytes, 0 disables read-ahead
+            util::Vector<unsigned char> read_ahead_buffer_;     ///< Decrypted bytes read ahead of the caller's requests
+            size_t read_ahead_start_;                           ///< Offset of the first unconsumed byte in the read-ahead buffer
+            size_t read_ahead_end_;                             ///< Offset one past the last buffered byte
+            std::atomic<size_t> read_ahead_allocated_bytes_;    ///< Capacity of the read-ahead buffer, readable without the read mutex
+
+            // Reactor
+            std::shared_ptr<OpenSSLReactor> p_reactor_;         ///< Reactor driving reads, nullptr to read on the caller's thread
+            std::atomic_bool is_reactor_attached_;              ///< True while the socket is registered with the reactor
+            std::mutex inbound_mutex_;                          ///< Protects the read-ahead buffer while attached to the reactor
+            std::condition_variable inbound_cv_;                ///< Signalled when the reactor buffered more data or hit an error
+            ResponseCode inbound_status_;                       ///< Error hit by the reactor, returned once buffered data is consumed
+            bool is_inbound_paused_;                            ///< True while the read-ahead buffer is full and the socket isn't watched
+
+            // Session resumption
+            SSL_SESSION *p_ssl_session_;                        ///< Last resumable session negotiated with the endpoint
+            util::String ssl_session_endpoint_;                 ///< Endpoint and port the cached session belongs to
+            util::String ssl_session_cache_path_;               ///< File the session is persisted to, empty to keep it in memory only
+            std::atomic<int64_t> last_handshake_duration_usecs_;    ///< Duration of the last completed handshake
+
+            // TLS 1.3 early data
+            bool early_data_enabled_;                           ///< Boolean.  True = the caller accepts that early data may be replayed
+            std::atomic_bool is_early_data_pending_;            ///< Handshake deferred, writes go out as early data
+            util::String early_data_buffer_;                    ///< Copy of the early data sent, resent if the server rejects it
+            std::chrono::steady_clock::time_point early_handshake_start_;      ///< Start of the deferred handshake
+            std::chrono::steady_clock::time_point early_handshake_deadline_;   ///< Deadline of the deferred handshake
+
+            /**
+             * @brief Wait until the server socket becomes readable or writable
+             *
+             * Parks the calling thread on the connection's epoll instance for that direction. Falls back to select()
+             * on platforms without epoll. Waits never extend past the deadline, however many times they are repeated.
+             * The time spent is recorded in the socket wait histogram.
+             *
+             * @param bool wait_for_write - true to wait for writability, false to wait for readability
+             * @param std::chrono::steady_clock::time_point deadline - monotonic deadline of the current operation
+             * @return int - positive if the socket is ready, 0 on timeout, -1 on error
+             */
+            int WaitForSocket(bool wait_for_write, const std::chrono::steady_clock::time_point &deadline);
+
+            /**
+             * @brief Wait for the server socket without recording statistics, see WaitForSocket()
+             */
+            int WaitForSocketReadiness(bool wait_for_write, const std::chrono::steady_clock::time_point &deadline);
+
+            /**
+             * @brief OpenSSL message callback counting the TLS records sent and received
+             *
+             * Installed with SSL_set_msg_callback, arg is the connection.
+             */
+            static void CountRecordCallback(int write_p, int version, int content_type, const void *buf, size_t len,
+                                            SSL *ssl, void *arg);
+
+            /**
+             * @brief Body of the thread logging the statistics every dump interval
+             */
+            void StatsDumpThread();
+
+            /**
+             * @brief Stop the statistics dump thread
+             */
+            void StopStatsDumpThread();
+
+            /**
+             * @brief Wait until a TLS operation that returned SSL_ERROR_WANT_READ or SSL_ERROR_WANT_WRITE can be retried
+             *
+             * Without the memory BIO engine this just waits for the socket. With it, wanting to write means the BIO
+             * pair is full and is flushed to the socket, wanting to read means ciphertext is received into the BIO
+             * pair, waiting for the socket as needed. Pending outgoing ciphertext is not sent while waiting to read.
+             *
+             * @param bool wait_for_write - true if the operation wants to write, false if it wants to read
+             * @param std::chrono::steady_clock::time_point deadline - monotonic deadline of the current operation
+             * @return int - positive if the operation can be retried, 0 on timeout, -1 on error
+             */
+            int WaitForTLSProgress(bool wait_for_write, const std::chrono::steady_clock::time_point &deadline);
+
+            /**
+             * @brief Send all ciphertext pending in the memory BIO engine
+             *
+             * Each send() hands over the largest contiguous block the BIO pair holds.
+             *
+             * @param std::chrono::steady_clock::time_point deadline - monotonic deadline of the current operation
+             * @param bool waited_out - set to true if the socket had to be waited for
+             * @return ResponseCode - successful operation, write timeout or write error
+             */
+            ResponseCode FlushOutgoingCiphertext(const std::chrono::steady_clock::time_point &deadline,
+                                                 bool &waited_out);
+
+            /**
+             * @brief Receive whatever ciphertext the socket holds straight into the memory BIO engine, without waiting
+             *
+             * @return int - positive if ciphertext arrived or the peer closed the socket, 0 if the socket had nothing
+             * to read, -1 on error
+             */
+            int ReceiveIncomingCiphertext();
+
+            /**
+             * @brief Apply the configured cipher and group preferences to the current SSL handle
+             *
+             * @return ResponseCode - successful operation or TLS init error if OpenSSL rejected a preference
+             */
+            ResponseCode ApplyCipherPreferences();
+
+            /**
+             * @brief Create the read and write epoll instances for the current server socket
+             *
+             * @return ResponseCode - successful operation or TCP setup error
+             */
+            ResponseCode SetupSocketReadiness();
 
+            /**
+             * @brief Close the epoll instances, if any
+             */
+            void CloseSocketReadiness();
 
             /**
              * @brief Set TLS socket to non-blocking mode
              *
+             * @param int socket_fd - socket descriptor to update
              * @return ResponseCode - successful operation or TLS error
              */
-            ResponseCode SetSocketToNonBlocking();
+            ResponseCode SetSocketToNonBlocking(int socket_fd);
 
             /**
              * @brief Create a TCP socket and open the connection
              *
-             * Creates an open socket connection
+             * Resolves the endpoint with getaddrinfo, reusing cached addresses while they are fresh, and races
+             * non-blocking connects to the candidates Happy Eyeballs style, alternating address families. The whole
+             * operation is bounded by the TLS handshake timeout.
              *
              * @return ResponseCode - successful connection or TCP error
              */
-            ResponseCode ConnectTCPSocket();
+            ResponseCode ConnectTCPSocket(const std::chrono::steady_clock::time_point &deadline);
 
             /**
              * @brief Attempt connection
              *
              * Attempts TLS Connection
              *
+             * @param std::chrono::steady_clock::time_point deadline - deadline shared with the TCP connect
              * @return ResponseCode - successful connection or TLS error
              */
-            ResponseCode AttemptConnect();
+            ResponseCode AttemptConnect(const std::chrono::steady_clock::time_point &deadline);
 
             /**
              * @brief Create a TLS socket and open the connection
              *
-             * Creates an open socket connection including TLS handshake.
+             * Creates an open socket connection including TLS handshake. With an endpoint pool, tries the pool's
+             * candidates in order until one accepts.
              *
              * @return ResponseCode - successful connection or TLS error
              */
             ResponseCode ConnectInternal();
 
+            /**
+             * @brief Open the connection to the current endpoint
+             *
+             * @param std::chrono::steady_clock::time_point handshake_deadline - deadline for TCP connect and handshake
+             * @param std::chrono::milliseconds connect_timeout - longest time the TCP connect alone may take
+             * @return ResponseCode - successful connection or TLS error
+             */
+            ResponseCode ConnectEndpoint(const std::chrono::steady_clock::time_point &handshake_deadline,
+                                         std::chrono::milliseconds connect_timeout);
+
+            /**
+             * @brief Connect the TCP socket and run the TLS handshake, on a handshake pool worker if there is a pool
+             *
+             * @param std::chrono::steady_clock::time_point handshake_deadline - deadline for TCP connect and handshake
+             * @param std::chrono::milliseconds connect_timeout - longest time the TCP connect alone may take, counted
+             * from when the connect starts
+             * @return ResponseCode - successful connection or TLS error
+             */
+            ResponseCode OpenSession(const std::chrono::steady_clock::time_point &handshake_deadline,
+                                     std::chrono::milliseconds connect_timeout);
+
+            /**
+             * @brief Tell the endpoint pool that the current endpoint failed if the result means the connection died
+             *
+             * @param ResponseCode rc - result of a read or write
+             */
+            void ReportTransportError(ResponseCode rc);
+
             /**
              * @brief Write bytes to the network socket
              *
@@ -116,6 +327,61 @@ namespace awsiotsdk {
              */
             ResponseCode WriteInternal(const util::String &buf, size_t &size_written_bytes_out);
 
+            /**
+             * @brief Write a list of buffers, must be called with the write mutex held
+             *
+             * A single buffer is handed to OpenSSL as it is. Several buffers are packed into shared records, except
+             * that buffers of a full record or more are written straight from the caller's memory. With a cork
+             * window they are queued instead.
+             *
+             * @param const ByteSpan * - buffers to write, in order
+             * @param size_t - number of buffers
+             * @param size_t - reference to store the total number of bytes written
+             * @return ResponseCode - successful write or Network error code
+             */
+            ResponseCode WriteSpansInternal(const ByteSpan *p_bufs, size_t buf_count, size_t &size_written_bytes_out);
+
+            /**
+             * @brief Write raw bytes through the TLS layer
+             *
+             * Writes larger than the maximum TLS record are split into full sized records by OpenSSL.
+             *
+             * @param const char * - bytes to write
+             * @param size_t - number of bytes to write
+             * @param size_t - reference to store number of bytes written
+             * @return ResponseCode - successful write or Network error code
+             */
+            ResponseCode WriteBytesInternal(const char *p_data, size_t bytes_to_write, size_t &size_written_bytes_out);
+
+            /**
+             * @brief Queue bytes in the cork buffer, flushing it if it is full or the window expired
+             *
+             * Must be called with the write mutex held.
+             *
+             * @param const ByteSpan * - buffers to queue
+             * @param size_t - number of buffers
+             * @param size_t - reference to store number of bytes accepted
+             * @return ResponseCode - successful write or Network error code from this or an earlier flush
+             */
+            ResponseCode CorkWriteInternal(const ByteSpan *p_bufs, size_t buf_count, size_t &size_written_bytes_out);
+
+            /**
+             * @brief Write out the cork buffer, must be called with the write and cork mutexes held
+             *
+             * @return ResponseCode - successful write or Network error code
+             */
+            ResponseCode FlushCorkBufferLocked();
+
+            /**
+             * @brief Body of the thread flushing the cork buffer when the cork window expires
+             */
+            void CorkFlushThread();
+
+            /**
+             * @brief Stop the cork flush thread and write out anything still held back
+             */
+            void StopCorkFlushThread();
+
             /**
              * @brief Read bytes from the network socket
              *
@@ -127,6 +393,156 @@ namespace awsiotsdk {
             ResponseCode ReadInternal(util::Vector<unsigned char> &buf, size_t buf_read_offset,
                                       size_t size_bytes_to_read, size_t &size_read_bytes_out);
 
+            /**
+             * @brief Fill a buffer with exactly its length in bytes, must be called with the read mutex held
+             *
+             * @param MutableByteSpan - buffer where read bytes should be copied
+             * @param size_t - reference to store number of bytes read
+             * @return ResponseCode - successful read or TLS error code
+             */
+            ResponseCode ReadBytesInternal(MutableByteSpan buf, size_t &size_read_bytes_out);
+
+            /**
+             * @brief Read on the caller's thread, through the read-ahead buffer
+             *
+             * @param MutableByteSpan - buffer where read bytes should be copied
+             * @param size_t - reference to store number of bytes read
+             * @return ResponseCode - successful read or TLS error code
+             */
+            ResponseCode DirectReadInternal(MutableByteSpan buf, size_t &size_read_bytes_out);
+
+            /**
+             * @brief Fill the read-ahead buffer until it holds at least the requested number of bytes
+             *
+             * Each SSL_read asks for as much as the buffer can hold, so whole TLS records are drained at once. Bytes
+             * already buffered are kept if the read times out, so a later read resumes without losing data.
+             *
+             * @param size_t - minimum number of bytes that must be buffered on success
+             * @param std::chrono::steady_clock::time_point - deadline of the read operation
+             * @param bool - set to true if the read had to wait on the socket
+             * @return ResponseCode - successful read or TLS error code
+             */
+            ResponseCode FillReadAheadBuffer(size_t min_buffered_bytes,
+                                             const std::chrono::steady_clock::time_point &deadline,
+                                             bool &waited_out);
+
+            /**
+             * @brief Allocate the read-ahead buffer if it was released while idle
+             */
+            void AllocateReadAheadBuffer();
+
+            /**
+             * @brief Free the read-ahead buffer if it holds no data
+             *
+             * Only does anything in lean mode. Must be called with the read mutex held.
+             */
+            void ReleaseIdleReadBuffer();
+
+            /**
+             * @brief Free the write coalescing buffer
+             *
+             * Only does anything in lean mode. Must be called with the write mutex held.
+             */
+            void ReleaseIdleWriteBuffers();
+
+            /**
+             * @brief Read from the read-ahead buffer filled by the reactor
+             *
+             * Waits on the inbound condition variable instead of the socket. A request is only served once it can be
+             * served completely, so a timeout never loses data. The buffer grows to fit requests larger than it.
+             *
+             * @param MutableByteSpan - buffer where read bytes should be copied
+             * @param size_t - reference to store number of bytes read
+             * @return ResponseCode - successful read or TLS error code
+             */
+            ResponseCode ReactorReadInternal(MutableByteSpan buf, size_t &size_read_bytes_out);
+
+            /**
+             * @brief Called by a reactor thread when the socket is ready
+             *
+             * @return OpenSSLReactor::Interest - what to wait for before calling again
+             */
+            OpenSSLReactor::Interest OnReactorEvent();
+
+            /**
+             * @brief Decrypt everything available into the read-ahead buffer, must be called with the inbound mutex held
+             *
+             * Stops and pauses if the buffer fills up, reading resumes once the MQTT layer consumed some of it.
+             *
+             * @return OpenSSLReactor::Interest - what to wait for before calling again
+             */
+            OpenSSLReactor::Interest PumpInboundLocked();
+
+            /**
+             * @brief Detach the socket from the reactor and wake up any waiting read
+             */
+            void DetachFromReactor();
+
+            /**
+             * @brief Record the outcome of a blocking operation in the latency histograms and timeout statistics
+             *
+             * @param OperationType - operation that completed
+             * @param std::chrono::steady_clock::time_point - when the operation started
+             * @param bool - true if the operation ran into its deadline
+             */
+            void RecordBlockingOperation(OperationType operation, const std::chrono::steady_clock::time_point &start,
+                                         bool timed_out);
+
+            /**
+             * @brief Verify the server and update the handshake statistics once the handshake finished
+             *
+             * @param ResponseCode - result of the handshake
+             * @param std::chrono::steady_clock::time_point - when the TCP connect started
+             * @return ResponseCode - successful connection or TLS error
+             */
+            ResponseCode CompleteHandshake(ResponseCode handshake_rc,
+                                           const std::chrono::steady_clock::time_point &handshake_start);
+
+            /**
+             * @brief Check if the next connection can defer its handshake and send early data
+             *
+             * @return bool - true if early data is enabled and the cached session allows it
+             */
+            bool CanSendEarlyData();
+
+            /**
+             * @brief Send data as TLS 1.3 early data, must be called with the write mutex held
+             *
+             * Data which would exceed the server's early data limit completes the handshake first and is written
+             * normally.
+             *
+             * @return ResponseCode - successful write or TLS error
+             */
+            ResponseCode WriteEarlyData(const char *p_data, size_t bytes_to_write, size_t &size_written_bytes_out);
+
+            /**
+             * @brief Complete a deferred handshake, must be called with the write mutex held
+             *
+             * Resends the early data as regular application data if the server rejected it.
+             *
+             * @return ResponseCode - successful connection or TLS error
+             */
+            ResponseCode FinishEarlyDataHandshake();
+
+            /**
+             * @brief Keep the session negotiated on the current connection for the next connect
+             *
+             * Called after the handshake and again before shutdown, since TLS 1.3 tickets arrive after the handshake.
+             * Persists the session to the session cache file if one is configured.
+             */
+            void UpdateCachedSession();
+
+            /**
+             * @brief Load a previously persisted session from the session cache file, if it belongs to the current
+             * endpoint and port
+             */
+            void LoadPersistedSession();
+
+            /**
+             * @brief Drop the cached session, for example after the endpoint changed
+             */
+            void ClearCachedSession();
+
             /**
              * @brief Disconnect from network socket
              *
@@ -135,7 +551,6 @@ namespace awsiotsdk {
             ResponseCode DisconnectInternal();
 
         public:
-
             OpenSSLConnection(util::String endpoint, uint16_t endpoint_port,
                               std::chrono::milliseconds tls_handshake_timeout,
                               std::chrono::milliseconds tls_read_timeout,
@@ -172,7 +587,8 @@ namespace awsiotsdk {
             /**
              * @brief Initialize the OpenSSL object
              *
-             * Initializes the OpenSSL object
+             * Initializes the OpenSSL library once per process. The SSL context is shared between connections using
+             * the same credentials and is acquired on the first connection attempt.
              */
             ResponseCode Initialize();
 
@@ -197,6 +613,308 @@ namespace awsiotsdk {
                 endpoint_port_ = endpoint_port;
             }
 
+            /**
+             * @brief Set how long resolved endpoint addresses are cached
+             *
+             * Reconnects within this window skip DNS resolution. The cache entry is dropped early if none of the
+             * cached addresses accept a connection.
+             *
+             * @param std::chrono::seconds dns_cache_ttl - cache lifetime, 0 resolves on every connect
+             */
+            void SetDnsCacheTtl(std::chrono::seconds dns_cache_ttl) { dns_cache_ttl_ = dns_cache_ttl; }
+
+            /**
+             * @brief Set the TCP socket options from a named profile
+             *
+             * LOW_LATENCY disables Nagle's algorithm, caps the unsent backlog with TCP_NOTSENT_LOWAT and detects a dead
+             * peer within about ten seconds through keepalive and TCP_USER_TIMEOUT. BULK_THROUGHPUT uses 1 MB socket
+             * buffers. LOW_POWER keeps buffers small and probes an idle connection every five minutes only. Takes
+             * effect on the next connection.
+             *
+             * @param OpenSSLSocketTuning::Profile profile - profile to use, SYSTEM_DEFAULT sets no options
+             */
+            void SetSocketProfile(OpenSSLSocketTuning::Profile profile) {
+                socket_tuning_ = OpenSSLSocketTuning::ForProfile(profile);
+            }
+
+            /**
+             * @brief Set individual TCP socket options, takes effect on the next connection
+             *
+             * @param OpenSSLSocketTuning socket_tuning - options to apply, usually a profile with some values changed
+             */
+            void SetSocketTuning(const OpenSSLSocketTuning &socket_tuning) { socket_tuning_ = socket_tuning; }
+
+            /**
+             * @brief Fail over between the endpoints of a pool instead of always using the configured endpoint
+             *
+             * Connects go to the pool's fastest healthy endpoint and move on to the next candidate when it doesn't
+             * accept, giving each candidate but the last one at most one read timeout. A connection that dies with a
+             * read or write error marks its endpoint unhealthy, so the reconnect that follows goes elsewhere. The
+             * endpoint and port then track whichever endpoint the connection is using. Takes effect on the next
+             * connection.
+             *
+             * @param std::shared_ptr<OpenSSLEndpointPool> p_endpoint_pool - pool to use, nullptr to use the endpoint
+             */
+            void SetEndpointPool(std::shared_ptr<OpenSSLEndpointPool> p_endpoint_pool) {
+                p_endpoint_pool_ = p_endpoint_pool;
+            }
+
+            /**
+             * @brief Run TCP connects and TLS handshakes on a pool shared with other connections
+             *
+             * Bounds how many handshakes run at once when many connections reconnect together, see
+             * OpenSSLHandshakePool. Connect() still blocks until the handshake is done. It fails with ACTION_QUEUE_FULL
+             * when the pool turns the attempt away. Takes effect on the next connection.
+             *
+             * @param std::shared_ptr<OpenSSLHandshakePool> p_handshake_pool - pool to use, nullptr to handshake on the
+             * calling thread
+             */
+            void SetHandshakePool(std::shared_ptr<OpenSSLHandshakePool> p_handshake_pool) {
+                p_handshake_pool_ = p_handshake_pool;
+            }
+
+            /**
+             * @brief Get the host the connection currently uses
+             *
+             * @return util::String - endpoint host
+             */
+            util::String GetEndpoint() const { return endpoint_; }
+
+            /**
+             * @brief Get the smoothed TCP round trip time measured by the kernel for the current connection
+             *
+             * @return std::chrono::microseconds - round trip time, zero if not connected or not available
+             */
+            std::chrono::microseconds GetTcpRtt();
+
+            /**
+             * @brief Write several packets in as few TLS records as possible
+             *
+             * The buffers are packed back to back so small MQTT packets share records instead of paying the record
+             * header, MAC and padding each. If a cork window is set the packets are queued with any other held back
+             * writes instead.
+             *
+             * @param util::Vector<util::String> bufs - packets to write, in order
+             * @param size_t size_written_bytes_out - reference to store the total number of bytes written
+             * @return ResponseCode - successful write or Network error code
+             */
+            ResponseCode WriteBatch(const util::Vector<util::String> &bufs, size_t &size_written_bytes_out);
+
+            // The span overloads below would hide the base class versions
+            using NetworkConnection::Read;
+            using NetworkConnection::Write;
+
+            /**
+             * @brief Write bytes the caller owns without copying them into a string first
+             *
+             * Lets a packet serialized into a reusable buffer go to OpenSSL as it is.
+             *
+             * @param ByteSpan buf - bytes to write, only needed until the call returns
+             * @param size_t size_written_bytes_out - reference to store the number of bytes written
+             * @return ResponseCode - successful write or Network error code
+             */
+            ResponseCode Write(ByteSpan buf, size_t &size_written_bytes_out);
+
+            /**
+             * @brief Write several buffers the caller owns, in order, as one write
+             *
+             * Small buffers are packed into shared TLS records like WriteBatch(). Buffers of a full record or more are
+             * encrypted straight from the caller's memory. Useful to send a packet header and a payload that live in
+             * different places.
+             *
+             * @param util::Vector<ByteSpan> bufs - buffers to write, only needed until the call returns
+             * @param size_t size_written_bytes_out - reference to store the total number of bytes written
+             * @return ResponseCode - successful write or Network error code
+             */
+            ResponseCode Write(const util::Vector<ByteSpan> &bufs, size_t &size_written_bytes_out);
+
+            /**
+             * @brief Read exactly as many bytes as the buffer holds into memory the caller owns
+             *
+             * @param MutableByteSpan buf - buffer to fill
+             * @param size_t size_read_bytes_out - reference to store the number of bytes read
+             * @return ResponseCode - successful read or TLS error code
+             */
+            ResponseCode Read(MutableByteSpan buf, size_t &size_read_bytes_out);
+
+            /**
+             * @brief Set how long small writes may be held back to be coalesced with later ones
+             *
+             * While corked, writes return as soon as the data is queued and are flushed once the oldest queued byte
+             * has waited for the window or a full TLS record is queued. Errors from a background flush are returned
+             * by the next write. Takes effect on the next connection.
+             *
+             * @param std::chrono::microseconds write_cork_window - cork window, 0 writes every packet immediately
+             */
+            void SetWriteCorkWindow(std::chrono::microseconds write_cork_window) {
+                write_cork_window_ = write_cork_window;
+            }
+
+            /**
+             * @brief Set the cipher and key exchange preferences offered in the handshake
+             *
+             * Lets a profile be picked per board, for example ChaCha20-Poly1305 on CPUs without AES instructions, or
+             * X25519 ahead of the NIST curves. Each argument uses OpenSSL's list syntax and an empty string keeps the
+             * library default. The device certificate's key type is chosen by the certificate files. Takes effect on
+             * the next connection.
+             *
+             * @param util::String cipher_list - cipher list for TLS 1.2, e.g. "ECDHE-ECDSA-AES128-GCM-SHA256"
+             * @param util::String ciphersuites - TLS 1.3 ciphersuites, e.g. "TLS_CHACHA20_POLY1305_SHA256"
+             * @param util::String groups - key exchange groups, e.g. "X25519:P-256"
+             */
+            void SetCipherPreferences(util::String cipher_list, util::String ciphersuites, util::String groups) {
+                tls_cipher_list_ = cipher_list;
+                tls_ciphersuites_ = ciphersuites;
+                tls_groups_ = groups;
+            }
+
+            /**
+             * @brief Get the protocol version and cipher negotiated for the current connection
+             *
+             * @return util::String - e.g. "TLSv1.3 TLS_AES_128_GCM_SHA256", empty if not connected
+             */
+            util::String GetNegotiatedCipher();
+
+            /**
+             * @brief Enable Linux kernel TLS offload
+             *
+             * Once the handshake completes, OpenSSL installs the negotiated keys in the kernel so records are
+             * encrypted and decrypted by the socket layer, saving a copy through OpenSSL's record buffers. Needs
+             * OpenSSL 3.0 built with kTLS support, the kernel tls module and a cipher the kernel implements. When any
+             * of these are missing the connection silently stays in user space. Takes effect on the next connection.
+             *
+             * @param bool kernel_tls_enabled - true to try kTLS offload
+             */
+            void SetKernelTLSEnabled(bool kernel_tls_enabled) { kernel_tls_enabled_ = kernel_tls_enabled; }
+
+            /**
+             * @brief Check if record encryption for writes is done by the kernel
+             *
+             * @return bool - true if kTLS transmit offload is active, always false before OpenSSL 3.0
+             */
+            bool IsKernelTLSSendActive();
+
+            /**
+             * @brief Check if record decryption for reads is done by the kernel
+             *
+             * @return bool - true if kTLS receive offload is active, always false before OpenSSL 3.0
+             */
+            bool IsKernelTLSReceiveActive();
+
+            /**
+             * @brief Let a shared reactor drive reads for this connection
+             *
+             * Once connected, the socket is handed to the reactor, whose threads decrypt incoming records into the
+             * read-ahead buffer. Reads then wait for the reactor instead of each blocking on their own socket. The
+             * TLS handshake and writes still run on the caller's thread. Takes effect on the next connection.
+             *
+             * @param std::shared_ptr<OpenSSLReactor> p_reactor - reactor to attach to, nullptr to read directly
+             */
+            void SetReactor(std::shared_ptr<OpenSSLReactor> p_reactor) { p_reactor_ = p_reactor; }
+
+            /**
+             * @brief Check if reads are currently driven by a reactor
+             *
+             * @return bool - true if the connection is attached to a reactor
+             */
+            bool IsReactorAttached() const { return is_reactor_attached_; }
+
+            /**
+             * @brief Enable the low memory footprint mode
+             *
+             * Meant for processes holding thousands of mostly idle connections. OpenSSL frees its record buffers
+             * whenever they are empty, a 4 KB maximum fragment length is requested so the peer never needs a full
+             * 16 KB record buffer, the read-ahead buffer is capped at one fragment and the read-ahead and write buffers
+             * are released while the connection is idle. Costs an allocation per burst of traffic. The SSL context is
+             * shared between connections either way. Takes effect on the next connection.
+             *
+             * @param bool lean_mode_enabled - true to minimize idle memory
+             */
+            void SetLeanModeEnabled(bool lean_mode_enabled) { lean_mode_enabled_ = lean_mode_enabled; }
+
+            /**
+             * @brief Run TLS over an in-memory BIO pair instead of directly on the socket
+             *
+             * OpenSSL then never touches the socket. Ciphertext produced by writes collects in the BIO pair and is
+             * sent in as few send() calls as the BIO pair size allows, and reads receive as much ciphertext as is
+             * available in one recv() instead of one or two socket reads per record. Plaintext is still decrypted
+             * straight into the caller's buffer for large reads. kTLS offload is not available with this engine, and
+             * the BIO pair buffers live as long as the connection, so it is not meant to be combined with lean mode.
+             * Takes effect on the next connection.
+             *
+             * @param bool memory_bio_engine_enabled - true to use the memory BIO engine
+             */
+            void SetMemoryBIOEngineEnabled(bool memory_bio_engine_enabled) {
+                memory_bio_engine_enabled_ = memory_bio_engine_enabled;
+            }
+
+            /**
+             * @brief Set the capacity of each direction of the memory BIO pair
+             *
+             * Bounds the size of a single send() or recv(). Values below one full TLS record are raised to that.
+             * Takes effect on the next connection.
+             *
+             * @param size_t memory_bio_buffer_size - capacity in bytes
+             */
+            void SetMemoryBIOBufferSize(size_t memory_bio_buffer_size) {
+                memory_bio_buffer_size_ = memory_bio_buffer_size;
+            }
+
+            /**
+             * @brief Check if the current connection runs on the memory BIO engine
+             *
+             * @return bool - true if TLS runs over the memory BIO pair
+             */
+            bool IsMemoryBIOEngineActive() const { return nullptr != p_tls_engine_; }
+
+            /**
+             * @brief Get the number of send() calls made by the memory BIO engine
+             *
+             * @return uint64_t - send count
+             */
+            uint64_t GetCiphertextSendCount() const { return stats_.Get(OpenSSLConnectionStats::Counter::CIPHERTEXT_SENDS); }
+
+            /**
+             * @brief Get the number of recv() calls made by the memory BIO engine
+             *
+             * @return uint64_t - receive count
+             */
+            uint64_t GetCiphertextRecvCount() const { return stats_.Get(OpenSSLConnectionStats::Counter::CIPHERTEXT_RECVS); }
+
+            /**
+             * @brief Get the number of bytes currently held by this connection's own buffers
+             *
+             * Covers the read-ahead, cork and write coalescing buffers. Memory held inside OpenSSL is not included,
+             * use GetProcessResidentMemory() across many connections to measure that.
+             *
+             * @return size_t - buffer footprint in bytes
+             */
+            size_t GetBufferFootprint();
+
+            /**
+             * @brief Get the resident set size of the current process
+             *
+             * @return size_t - resident memory in bytes, 0 if the platform doesn't report it
+             */
+            static size_t GetProcessResidentMemory();
+
+#ifndef WIN32
+            /**
+             * @brief Send part of a file over the connection
+             *
+             * Uses SSL_sendfile, and so the kernel's sendfile path without copying through user space, when kTLS
+             * transmit offload is active. Otherwise falls back to reading the file in record sized chunks.
+             *
+             * @param int file_fd - descriptor of the file to send
+             * @param off_t offset - offset in the file to start from
+             * @param size_t size - number of bytes to send
+             * @param size_t size_written_bytes_out - reference to store number of bytes sent, also on failure
+             * @return ResponseCode - successful write, FILE_OPEN_ERROR if the file can't be read that far, or
+             *                        Network error code
+             */
+            ResponseCode SendFile(int file_fd, off_t offset, size_t size, size_t &size_written_bytes_out);
+#endif
+
             /**
              * @brief Check if TLS layer is still connected
              *
@@ -215,6 +933,156 @@ namespace awsiotsdk {
              */
             bool IsPhysicalLayerConnected();
 
+            /**
+             * @brief Set the size of the read-ahead buffer
+             *
+             * Small reads issued by the MQTT client are served from this buffer instead of separate SSL_read calls.
+             * Takes effect on the next connection. A size of 0 disables read-ahead.
+             *
+             * @param size_t read_ahead_buffer_size - capacity of the read-ahead buffer in bytes
+             */
+            void SetReadAheadBufferSize(size_t read_ahead_buffer_size) { read_ahead_buffer_size_ = read_ahead_buffer_size; }
+
+            /**
+             * @brief Get the number of reads served entirely from the read-ahead buffer
+             *
+             * @return uint64_t - read-ahead hit count
+             */
+            uint64_t GetReadAheadHitCount() const { return stats_.Get(OpenSSLConnectionStats::Counter::READ_AHEAD_HITS); }
+
+            /**
+             * @brief Get the number of reads that had to go to the TLS layer
+             *
+             * @return uint64_t - read-ahead miss count
+             */
+            uint64_t GetReadAheadMissCount() const {
+                return stats_.Get(OpenSSLConnectionStats::Counter::READ_AHEAD_MISSES);
+            }
+
+            /**
+             * @brief Get the number of operations of a type that ran into their deadline
+             *
+             * @param OperationType operation - operation to query
+             * @return uint64_t - timeout count
+             */
+            uint64_t GetTimeoutCount(OperationType operation) const {
+                return stats_.GetTimeoutCount(static_cast<OpenSSLConnectionStats::Latency>(operation));
+            }
+
+            /**
+             * @brief Get the longest time an operation of a type spent before completing or timing out
+             *
+             * Only operations that had to wait on the socket are tracked.
+             *
+             * @param OperationType operation - operation to query
+             * @return std::chrono::microseconds - longest blocking time
+             */
+            std::chrono::microseconds GetMaxBlockedTime(OperationType operation) const {
+                return stats_.GetMax(static_cast<OpenSSLConnectionStats::Latency>(operation));
+            }
+
+            /**
+             * @brief Persist the TLS session to a file so resumption survives a process restart
+             *
+             * The file holds session secrets and is created readable by the owner only. Its first line names the
+             * "<endpoint>:<port>" the session belongs to, a session for any other endpoint is not offered. An empty
+             * path keeps the session in memory only, which is the default.
+             *
+             * @param util::String ssl_session_cache_path - path of the session cache file
+             */
+            void SetSessionCachePath(util::String ssl_session_cache_path) {
+                ssl_session_cache_path_ = ssl_session_cache_path;
+            }
+
+            /**
+             * @brief Check if the current connection resumed a previous TLS session
+             *
+             * @return bool - true if the last handshake was abbreviated
+             */
+            bool IsSessionReused();
+
+            /**
+             * @brief Get the number of full handshakes completed by this connection
+             *
+             * @return uint64_t - full handshake count
+             */
+            uint64_t GetFullHandshakeCount() const { return stats_.Get(OpenSSLConnectionStats::Counter::FULL_HANDSHAKES); }
+
+            /**
+             * @brief Get the number of resumed handshakes completed by this connection
+             *
+             * @return uint64_t - resumed handshake count
+             */
+            uint64_t GetResumedHandshakeCount() const {
+                return stats_.Get(OpenSSLConnectionStats::Counter::RESUMED_HANDSHAKES);
+            }
+
+            /**
+             * @brief Get the duration of the last completed handshake
+             *
+             * @return std::chrono::microseconds - handshake duration, zero if no handshake completed yet
+             */
+            std::chrono::microseconds GetLastHandshakeDuration() const {
+                return std::chrono::microseconds(last_handshake_duration_usecs_.load());
+            }
+
+            /**
+             * @brief Send the first writes of a resumed connection as TLS 1.3 early data (0-RTT)
+             *
+             * When the cached session allows early data, Connect() returns as soon as the TCP connection is up and
+             * defers the handshake. Writes made before the first read, such as an MQTT CONNECT and a PUBLISH, then go
+             * out in the first flight together with the ClientHello. The first read completes the handshake. If the
+             * server rejects the early data, it is resent as regular data once the handshake completed, so nothing is
+             * lost but the round trip isn't saved. Not used together with a reactor.
+             *
+             * Early data is not protected against replay, an attacker can deliver it to the server more than once.
+             * Only enable this if every message the application sends right after connecting is safe to process
+             * twice, for example an idempotent sensor reading. Takes effect on the next connection.
+             *
+             * @param bool early_data_enabled - true to accept the replay risk and send early data
+             */
+            void SetEarlyDataEnabled(bool early_data_enabled) { early_data_enabled_ = early_data_enabled; }
+
+            /**
+             * @brief Get the number of connections whose early data was accepted by the server
+             *
+             * @return uint64_t - accepted count
+             */
+            uint64_t GetEarlyDataAcceptedCount() const {
+                return stats_.Get(OpenSSLConnectionStats::Counter::EARLY_DATA_ACCEPTED);
+            }
+
+            /**
+             * @brief Get the number of connections whose early data was rejected and resent after the handshake
+             *
+             * @return uint64_t - rejected count
+             */
+            uint64_t GetEarlyDataRejectedCount() const {
+                return stats_.Get(OpenSSLConnectionStats::Counter::EARLY_DATA_REJECTED);
+            }
+
+            /**
+             * @brief Get the I/O statistics of this connection
+             *
+             * Counters and histograms accumulate over every connection made through this object. They are updated
+             * with relaxed atomics on per-thread shards, so they can be queried from any thread while I/O is running.
+             *
+             * @return const OpenSSLConnectionStats & - statistics, valid for the lifetime of this object
+             */
+            const OpenSSLConnectionStats &GetStats() const { return stats_; }
+
+            /**
+             * @brief Periodically log the I/O statistics at info level
+             *
+             * A background thread writes one line with every counter and the p50, p99 and p99.9 of every histogram
+             * while the connection is up. Takes effect on the next connection.
+             *
+             * @param std::chrono::seconds stats_dump_interval - time between dumps, 0 disables the dump
+             */
+            void SetStatsDumpInterval(std::chrono::seconds stats_dump_interval) {
+                stats_dump_interval_ = stats_dump_interval;
+            }
+
             virtual ~OpenSSLConnection();
         };
     }
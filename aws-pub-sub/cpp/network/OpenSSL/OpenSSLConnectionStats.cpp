@@ -0,0 +1,160 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLConnectionStats.cpp
+ * @brief
+ *
+ */
+
+#include <stdio.h>
+#include <algorithm>
+
+#include "OpenSSLConnectionStats.hpp"
+
+namespace awsiotsdk {
+    namespace network {
+        namespace {
+            const char *counter_names[] = {
+                "bytes_read", "bytes_written", "records_read", "records_written", "ssl_read_calls", "ssl_write_calls",
+                "want_read_waits", "want_write_waits", "read_ahead_hits", "read_ahead_misses", "full_handshakes",
+                "resumed_handshakes", "early_data_accepted", "early_data_rejected", "ciphertext_sends",
+                "ciphertext_recvs"
+            };
+
+            const char *latency_names[] = {"handshake", "read", "write", "socket_wait"};
+
+            std::atomic<size_t> next_thread_shard(0);
+        }
+
+        OpenSSLConnectionStats::OpenSSLConnectionStats() {
+            for (int shard = 0; shard < OPENSSL_STATS_SHARD_COUNT; shard++) {
+                for (int counter = 0; counter < static_cast<int>(Counter::COUNT); counter++) {
+                    shards_[shard].counters_[counter] = 0;
+                }
+                for (int latency = 0; latency < static_cast<int>(Latency::COUNT); latency++) {
+                    for (int bucket = 0; bucket < OPENSSL_STATS_LATENCY_BUCKET_COUNT; bucket++) {
+                        shards_[shard].latency_buckets_[latency][bucket] = 0;
+                    }
+                }
+            }
+            for (int latency = 0; latency < static_cast<int>(Latency::COUNT); latency++) {
+                timeout_counts_[latency] = 0;
+                max_latency_usecs_[latency] = 0;
+            }
+        }
+
+        OpenSSLConnectionStats::Shard &OpenSSLConnectionStats::GetThreadShard() {
+            // Assigned once per thread, so a thread always lands on the same shard of every connection
+            static thread_local size_t thread_shard =
+                next_thread_shard.fetch_add(1, std::memory_order_relaxed) % OPENSSL_STATS_SHARD_COUNT;
+            return shards_[thread_shard];
+        }
+
+        void OpenSSLConnectionStats::RecordLatency(Latency latency, std::chrono::microseconds duration,
+                                                   bool timed_out) {
+            int latency_index = static_cast<int>(latency);
+            int64_t duration_usecs = duration.count();
+            int bucket = 0;
+            for (int64_t remaining = duration_usecs >> 1;
+                 0 < remaining && bucket < OPENSSL_STATS_LATENCY_BUCKET_COUNT - 1; remaining >>= 1) {
+                bucket++;
+            }
+            GetThreadShard().latency_buckets_[latency_index][bucket].fetch_add(1, std::memory_order_relaxed);
+
+            int64_t max_usecs = max_latency_usecs_[latency_index].load(std::memory_order_relaxed);
+            while (duration_usecs > max_usecs &&
+                !max_latency_usecs_[latency_index].compare_exchange_weak(max_usecs, duration_usecs,
+                                                                         std::memory_order_relaxed)) {
+            }
+            if (timed_out) {
+                timeout_counts_[latency_index].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        uint64_t OpenSSLConnectionStats::Get(Counter counter) const {
+            uint64_t value = 0;
+            for (int shard = 0; shard < OPENSSL_STATS_SHARD_COUNT; shard++) {
+                value += shards_[shard].counters_[static_cast<int>(counter)].load(std::memory_order_relaxed);
+            }
+            return value;
+        }
+
+        uint64_t OpenSSLConnectionStats::GetSampleCount(Latency latency) const {
+            uint64_t sample_count = 0;
+            for (int shard = 0; shard < OPENSSL_STATS_SHARD_COUNT; shard++) {
+                for (int bucket = 0; bucket < OPENSSL_STATS_LATENCY_BUCKET_COUNT; bucket++) {
+                    sample_count += shards_[shard].latency_buckets_[static_cast<int>(latency)][bucket].load(
+                        std::memory_order_relaxed);
+                }
+            }
+            return sample_count;
+        }
+
+        std::chrono::microseconds OpenSSLConnectionStats::GetPercentile(Latency latency, double percentile) const {
+            uint64_t buckets[OPENSSL_STATS_LATENCY_BUCKET_COUNT];
+            uint64_t sample_count = 0;
+            for (int bucket = 0; bucket < OPENSSL_STATS_LATENCY_BUCKET_COUNT; bucket++) {
+                buckets[bucket] = 0;
+                for (int shard = 0; shard < OPENSSL_STATS_SHARD_COUNT; shard++) {
+                    buckets[bucket] += shards_[shard].latency_buckets_[static_cast<int>(latency)][bucket].load(
+                        std::memory_order_relaxed);
+                }
+                sample_count += buckets[bucket];
+            }
+            if (0 == sample_count) {
+                return std::chrono::microseconds(0);
+            }
+
+            // Rank of the sample the percentile falls on, counting from 1
+            uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(sample_count) + 0.5);
+            if (0 == rank) {
+                rank = 1;
+            }
+            uint64_t seen_count = 0;
+            for (int bucket = 0; bucket < OPENSSL_STATS_LATENCY_BUCKET_COUNT - 1; bucket++) {
+                seen_count += buckets[bucket];
+                if (seen_count >= rank) {
+                    return std::min(std::chrono::microseconds(int64_t(1) << (bucket + 1)), GetMax(latency));
+                }
+            }
+            // Beyond the last bound, the largest sample is the best estimate
+            return GetMax(latency);
+        }
+
+        util::String OpenSSLConnectionStats::ToString() const {
+            util::String stats_str;
+            char entry[256];
+            for (int counter = 0; counter < static_cast<int>(Counter::COUNT); counter++) {
+                snprintf(entry, sizeof(entry), "%s%s=%llu", 0 == counter ? "" : " ", counter_names[counter],
+                         static_cast<unsigned long long>(Get(static_cast<Counter>(counter))));
+                stats_str.append(entry);
+            }
+            for (int latency = 0; latency < static_cast<int>(Latency::COUNT); latency++) {
+                Latency latency_type = static_cast<Latency>(latency);
+                snprintf(entry, sizeof(entry), " %s={n=%llu p50=%lldus p99=%lldus p999=%lldus max=%lldus timeouts=%llu}",
+                         latency_names[latency],
+                         static_cast<unsigned long long>(GetSampleCount(latency_type)),
+                         static_cast<long long>(GetPercentile(latency_type, 50.0).count()),
+                         static_cast<long long>(GetPercentile(latency_type, 99.0).count()),
+                         static_cast<long long>(GetPercentile(latency_type, 99.9).count()),
+                         static_cast<long long>(GetMax(latency_type).count()),
+                         static_cast<unsigned long long>(GetTimeoutCount(latency_type)));
+                stats_str.append(entry);
+            }
+            return stats_str;
+        }
+    }
+}
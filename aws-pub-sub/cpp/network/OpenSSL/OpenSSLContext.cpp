@@ -0,0 +1,158 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLContext.cpp
+ * @brief
+ *
+ */
+
+#include <map>
+#include <mutex>
+
+#include "OpenSSLContext.hpp"
+#include "util/logging/LogMacros.hpp"
+
+#define OPENSSL_CONTEXT_LOG_TAG "[OpenSSL Context]"
+
+namespace awsiotsdk {
+    namespace network {
+        namespace {
+            std::mutex context_cache_mutex;
+            std::map<util::String, std::weak_ptr<OpenSSLContext>> context_cache;
+        }
+
+        OpenSSLContext::OpenSSLContext(util::String root_ca_location, util::String device_cert_location,
+                                       util::String device_private_key_location) {
+            root_ca_location_ = root_ca_location;
+            device_cert_location_ = device_cert_location;
+            device_private_key_location_ = device_private_key_location;
+            p_ssl_context_ = nullptr;
+        }
+
+        ResponseCode OpenSSLContext::InitializeLibrary() {
+            static std::once_flag library_init_flag;
+            static ResponseCode library_init_rc = ResponseCode::SUCCESS;
+
+            std::call_once(library_init_flag, []() {
+                OpenSSL_add_all_algorithms();
+                ERR_load_BIO_strings();
+                ERR_load_crypto_strings();
+                SSL_load_error_strings();
+
+                if (SSL_library_init() < 0) {
+                    library_init_rc = ResponseCode::NETWORK_SSL_INIT_ERROR;
+                }
+            });
+
+            return library_init_rc;
+        }
+
+        util::String OpenSSLContext::GetCacheKey(const util::String &root_ca_location,
+                                                 const util::String &device_cert_location,
+                                                 const util::String &device_private_key_location) {
+            util::String cache_key = root_ca_location;
+            cache_key.append("\n");
+            cache_key.append(device_cert_location);
+            cache_key.append("\n");
+            cache_key.append(device_private_key_location);
+            return cache_key;
+        }
+
+        ResponseCode OpenSSLContext::LoadCredentials() {
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+            // Any version from TLS 1.2 up, so TLS 1.3 ciphersuites can be negotiated where the server supports them
+            const SSL_METHOD *method = TLS_client_method();
+#else
+            const SSL_METHOD *method = TLSv1_2_method();
+#endif
+
+            if ((p_ssl_context_ = SSL_CTX_new(method)) == NULL) {
+                AWS_LOG_ERROR(OPENSSL_CONTEXT_LOG_TAG, " SSL INIT Failed - Unable to create SSL Context");
+                return ResponseCode::NETWORK_SSL_INIT_ERROR;
+            }
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+            SSL_CTX_set_min_proto_version(p_ssl_context_, TLS1_2_VERSION);
+#endif
+
+            // Sessions are cached by each connection, see OpenSSLConnection::UpdateCachedSession()
+            SSL_CTX_set_session_cache_mode(p_ssl_context_, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+
+            AWS_LOG_DEBUG(OPENSSL_CONTEXT_LOG_TAG, "Root CA : %s", root_ca_location_.c_str());
+            if (!SSL_CTX_load_verify_locations(p_ssl_context_, root_ca_location_.c_str(), NULL)) {
+                AWS_LOG_ERROR(OPENSSL_CONTEXT_LOG_TAG, " Root CA Loading error");
+                return ResponseCode::NETWORK_SSL_ROOT_CRT_PARSE_ERROR;
+            }
+
+            if (0 < device_cert_location_.length() && 0 < device_private_key_location_.length()) {
+                AWS_LOG_DEBUG(OPENSSL_CONTEXT_LOG_TAG, "Device crt : %s", device_cert_location_.c_str());
+                if (!SSL_CTX_use_certificate_file(p_ssl_context_, device_cert_location_.c_str(), SSL_FILETYPE_PEM)) {
+                    AWS_LOG_ERROR(OPENSSL_CONTEXT_LOG_TAG, " Device Certificate Loading error");
+                    return ResponseCode::NETWORK_SSL_DEVICE_CRT_PARSE_ERROR;
+                }
+                AWS_LOG_DEBUG(OPENSSL_CONTEXT_LOG_TAG, "Device privkey : %s", device_private_key_location_.c_str());
+                if (1 != SSL_CTX_use_PrivateKey_file(p_ssl_context_,
+                                                     device_private_key_location_.c_str(),
+                                                     SSL_FILETYPE_PEM)) {
+                    AWS_LOG_ERROR(OPENSSL_CONTEXT_LOG_TAG, " Device Private Key Loading error");
+                    return ResponseCode::NETWORK_SSL_KEY_PARSE_ERROR;
+                }
+            }
+
+            return ResponseCode::SUCCESS;
+        }
+
+        ResponseCode OpenSSLContext::Acquire(util::String root_ca_location, util::String device_cert_location,
+                                             util::String device_private_key_location,
+                                             std::shared_ptr<OpenSSLContext> &p_context_out) {
+            ResponseCode rc = InitializeLibrary();
+            if (ResponseCode::SUCCESS != rc) {
+                return rc;
+            }
+
+            util::String cache_key = GetCacheKey(root_ca_location, device_cert_location, device_private_key_location);
+
+            // Held while loading so a reconnect storm parses the files once instead of once per connection
+            std::lock_guard<std::mutex> cache_guard(context_cache_mutex);
+
+            std::shared_ptr<OpenSSLContext> p_context = context_cache[cache_key].lock();
+            if (nullptr == p_context) {
+                p_context = std::shared_ptr<OpenSSLContext>(
+                    new OpenSSLContext(root_ca_location, device_cert_location, device_private_key_location));
+                rc = p_context->LoadCredentials();
+                if (ResponseCode::SUCCESS != rc) {
+                    context_cache.erase(cache_key);
+                    return rc;
+                }
+                context_cache[cache_key] = p_context;
+            }
+
+            p_context_out = p_context;
+            return ResponseCode::SUCCESS;
+        }
+
+        bool OpenSSLContext::Matches(const util::String &root_ca_location, const util::String &device_cert_location,
+                                     const util::String &device_private_key_location) const {
+            return root_ca_location_ == root_ca_location && device_cert_location_ == device_cert_location &&
+                device_private_key_location_ == device_private_key_location;
+        }
+
+        OpenSSLContext::~OpenSSLContext() {
+            if (nullptr != p_ssl_context_) {
+                SSL_CTX_free(p_ssl_context_);
+            }
+        }
+    }
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLEndpointPool.cpp
+ * @brief
+ *
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+
+#include "OpenSSLEndpointPool.hpp"
+#include "OpenSSLConnection.hpp"
+#include "util/logging/LogMacros.hpp"
+
+#define OPENSSL_ENDPOINT_POOL_LOG_TAG "[OpenSSL Endpoint Pool]"
+
+namespace awsiotsdk {
+    namespace network {
+        namespace {
+            void UpdateSmoothed(int64_t &smoothed_usecs, std::chrono::microseconds sample) {
+                if (0 >= sample.count()) {
+                    return;
+                }
+                if (0 == smoothed_usecs) {
+                    smoothed_usecs = sample.count();
+                } else {
+                    smoothed_usecs += (sample.count() - smoothed_usecs) / OPENSSL_ENDPOINT_POOL_SMOOTHING_DIVISOR;
+                }
+            }
+        }
+
+        OpenSSLEndpointPool::OpenSSLEndpointPool(util::String root_ca_location, util::String device_cert_location,
+                                                 util::String device_private_key_location,
+                                                 std::chrono::milliseconds probe_timeout) {
+            root_ca_location_ = root_ca_location;
+            device_cert_location_ = device_cert_location;
+            device_private_key_location_ = device_private_key_location;
+            probe_timeout_ = probe_timeout;
+            is_probe_thread_running_ = false;
+            probe_interval_ = std::chrono::seconds(0);
+        }
+
+        OpenSSLEndpointPool::EndpointState *OpenSSLEndpointPool::FindEndpointLocked(const util::String &host,
+                                                                                    uint16_t port) {
+            for (size_t itr = 0; itr < endpoints_.size(); itr++) {
+                if (endpoints_[itr].endpoint.host == host && endpoints_[itr].endpoint.port == port) {
+                    return &endpoints_[itr];
+                }
+            }
+            return nullptr;
+        }
+
+        void OpenSSLEndpointPool::AddEndpoint(util::String host, uint16_t port) {
+            std::lock_guard<std::mutex> endpoints_guard(endpoints_mutex_);
+            if (nullptr != FindEndpointLocked(host, port)) {
+                return;
+            }
+            EndpointState state;
+            state.endpoint.host = host;
+            state.endpoint.port = port;
+            state.is_healthy = true;
+            state.smoothed_rtt_usecs = 0;
+            state.smoothed_handshake_usecs = 0;
+            state.consecutive_failures = 0;
+            endpoints_.push_back(state);
+        }
+
+        ResponseCode OpenSSLEndpointPool::AddEndpoints(const util::String &endpoint_list, uint16_t default_port) {
+            size_t entry_start = 0;
+            while (entry_start <= endpoint_list.length()) {
+                size_t entry_end = endpoint_list.find(',', entry_start);
+                if (util::String::npos == entry_end) {
+                    entry_end = endpoint_list.length();
+                }
+                util::String entry = endpoint_list.substr(entry_start, entry_end - entry_start);
+                entry_start = entry_end + 1;
+
+                // Trim surrounding blanks so "a, b" works as well
+                size_t first = entry.find_first_not_of(" \t");
+                if (util::String::npos == first) {
+                    continue;
+                }
+                entry = entry.substr(first, entry.find_last_not_of(" \t") - first + 1);
+
+                util::String host = entry;
+                util::String port_str;
+                if ('[' == entry[0]) {
+                    size_t bracket_end = entry.find(']');
+                    if (util::String::npos == bracket_end) {
+                        AWS_LOG_ERROR(OPENSSL_ENDPOINT_POOL_LOG_TAG, "Malformed endpoint %s", entry.c_str());
+                        return ResponseCode::NETWORK_TCP_NO_ENDPOINT_SPECIFIED;
+                    }
+                    host = entry.substr(1, bracket_end - 1);
+                    if (bracket_end + 1 < entry.length()) {
+                        if (':' != entry[bracket_end + 1]) {
+                            AWS_LOG_ERROR(OPENSSL_ENDPOINT_POOL_LOG_TAG, "Malformed endpoint %s", entry.c_str());
+                            return ResponseCode::NETWORK_TCP_NO_ENDPOINT_SPECIFIED;
+                        }
+                        port_str = entry.substr(bracket_end + 2);
+                    }
+                } else if (entry.find(':') == entry.rfind(':') && util::String::npos != entry.find(':')) {
+                    // A single colon separates the port, more than one is a bare IPv6 literal
+                    host = entry.substr(0, entry.find(':'));
+                    port_str = entry.substr(entry.find(':') + 1);
+                }
+
+                uint16_t port = default_port;
+                if (!port_str.empty()) {
+                    char *p_end = nullptr;
+                    unsigned long parsed_port = strtoul(port_str.c_str(), &p_end, 10);
+                    if ('\0' != *p_end || 0 == parsed_port || 65535 < parsed_port) {
+                        AWS_LOG_ERROR(OPENSSL_ENDPOINT_POOL_LOG_TAG, "Malformed endpoint %s", entry.c_str());
+                        return ResponseCode::NETWORK_TCP_NO_ENDPOINT_SPECIFIED;
+                    }
+                    port = static_cast<uint16_t>(parsed_port);
+                }
+                if (host.empty()) {
+                    AWS_LOG_ERROR(OPENSSL_ENDPOINT_POOL_LOG_TAG, "Malformed endpoint %s", entry.c_str());
+                    return ResponseCode::NETWORK_TCP_NO_ENDPOINT_SPECIFIED;
+                }
+                AddEndpoint(host, port);
+            }
+            return ResponseCode::SUCCESS;
+        }
+
+        size_t OpenSSLEndpointPool::GetEndpointCount() {
+            std::lock_guard<std::mutex> endpoints_guard(endpoints_mutex_);
+            return endpoints_.size();
+        }
+
+        util::Vector<OpenSSLEndpointPool::Endpoint> OpenSSLEndpointPool::GetCandidates() {
+            util::Vector<EndpointState> ranked;
+            {
+                std::lock_guard<std::mutex> endpoints_guard(endpoints_mutex_);
+                ranked = endpoints_;
+            }
+
+            // Stable, so endpoints that compare equal keep the order they were added in
+            std::stable_sort(ranked.begin(), ranked.end(), [](const EndpointState &lhs, const EndpointState &rhs) {
+                if (lhs.is_healthy != rhs.is_healthy) {
+                    return lhs.is_healthy;
+                }
+                if (!lhs.is_healthy) {
+                    return lhs.last_failure < rhs.last_failure;
+                }
+                bool lhs_measured = 0 < lhs.smoothed_rtt_usecs || 0 < lhs.smoothed_handshake_usecs;
+                bool rhs_measured = 0 < rhs.smoothed_rtt_usecs || 0 < rhs.smoothed_handshake_usecs;
+                if (lhs_measured != rhs_measured) {
+                    return lhs_measured;
+                }
+                if (lhs.smoothed_rtt_usecs != rhs.smoothed_rtt_usecs) {
+                    return lhs.smoothed_rtt_usecs < rhs.smoothed_rtt_usecs;
+                }
+                return lhs.smoothed_handshake_usecs < rhs.smoothed_handshake_usecs;
+            });
+
+            util::Vector<Endpoint> candidates;
+            for (size_t itr = 0; itr < ranked.size(); itr++) {
+                candidates.push_back(ranked[itr].endpoint);
+            }
+            return candidates;
+        }
+
+        void OpenSSLEndpointPool::ReportSuccess(const util::String &host, uint16_t port,
+                                                std::chrono::microseconds handshake_duration,
+                                                std::chrono::microseconds rtt) {
+            std::lock_guard<std::mutex> endpoints_guard(endpoints_mutex_);
+            EndpointState *p_state = FindEndpointLocked(host, port);
+            if (nullptr == p_state) {
+                return;
+            }
+            if (!p_state->is_healthy) {
+                AWS_LOG_INFO(OPENSSL_ENDPOINT_POOL_LOG_TAG, "Endpoint %s:%u is healthy again", host.c_str(),
+                             (unsigned int) port);
+            }
+            p_state->is_healthy = true;
+            p_state->consecutive_failures = 0;
+            UpdateSmoothed(p_state->smoothed_handshake_usecs, handshake_duration);
+            UpdateSmoothed(p_state->smoothed_rtt_usecs, rtt);
+        }
+
+        void OpenSSLEndpointPool::ReportFailure(const util::String &host, uint16_t port) {
+            std::lock_guard<std::mutex> endpoints_guard(endpoints_mutex_);
+            EndpointState *p_state = FindEndpointLocked(host, port);
+            if (nullptr == p_state) {
+                return;
+            }
+            if (p_state->is_healthy) {
+                AWS_LOG_WARN(OPENSSL_ENDPOINT_POOL_LOG_TAG, "Endpoint %s:%u marked unhealthy", host.c_str(),
+                             (unsigned int) port);
+            }
+            p_state->is_healthy = false;
+            p_state->consecutive_failures++;
+            p_state->last_failure = std::chrono::steady_clock::now();
+        }
+
+        void OpenSSLEndpointPool::ProbeAll() {
+            util::Vector<Endpoint> endpoints;
+            {
+                std::lock_guard<std::mutex> endpoints_guard(endpoints_mutex_);
+                for (size_t itr = 0; itr < endpoints_.size(); itr++) {
+                    endpoints.push_back(endpoints_[itr].endpoint);
+                }
+            }
+
+            for (size_t itr = 0; itr < endpoints.size(); itr++) {
+                // A fresh connection each time, so every probe measures a full handshake
+                OpenSSLConnection probe_connection(endpoints[itr].host, endpoints[itr].port, root_ca_location_,
+                                                   device_cert_location_, device_private_key_location_,
+                                                   probe_timeout_, probe_timeout_, probe_timeout_, true);
+                ResponseCode rc = probe_connection.Initialize();
+                if (ResponseCode::SUCCESS == rc) {
+                    rc = probe_connection.Connect();
+                }
+                if (ResponseCode::SUCCESS != rc) {
+                    AWS_LOG_DEBUG(OPENSSL_ENDPOINT_POOL_LOG_TAG, "Probe of %s:%u failed. %s",
+                                  endpoints[itr].host.c_str(), (unsigned int) endpoints[itr].port,
+                                  ResponseHelper::ToString(rc).c_str());
+                    ReportFailure(endpoints[itr].host, endpoints[itr].port);
+                    continue;
+                }
+
+                std::chrono::microseconds handshake_duration = probe_connection.GetLastHandshakeDuration();
+                std::chrono::microseconds rtt = probe_connection.GetTcpRtt();
+                probe_connection.Disconnect();
+                AWS_LOG_DEBUG(OPENSSL_ENDPOINT_POOL_LOG_TAG, "Probe of %s:%u - rtt %lldus, handshake %lldus",
+                              endpoints[itr].host.c_str(), (unsigned int) endpoints[itr].port,
+                              static_cast<long long>(rtt.count()), static_cast<long long>(handshake_duration.count()));
+                ReportSuccess(endpoints[itr].host, endpoints[itr].port, handshake_duration, rtt);
+            }
+        }
+
+        void OpenSSLEndpointPool::ProbeThread() {
+            std::unique_lock<std::mutex> probe_lock(probe_mutex_);
+            while (is_probe_thread_running_) {
+                if (std::cv_status::timeout == probe_cv_.wait_for(probe_lock, probe_interval_)) {
+                    probe_lock.unlock();
+                    ProbeAll();
+                    probe_lock.lock();
+                }
+            }
+        }
+
+        void OpenSSLEndpointPool::StartProbing(std::chrono::seconds probe_interval) {
+            StopProbing();
+            if (0 >= probe_interval.count()) {
+                return;
+            }
+            probe_interval_ = probe_interval;
+            is_probe_thread_running_ = true;
+            p_probe_thread_ = std::unique_ptr<std::thread>(new std::thread(&OpenSSLEndpointPool::ProbeThread, this));
+        }
+
+        void OpenSSLEndpointPool::StopProbing() {
+            if (nullptr != p_probe_thread_) {
+                {
+                    std::lock_guard<std::mutex> probe_guard(probe_mutex_);
+                    is_probe_thread_running_ = false;
+                    probe_cv_.notify_all();
+                }
+                p_probe_thread_->join();
+                p_probe_thread_.reset();
+            }
+        }
+
+        OpenSSLEndpointPool::~OpenSSLEndpointPool() {
+            StopProbing();
+        }
+    }
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLEndpointPool.hpp
+ * @brief Defines a pool of interchangeable endpoints ranked by measured latency
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "util/memory/stl/String.hpp"
+#include "util/memory/stl/Vector.hpp"
+#include "ResponseCode.hpp"
+
+// Weight of a new sample in the smoothed latencies, as a divisor
+#define OPENSSL_ENDPOINT_POOL_SMOOTHING_DIVISOR 4
+
+namespace awsiotsdk {
+    namespace network {
+        /**
+         * @brief Endpoints a connection can fail over between
+         *
+         * Holds the brokers a device may talk to, for example the regional AWS IoT endpoint, a backup region and a
+         * Greengrass core on the local network. Each endpoint is probed with a full TCP connect and TLS handshake
+         * using the device credentials, and the smoothed TCP round trip and handshake times are kept. Connections
+         * attached to the pool try the fastest healthy endpoint first and move down the list when it fails.
+         *
+         * Endpoints go unhealthy when a connection or probe to them fails, or when an established connection dies.
+         * They are healthy again after the next successful probe or connection. The pool is thread safe and may be
+         * shared by several connections.
+         */
+        class OpenSSLEndpointPool {
+        public:
+            /**
+             * @brief Host and port of an endpoint
+             */
+            struct Endpoint {
+                util::String host;      ///< Host name or address literal
+                uint16_t port;          ///< TCP port
+            };
+
+        protected:
+            /**
+             * @brief Measurements kept per endpoint
+             */
+            struct EndpointState {
+                Endpoint endpoint;                      ///< Host and port
+                bool is_healthy;                        ///< False after a failure until the next success
+                int64_t smoothed_rtt_usecs;             ///< Smoothed TCP round trip time, 0 if not measured yet
+                int64_t smoothed_handshake_usecs;       ///< Smoothed TCP connect plus TLS handshake time, 0 if not measured yet
+                uint32_t consecutive_failures;          ///< Failures since the last success
+                std::chrono::steady_clock::time_point last_failure;     ///< When the last failure happened
+            };
+
+            util::String root_ca_location_;             ///< Filename (including path) of the root CA file used by probes
+            util::String device_cert_location_;         ///< Filename (including path) of the device certificate used by probes
+            util::String device_private_key_location_;  ///< Filename (including path) of the device private key used by probes
+            std::chrono::milliseconds probe_timeout_;   ///< Timeout for a single probe
+
+            std::mutex endpoints_mutex_;                ///< Protects the endpoint states
+            util::Vector<EndpointState> endpoints_;     ///< Endpoints in the order they were added
+
+            std::mutex probe_mutex_;                    ///< Protects the probe thread's stop flag
+            std::condition_variable probe_cv_;          ///< Wakes the probe thread when probing is stopped
+            bool is_probe_thread_running_;              ///< Stop flag for the probe thread
+            std::chrono::seconds probe_interval_;       ///< Time between probe rounds
+            std::unique_ptr<std::thread> p_probe_thread_;   ///< Probes every endpoint once per interval
+
+            /**
+             * @brief Find the state of an endpoint, must be called with the endpoints mutex held
+             *
+             * @return EndpointState * - endpoint state, nullptr if the endpoint isn't part of the pool
+             */
+            EndpointState *FindEndpointLocked(const util::String &host, uint16_t port);
+
+            /**
+             * @brief Body of the thread probing all endpoints once per probe interval
+             */
+            void ProbeThread();
+
+        public:
+            /**
+             * @brief Constructor
+             *
+             * @param util::String root_ca_location - Path of the location of the Root CA
+             * @param util::String device_cert_location - Path to the location of the Device Cert
+             * @param util::String device_private_key_location - Path to the location of the device private key file
+             * @param std::chrono::milliseconds probe_timeout - Timeout for the TCP connect and TLS handshake of a probe
+             */
+            OpenSSLEndpointPool(util::String root_ca_location, util::String device_cert_location,
+                                util::String device_private_key_location, std::chrono::milliseconds probe_timeout);
+
+            // Disabling copy constructors
+            OpenSSLEndpointPool(const OpenSSLEndpointPool &) = delete;
+            OpenSSLEndpointPool &operator=(const OpenSSLEndpointPool &) = delete;
+
+            /**
+             * @brief Add an endpoint, endpoints already in the pool are ignored
+             *
+             * Endpoints added first are preferred while nothing has been measured.
+             *
+             * @param util::String host - host name or address literal
+             * @param uint16_t port - TCP port
+             */
+            void AddEndpoint(util::String host, uint16_t port);
+
+            /**
+             * @brief Add endpoints from a comma separated list
+             *
+             * Entries are "host" or "host:port", IPv6 literals with a port are written as "[address]:port".
+             *
+             * @param util::String endpoint_list - list of endpoints, e.g. "backup.example.com,192.168.1.10:8883"
+             * @param uint16_t default_port - port for entries that don't specify one
+             * @return ResponseCode - successful operation or NETWORK_TCP_NO_ENDPOINT_SPECIFIED for a malformed entry
+             */
+            ResponseCode AddEndpoints(const util::String &endpoint_list, uint16_t default_port);
+
+            /**
+             * @brief Get the number of endpoints in the pool
+             *
+             * @return size_t - endpoint count
+             */
+            size_t GetEndpointCount();
+
+            /**
+             * @brief Get the endpoints in the order they should be tried
+             *
+             * Healthy endpoints come first, fastest first, ranked by smoothed round trip time and then handshake time.
+             * Endpoints not measured yet follow in the order they were added. Unhealthy endpoints come last, the one
+             * that failed longest ago first, so a connection still has somewhere to go when everything looks down.
+             *
+             * @return util::Vector<Endpoint> - every endpoint, best first
+             */
+            util::Vector<Endpoint> GetCandidates();
+
+            /**
+             * @brief Record a successful connection or probe
+             *
+             * Zero durations are ignored, so a connection that deferred its handshake only restores health.
+             *
+             * @param util::String host - host of the endpoint
+             * @param uint16_t port - port of the endpoint
+             * @param std::chrono::microseconds handshake_duration - TCP connect plus TLS handshake time
+             * @param std::chrono::microseconds rtt - TCP round trip time
+             */
+            void ReportSuccess(const util::String &host, uint16_t port, std::chrono::microseconds handshake_duration,
+                               std::chrono::microseconds rtt);
+
+            /**
+             * @brief Record a failed connection or probe, or the loss of an established connection
+             *
+             * @param util::String host - host of the endpoint
+             * @param uint16_t port - port of the endpoint
+             */
+            void ReportFailure(const util::String &host, uint16_t port);
+
+            /**
+             * @brief Probe every endpoint once, one after the other
+             *
+             * Each probe opens a TLS connection with the device credentials, measures it and closes it again. No MQTT
+             * traffic is sent.
+             */
+            void ProbeAll();
+
+            /**
+             * @brief Probe every endpoint periodically on a background thread
+             *
+             * @param std::chrono::seconds probe_interval - time between probe rounds, 0 stops probing
+             */
+            void StartProbing(std::chrono::seconds probe_interval);
+
+            /**
+             * @brief Stop the background probe thread
+             */
+            void StopProbing();
+
+            virtual ~OpenSSLEndpointPool();
+        };
+    }
+}
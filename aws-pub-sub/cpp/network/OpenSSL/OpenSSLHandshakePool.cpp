@@ -0,0 +1,210 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLHandshakePool.cpp
+ * @brief
+ *
+ */
+
+#include <algorithm>
+
+#include "OpenSSLHandshakePool.hpp"
+#include "util/logging/LogMacros.hpp"
+
+#define OPENSSL_HANDSHAKE_POOL_LOG_TAG "[OpenSSL Handshake Pool]"
+
+namespace awsiotsdk {
+    namespace network {
+        OpenSSLHandshakePool::OpenSSLHandshakePool(size_t worker_count, size_t max_queued,
+                                                   std::chrono::milliseconds min_jitter_window,
+                                                   std::chrono::milliseconds max_jitter_window) {
+            if (0 == worker_count) {
+                worker_count = std::max(1u, std::thread::hardware_concurrency());
+            }
+            max_queued_ = max_queued;
+            min_jitter_window_ = min_jitter_window;
+            max_jitter_window_ = std::max(min_jitter_window, max_jitter_window);
+            is_running_ = true;
+            active_count_ = 0;
+            smoothed_handshake_usecs_ = 0;
+            completed_count_ = 0;
+            rejected_count_ = 0;
+            expired_count_ = 0;
+            jitter_engine_.seed(std::random_device()());
+
+            for (size_t itr = 0; itr < worker_count; itr++) {
+                workers_.push_back(std::unique_ptr<std::thread>(
+                    new std::thread(&OpenSSLHandshakePool::WorkerThread, this)));
+            }
+        }
+
+        std::chrono::steady_clock::duration OpenSSLHandshakePool::GetJitterLocked(
+            const std::chrono::steady_clock::time_point &deadline) {
+            size_t backlog = active_count_ + queue_.size();
+            if (backlog < workers_.size()) {
+                // A worker is free, waiting would only add latency
+                return std::chrono::steady_clock::duration::zero();
+            }
+
+            // Spread the handshakes over the time the workers need to get through the backlog
+            std::chrono::steady_clock::duration window = std::chrono::microseconds(
+                smoothed_handshake_usecs_ * static_cast<int64_t>(backlog) / static_cast<int64_t>(workers_.size()));
+            window = std::max(window, std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                min_jitter_window_));
+            window = std::min(window, std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                max_jitter_window_));
+            // Leave at least half of the handshake timeout for the handshake itself
+            window = std::min(window, (deadline - std::chrono::steady_clock::now()) / 2);
+            if (window <= std::chrono::steady_clock::duration::zero()) {
+                return std::chrono::steady_clock::duration::zero();
+            }
+
+            std::uniform_int_distribution<std::chrono::steady_clock::rep> jitter_distribution(0, window.count());
+            return std::chrono::steady_clock::duration(jitter_distribution(jitter_engine_));
+        }
+
+        ResponseCode OpenSSLHandshakePool::Run(HandshakeFunction handshake,
+                                               const std::chrono::steady_clock::time_point &deadline) {
+            std::shared_ptr<HandshakeJob> p_job = std::make_shared<HandshakeJob>();
+            p_job->handshake = handshake;
+            p_job->deadline = deadline;
+            p_job->is_started = false;
+            p_job->is_done = false;
+            p_job->result = ResponseCode::NETWORK_SSL_CONNECT_ERROR;
+
+            std::unique_lock<std::mutex> pool_lock(pool_mutex_);
+            if (!is_running_) {
+                return ResponseCode::NETWORK_SSL_CONNECT_ERROR;
+            }
+            if (queue_.size() >= max_queued_ && active_count_ + queue_.size() >= workers_.size()) {
+                rejected_count_++;
+                AWS_LOG_WARN(OPENSSL_HANDSHAKE_POOL_LOG_TAG,
+                             "%u handshakes already waiting, rejecting connection attempt",
+                             (unsigned int) queue_.size());
+                return ResponseCode::ACTION_QUEUE_FULL;
+            }
+
+            p_job->start_time = std::chrono::steady_clock::now() + GetJitterLocked(deadline);
+            queue_.push_back(p_job);
+            worker_cv_.notify_one();
+
+            while (!p_job->is_done) {
+                if (p_job->is_started) {
+                    // Running handshakes are bounded by the deadline themselves
+                    p_job->done_cv.wait(pool_lock);
+                } else if (std::cv_status::timeout == p_job->done_cv.wait_until(pool_lock, deadline) &&
+                           !p_job->is_started && !p_job->is_done) {
+                    queue_.erase(std::find(queue_.begin(), queue_.end(), p_job));
+                    expired_count_++;
+                    AWS_LOG_ERROR(OPENSSL_HANDSHAKE_POOL_LOG_TAG, "Handshake timed out waiting for a worker");
+                    return ResponseCode::NETWORK_SSL_CONNECT_TIMEOUT_ERROR;
+                }
+            }
+            return p_job->result;
+        }
+
+        void OpenSSLHandshakePool::WorkerThread() {
+            std::unique_lock<std::mutex> pool_lock(pool_mutex_);
+            while (is_running_) {
+                if (queue_.empty()) {
+                    worker_cv_.wait(pool_lock);
+                    continue;
+                }
+
+                util::Vector<std::shared_ptr<HandshakeJob>>::iterator next_job = std::min_element(
+                    queue_.begin(), queue_.end(),
+                    [](const std::shared_ptr<HandshakeJob> &lhs, const std::shared_ptr<HandshakeJob> &rhs) {
+                        return lhs->start_time < rhs->start_time;
+                    });
+                std::chrono::steady_clock::time_point start_time = (*next_job)->start_time;
+                if (std::chrono::steady_clock::now() < start_time) {
+                    worker_cv_.wait_until(pool_lock, start_time);
+                    continue;
+                }
+
+                std::shared_ptr<HandshakeJob> p_job = *next_job;
+                queue_.erase(next_job);
+                p_job->is_started = true;
+                active_count_++;
+                pool_lock.unlock();
+
+                std::chrono::steady_clock::time_point handshake_start = std::chrono::steady_clock::now();
+                ResponseCode rc = ResponseCode::NETWORK_SSL_CONNECT_TIMEOUT_ERROR;
+                if (handshake_start < p_job->deadline) {
+                    rc = p_job->handshake(p_job->deadline);
+                }
+                int64_t handshake_usecs = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - handshake_start).count();
+
+                pool_lock.lock();
+                active_count_--;
+                completed_count_++;
+                if (ResponseCode::SUCCESS == rc) {
+                    if (0 == smoothed_handshake_usecs_) {
+                        smoothed_handshake_usecs_ = handshake_usecs;
+                    } else {
+                        smoothed_handshake_usecs_ +=
+                            (handshake_usecs - smoothed_handshake_usecs_) / OPENSSL_HANDSHAKE_POOL_SMOOTHING_DIVISOR;
+                    }
+                }
+                p_job->result = rc;
+                p_job->is_done = true;
+                p_job->done_cv.notify_all();
+            }
+        }
+
+        size_t OpenSSLHandshakePool::GetWorkerCount() {
+            return workers_.size();
+        }
+
+        size_t OpenSSLHandshakePool::GetQueuedCount() {
+            std::lock_guard<std::mutex> pool_guard(pool_mutex_);
+            return queue_.size();
+        }
+
+        uint64_t OpenSSLHandshakePool::GetCompletedCount() {
+            std::lock_guard<std::mutex> pool_guard(pool_mutex_);
+            return completed_count_;
+        }
+
+        uint64_t OpenSSLHandshakePool::GetRejectedCount() {
+            std::lock_guard<std::mutex> pool_guard(pool_mutex_);
+            return rejected_count_;
+        }
+
+        uint64_t OpenSSLHandshakePool::GetExpiredCount() {
+            std::lock_guard<std::mutex> pool_guard(pool_mutex_);
+            return expired_count_;
+        }
+
+        OpenSSLHandshakePool::~OpenSSLHandshakePool() {
+            {
+                std::lock_guard<std::mutex> pool_guard(pool_mutex_);
+                is_running_ = false;
+                for (size_t itr = 0; itr < queue_.size(); itr++) {
+                    queue_[itr]->result = ResponseCode::NETWORK_SSL_CONNECT_ERROR;
+                    queue_[itr]->is_done = true;
+                    queue_[itr]->done_cv.notify_all();
+                }
+                queue_.clear();
+                worker_cv_.notify_all();
+            }
+            for (size_t itr = 0; itr < workers_.size(); itr++) {
+                workers_[itr]->join();
+            }
+        }
+    }
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLMemoryBIOEngine.cpp
+ * @brief
+ *
+ */
+
+#include "OpenSSLMemoryBIOEngine.hpp"
+#include "util/logging/LogMacros.hpp"
+
+#define OPENSSL_ENGINE_LOG_TAG "[OpenSSL Memory BIO Engine]"
+
+namespace awsiotsdk {
+    namespace network {
+        OpenSSLMemoryBIOEngine::OpenSSLMemoryBIOEngine() {
+            p_ssl_handle_ = nullptr;
+            p_network_bio_ = nullptr;
+            is_ssl_handle_owned_ = true;
+        }
+
+        std::unique_ptr<OpenSSLMemoryBIOEngine> OpenSSLMemoryBIOEngine::Create(SSL_CTX *p_ssl_context,
+                                                                               size_t bio_buffer_size) {
+            std::unique_ptr<OpenSSLMemoryBIOEngine> p_engine =
+                std::unique_ptr<OpenSSLMemoryBIOEngine>(new OpenSSLMemoryBIOEngine());
+
+            p_engine->p_ssl_handle_ = SSL_new(p_ssl_context);
+            if (nullptr == p_engine->p_ssl_handle_) {
+                AWS_LOG_ERROR(OPENSSL_ENGINE_LOG_TAG, " Unable to create SSL handle");
+                return nullptr;
+            }
+
+            if (!p_engine->SetupBIOPair(bio_buffer_size)) {
+                return nullptr;
+            }
+
+            return p_engine;
+        }
+
+        std::unique_ptr<OpenSSLMemoryBIOEngine> OpenSSLMemoryBIOEngine::Attach(SSL *p_ssl_handle,
+                                                                               size_t bio_buffer_size) {
+            std::unique_ptr<OpenSSLMemoryBIOEngine> p_engine =
+                std::unique_ptr<OpenSSLMemoryBIOEngine>(new OpenSSLMemoryBIOEngine());
+
+            p_engine->p_ssl_handle_ = p_ssl_handle;
+            p_engine->is_ssl_handle_owned_ = false;
+            if (!p_engine->SetupBIOPair(bio_buffer_size)) {
+                return nullptr;
+            }
+
+            return p_engine;
+        }
+
+        bool OpenSSLMemoryBIOEngine::SetupBIOPair(size_t bio_buffer_size) {
+            BIO *p_tls_bio = nullptr;
+            if (1 != BIO_new_bio_pair(&p_tls_bio, bio_buffer_size, &p_network_bio_, bio_buffer_size)) {
+                AWS_LOG_ERROR(OPENSSL_ENGINE_LOG_TAG, " Unable to create BIO pair");
+                return false;
+            }
+            // The SSL handle takes ownership of the TLS side
+            SSL_set_bio(p_ssl_handle_, p_tls_bio, p_tls_bio);
+            SSL_set_connect_state(p_ssl_handle_);
+            return true;
+        }
+
+        int OpenSSLMemoryBIOEngine::Handshake() {
+            int ret = SSL_do_handshake(p_ssl_handle_);
+            return 1 == ret ? SSL_ERROR_NONE : SSL_get_error(p_ssl_handle_, ret);
+        }
+
+        int OpenSSLMemoryBIOEngine::Read(unsigned char *p_buf, size_t length, size_t &read_length_out) {
+            int ret = SSL_read(p_ssl_handle_, p_buf, (int) length);
+            if (0 < ret) {
+                read_length_out = (size_t) ret;
+                return SSL_ERROR_NONE;
+            }
+            read_length_out = 0;
+            return SSL_get_error(p_ssl_handle_, ret);
+        }
+
+        int OpenSSLMemoryBIOEngine::Write(const unsigned char *p_buf, size_t length, size_t &written_length_out) {
+            int ret = SSL_write(p_ssl_handle_, p_buf, (int) length);
+            if (0 < ret) {
+                written_length_out = (size_t) ret;
+                return SSL_ERROR_NONE;
+            }
+            written_length_out = 0;
+            return SSL_get_error(p_ssl_handle_, ret);
+        }
+
+        void OpenSSLMemoryBIOEngine::Shutdown() {
+            SSL_shutdown(p_ssl_handle_);
+        }
+
+        size_t OpenSSLMemoryBIOEngine::GetOutgoingCiphertextLength() {
+            return BIO_ctrl_pending(p_network_bio_);
+        }
+
+        size_t OpenSSLMemoryBIOEngine::PeekOutgoingCiphertext(const char **pp_data) {
+            char *p_data = nullptr;
+            int length = BIO_nread0(p_network_bio_, &p_data);
+            if (0 >= length) {
+                *pp_data = nullptr;
+                return 0;
+            }
+            *pp_data = p_data;
+            return (size_t) length;
+        }
+
+        void OpenSSLMemoryBIOEngine::ConsumeOutgoingCiphertext(size_t length) {
+            char *p_data = nullptr;
+            BIO_nread(p_network_bio_, &p_data, (int) length);
+        }
+
+        size_t OpenSSLMemoryBIOEngine::GetIncomingCiphertextSpace() {
+            return BIO_ctrl_get_write_guarantee(p_network_bio_);
+        }
+
+        size_t OpenSSLMemoryBIOEngine::WriteIncomingCiphertext(const unsigned char *p_data, size_t length) {
+            int ret = BIO_write(p_network_bio_, p_data, (int) length);
+            return 0 < ret ? (size_t) ret : 0;
+        }
+
+        size_t OpenSSLMemoryBIOEngine::PeekIncomingCiphertextSpace(char **pp_space) {
+            char *p_space = nullptr;
+            int length = BIO_nwrite0(p_network_bio_, &p_space);
+            if (0 >= length) {
+                *pp_space = nullptr;
+                return 0;
+            }
+            *pp_space = p_space;
+            return (size_t) length;
+        }
+
+        void OpenSSLMemoryBIOEngine::CommitIncomingCiphertext(size_t length) {
+            char *p_space = nullptr;
+            BIO_nwrite(p_network_bio_, &p_space, (int) length);
+        }
+
+        void OpenSSLMemoryBIOEngine::SetIncomingEndOfStream() {
+            BIO_shutdown_wr(p_network_bio_);
+        }
+
+        OpenSSLMemoryBIOEngine::~OpenSSLMemoryBIOEngine() {
+            if (is_ssl_handle_owned_ && nullptr != p_ssl_handle_) {
+                SSL_free(p_ssl_handle_);
+            }
+            if (nullptr != p_network_bio_) {
+                BIO_free(p_network_bio_);
+            }
+        }
+    }
+}
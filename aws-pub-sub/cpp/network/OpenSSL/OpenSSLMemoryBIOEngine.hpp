@@ -0,0 +1,194 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLMemoryBIOEngine.hpp
+ * @brief Defines a TLS engine running OpenSSL over an in-memory BIO pair
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <openssl/ssl.h>
+#include <openssl/bio.h>
+#include <openssl/err.h>
+
+namespace awsiotsdk {
+    namespace network {
+        /**
+         * @brief TLS engine decoupled from any socket
+         *
+         * Runs an SSL client handle over a BIO pair. The TLS side of the pair is owned by the SSL handle, the network
+         * side is driven by the caller, who moves ciphertext between it and whatever transport is in use, in chunks
+         * of its choosing. Outgoing ciphertext can be handed to the transport straight out of the pair's buffer.
+         * Plaintext is read directly into and written directly from the caller's buffers.
+         *
+         * Not thread safe, callers serialize access to an engine.
+         *
+         * TLS operations return the SSL_get_error() code of the underlying call, SSL_ERROR_NONE on success.
+         * SSL_ERROR_WANT_READ means more ciphertext has to be written in, SSL_ERROR_WANT_WRITE means outgoing
+         * ciphertext has to be read out before the operation can make progress.
+         */
+        class OpenSSLMemoryBIOEngine {
+        protected:
+            SSL *p_ssl_handle_;     ///< SSL Handle, owns the TLS side of the BIO pair
+            BIO *p_network_bio_;    ///< Network side of the BIO pair
+            bool is_ssl_handle_owned_;  ///< True if the SSL handle is freed along with the engine
+
+            OpenSSLMemoryBIOEngine();
+
+            /**
+             * @brief Create the BIO pair and switch the SSL handle over to it
+             *
+             * @param size_t bio_buffer_size - capacity of each direction of the BIO pair in bytes, 0 for the default
+             * @return bool - false if OpenSSL could not create the pair
+             */
+            bool SetupBIOPair(size_t bio_buffer_size);
+
+        public:
+            // Disabling copy constructors
+            OpenSSLMemoryBIOEngine(const OpenSSLMemoryBIOEngine &) = delete;
+            OpenSSLMemoryBIOEngine &operator=(const OpenSSLMemoryBIOEngine &) = delete;
+
+            /**
+             * @brief Create an engine for a new client connection
+             *
+             * @param SSL_CTX * p_ssl_context - context holding the credentials
+             * @param size_t bio_buffer_size - capacity of each direction of the BIO pair in bytes, 0 for the default
+             * @return std::unique_ptr<OpenSSLMemoryBIOEngine> - the engine, nullptr if OpenSSL could not create it
+             */
+            static std::unique_ptr<OpenSSLMemoryBIOEngine> Create(SSL_CTX *p_ssl_context, size_t bio_buffer_size);
+
+            /**
+             * @brief Create an engine around an existing client SSL handle
+             *
+             * The handle is switched over to the BIO pair but stays owned by the caller, who has to keep it alive for
+             * as long as the engine exists.
+             *
+             * @param SSL * p_ssl_handle - configured SSL handle which has not started its handshake yet
+             * @param size_t bio_buffer_size - capacity of each direction of the BIO pair in bytes, 0 for the default
+             * @return std::unique_ptr<OpenSSLMemoryBIOEngine> - the engine, nullptr if OpenSSL could not create it
+             */
+            static std::unique_ptr<OpenSSLMemoryBIOEngine> Attach(SSL *p_ssl_handle, size_t bio_buffer_size);
+
+            /**
+             * @brief Get the SSL handle, for configuration before the handshake and for inspecting the session
+             *
+             * @return SSL * - SSL handle, owned by the engine unless it was attached
+             */
+            SSL *GetSSLHandle() const { return p_ssl_handle_; }
+
+            /**
+             * @brief Drive the client handshake
+             *
+             * @return int - SSL_ERROR_NONE once the handshake completed, SSL error code otherwise
+             */
+            int Handshake();
+
+            /**
+             * @brief Decrypt application data into the caller's buffer
+             *
+             * @param unsigned char * p_buf - destination buffer
+             * @param size_t length - capacity of the destination buffer
+             * @param size_t read_length_out - reference to store the number of bytes read
+             * @return int - SSL_ERROR_NONE if any bytes were read, SSL error code otherwise
+             */
+            int Read(unsigned char *p_buf, size_t length, size_t &read_length_out);
+
+            /**
+             * @brief Encrypt application data from the caller's buffer
+             *
+             * @param const unsigned char * p_buf - source buffer
+             * @param size_t length - number of bytes to write
+             * @param size_t written_length_out - reference to store the number of bytes accepted
+             * @return int - SSL_ERROR_NONE if any bytes were accepted, SSL error code otherwise
+             */
+            int Write(const unsigned char *p_buf, size_t length, size_t &written_length_out);
+
+            /**
+             * @brief Queue a close_notify alert
+             */
+            void Shutdown();
+
+            /**
+             * @brief Get the number of ciphertext bytes waiting to be sent
+             *
+             * @return size_t - pending outgoing ciphertext
+             */
+            size_t GetOutgoingCiphertextLength();
+
+            /**
+             * @brief Get a pointer to the next contiguous block of outgoing ciphertext
+             *
+             * The block stays valid and in place until it is consumed, so it can be handed to an asynchronous send.
+             *
+             * @param const char ** pp_data - reference to store the start of the block
+             * @return size_t - length of the block, 0 if nothing is pending
+             */
+            size_t PeekOutgoingCiphertext(const char **pp_data);
+
+            /**
+             * @brief Drop outgoing ciphertext that was sent
+             *
+             * @param size_t length - number of bytes sent from the start of the peeked block
+             */
+            void ConsumeOutgoingCiphertext(size_t length);
+
+            /**
+             * @brief Get how many ciphertext bytes can be written in without blocking
+             *
+             * @return size_t - free space for incoming ciphertext
+             */
+            size_t GetIncomingCiphertextSpace();
+
+            /**
+             * @brief Write ciphertext received from the network into the engine
+             *
+             * @param const unsigned char * p_data - received ciphertext
+             * @param size_t length - number of received bytes, at most GetIncomingCiphertextSpace()
+             * @return size_t - number of bytes accepted
+             */
+            size_t WriteIncomingCiphertext(const unsigned char *p_data, size_t length);
+
+            /**
+             * @brief Get a pointer to the next contiguous block of free space for incoming ciphertext
+             *
+             * Lets the transport receive straight into the engine. The block is only valid until the next call on the
+             * engine, so it must not be handed to an asynchronous receive.
+             *
+             * @param char ** pp_space - reference to store the start of the block
+             * @return size_t - length of the block, 0 if the engine is full
+             */
+            size_t PeekIncomingCiphertextSpace(char **pp_space);
+
+            /**
+             * @brief Make ciphertext received into the peeked block available to the engine
+             *
+             * @param size_t length - number of bytes received at the start of the peeked block
+             */
+            void CommitIncomingCiphertext(size_t length);
+
+            /**
+             * @brief Signal that the peer closed the connection
+             *
+             * Reads fail once the remaining incoming ciphertext has been consumed.
+             */
+            void SetIncomingEndOfStream();
+
+            ~OpenSSLMemoryBIOEngine();
+        };
+    }
+}
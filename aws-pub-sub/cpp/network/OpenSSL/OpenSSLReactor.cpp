@@ -0,0 +1,228 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLReactor.cpp
+ * @brief
+ *
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include "OpenSSLReactor.hpp"
+#include "OpenSSLConnection.hpp"
+#include "util/logging/LogMacros.hpp"
+
+#define OPENSSL_REACTOR_LOG_TAG "[OpenSSL Reactor]"
+
+// Events handled per epoll_wait call by each reactor thread
+#define OPENSSL_REACTOR_MAX_EVENTS 64
+
+namespace awsiotsdk {
+    namespace network {
+        OpenSSLReactor::OpenSSLReactor() {
+            epoll_fd_ = -1;
+            wakeup_fd_ = -1;
+            is_running_ = false;
+        }
+
+        std::shared_ptr<OpenSSLReactor> OpenSSLReactor::Create(size_t thread_count) {
+#ifdef __linux__
+            std::shared_ptr<OpenSSLReactor> p_reactor = std::shared_ptr<OpenSSLReactor>(new OpenSSLReactor());
+
+            p_reactor->epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+            if (-1 == p_reactor->epoll_fd_) {
+                AWS_LOG_ERROR(OPENSSL_REACTOR_LOG_TAG, "epoll_create1 - %s", strerror(errno));
+                return nullptr;
+            }
+
+            p_reactor->wakeup_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (-1 == p_reactor->wakeup_fd_) {
+                AWS_LOG_ERROR(OPENSSL_REACTOR_LOG_TAG, "eventfd - %s", strerror(errno));
+                return nullptr;
+            }
+
+            // Level triggered and never read, so once signalled every thread wakes up
+            struct epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.fd = p_reactor->wakeup_fd_;
+            if (-1 == epoll_ctl(p_reactor->epoll_fd_, EPOLL_CTL_ADD, p_reactor->wakeup_fd_, &event)) {
+                AWS_LOG_ERROR(OPENSSL_REACTOR_LOG_TAG, "epoll_ctl - %s", strerror(errno));
+                return nullptr;
+            }
+
+            if (0 == thread_count) {
+                thread_count = 1;
+            }
+            p_reactor->is_running_ = true;
+            for (size_t itr = 0; itr < thread_count; itr++) {
+                p_reactor->reactor_threads_.push_back(std::unique_ptr<std::thread>(
+                    new std::thread(&OpenSSLReactor::ReactorThread, p_reactor.get())));
+            }
+            AWS_LOG_INFO(OPENSSL_REACTOR_LOG_TAG, "Started reactor with %zu threads", thread_count);
+
+            return p_reactor;
+#else
+            AWS_LOG_ERROR(OPENSSL_REACTOR_LOG_TAG, "The reactor requires epoll and is only supported on Linux");
+            return nullptr;
+#endif
+        }
+
+        ResponseCode OpenSSLReactor::Register(OpenSSLConnection *p_connection, int socket_fd) {
+#ifdef __linux__
+            std::lock_guard<std::mutex> registry_guard(registry_mutex_);
+            RegisteredConnection &entry = registry_[socket_fd];
+            entry.p_connection_ = p_connection;
+            entry.is_registered_ = true;
+            entry.is_busy_ = false;
+
+            // One shot, so a connection is handed to one thread at a time and is re-armed once it was handled
+            struct epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN | EPOLLONESHOT;
+            event.data.fd = socket_fd;
+            if (-1 == epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket_fd, &event)) {
+                AWS_LOG_ERROR(OPENSSL_REACTOR_LOG_TAG, "epoll_ctl - %s", strerror(errno));
+                registry_.erase(socket_fd);
+                return ResponseCode::NETWORK_TCP_SETUP_ERROR;
+            }
+            return ResponseCode::SUCCESS;
+#else
+            return ResponseCode::NETWORK_TCP_SETUP_ERROR;
+#endif
+        }
+
+        void OpenSSLReactor::Rearm(int socket_fd, Interest interest) {
+            std::lock_guard<std::mutex> registry_guard(registry_mutex_);
+            std::map<int, RegisteredConnection>::iterator itr = registry_.find(socket_fd);
+            if (registry_.end() != itr && itr->second.is_registered_) {
+                RearmLocked(socket_fd, interest);
+            }
+        }
+
+        void OpenSSLReactor::RearmLocked(int socket_fd, Interest interest) {
+#ifdef __linux__
+            if (Interest::NONE == interest) {
+                return;
+            }
+            struct epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = (Interest::WRITE == interest ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+            event.data.fd = socket_fd;
+            if (-1 == epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, socket_fd, &event)) {
+                AWS_LOG_ERROR(OPENSSL_REACTOR_LOG_TAG, "epoll_ctl - %s", strerror(errno));
+            }
+#endif
+        }
+
+        void OpenSSLReactor::Deregister(int socket_fd) {
+#ifdef __linux__
+            std::unique_lock<std::mutex> registry_lock(registry_mutex_);
+            std::map<int, RegisteredConnection>::iterator itr = registry_.find(socket_fd);
+            if (registry_.end() == itr) {
+                return;
+            }
+            itr->second.is_registered_ = false;
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket_fd, nullptr);
+
+            // Entries are never erased by anyone else, so the iterator stays valid while waiting
+            while (itr->second.is_busy_) {
+                registry_cv_.wait(registry_lock);
+            }
+            registry_.erase(itr);
+#endif
+        }
+
+        size_t OpenSSLReactor::GetConnectionCount() {
+            std::lock_guard<std::mutex> registry_guard(registry_mutex_);
+            return registry_.size();
+        }
+
+        void OpenSSLReactor::ReactorThread() {
+#ifdef __linux__
+            struct epoll_event events[OPENSSL_REACTOR_MAX_EVENTS];
+
+            while (is_running_) {
+                int event_count = epoll_wait(epoll_fd_, events, OPENSSL_REACTOR_MAX_EVENTS, -1);
+                if (-1 == event_count) {
+                    if (EINTR == errno) {
+                        continue;
+                    }
+                    AWS_LOG_ERROR(OPENSSL_REACTOR_LOG_TAG, "epoll_wait - %s", strerror(errno));
+                    break;
+                }
+
+                for (int itr = 0; itr < event_count && is_running_; itr++) {
+                    int socket_fd = events[itr].data.fd;
+                    if (wakeup_fd_ == socket_fd) {
+                        continue;
+                    }
+
+                    OpenSSLConnection *p_connection = nullptr;
+                    {
+                        std::lock_guard<std::mutex> registry_guard(registry_mutex_);
+                        std::map<int, RegisteredConnection>::iterator entry = registry_.find(socket_fd);
+                        // A busy connection is re-armed by the thread handling it
+                        if (registry_.end() == entry || !entry->second.is_registered_ || entry->second.is_busy_) {
+                            continue;
+                        }
+                        entry->second.is_busy_ = true;
+                        p_connection = entry->second.p_connection_;
+                    }
+
+                    Interest interest = p_connection->OnReactorEvent();
+
+                    std::lock_guard<std::mutex> registry_guard(registry_mutex_);
+                    std::map<int, RegisteredConnection>::iterator entry = registry_.find(socket_fd);
+                    entry->second.is_busy_ = false;
+                    if (entry->second.is_registered_) {
+                        RearmLocked(socket_fd, interest);
+                    }
+                    registry_cv_.notify_all();
+                }
+            }
+#endif
+        }
+
+        OpenSSLReactor::~OpenSSLReactor() {
+#ifdef __linux__
+            is_running_ = false;
+            if (-1 != wakeup_fd_) {
+                uint64_t wakeup = 1;
+                if (sizeof(wakeup) != write(wakeup_fd_, &wakeup, sizeof(wakeup))) {
+                    AWS_LOG_WARN(OPENSSL_REACTOR_LOG_TAG, "Unable to wake up the reactor threads");
+                }
+            }
+            for (size_t itr = 0; itr < reactor_threads_.size(); itr++) {
+                reactor_threads_[itr]->join();
+            }
+            if (-1 != wakeup_fd_) {
+                close(wakeup_fd_);
+            }
+            if (-1 != epoll_fd_) {
+                close(epoll_fd_);
+            }
+#endif
+        }
+    }
+}
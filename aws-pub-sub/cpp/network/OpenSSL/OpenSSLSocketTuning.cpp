@@ -0,0 +1,165 @@
+/*
+ * Copyright 2010-2017 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file OpenSSLSocketTuning.cpp
+ * @brief
+ *
+ */
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+#include "OpenSSLSocketTuning.hpp"
+#include "util/logging/LogMacros.hpp"
+
+#define OPENSSL_SOCKET_TUNING_LOG_TAG "[OpenSSL Socket Tuning]"
+
+namespace awsiotsdk {
+    namespace network {
+        namespace {
+            bool SetIntOption(int socket_fd, int level, int option_name, int value, const char *p_option_str) {
+                if (0 != setsockopt(socket_fd, level, option_name, (const char *) &value, sizeof(value))) {
+                    AWS_LOG_WARN(OPENSSL_SOCKET_TUNING_LOG_TAG, "setsockopt %s - %s", p_option_str, strerror(errno));
+                    return false;
+                }
+                return true;
+            }
+        }
+
+        OpenSSLSocketTuning OpenSSLSocketTuning::ForProfile(Profile profile) {
+            OpenSSLSocketTuning tuning;
+            tuning.no_delay = false;
+            tuning.send_buffer_bytes = 0;
+            tuning.receive_buffer_bytes = 0;
+            tuning.keepalive_idle = std::chrono::seconds(0);
+            tuning.keepalive_interval = std::chrono::seconds(0);
+            tuning.keepalive_probe_count = 0;
+            tuning.user_timeout = std::chrono::milliseconds(0);
+            tuning.not_sent_low_watermark_bytes = 0;
+
+            switch (profile) {
+                case Profile::LOW_LATENCY:
+                    // MQTT packets are small, don't let Nagle hold one back waiting for the ACK of the previous one.
+                    // A small unsent backlog keeps fresh messages from queueing behind stale ones.
+                    tuning.no_delay = true;
+                    tuning.not_sent_low_watermark_bytes = 16384;
+                    tuning.keepalive_idle = std::chrono::seconds(10);
+                    tuning.keepalive_interval = std::chrono::seconds(2);
+                    tuning.keepalive_probe_count = 3;
+                    tuning.user_timeout = std::chrono::milliseconds(10000);
+                    break;
+                case Profile::BULK_THROUGHPUT:
+                    // Windows large enough for a few hundred KB in flight, records leave as full segments
+                    tuning.no_delay = false;
+                    tuning.send_buffer_bytes = 1024 * 1024;
+                    tuning.receive_buffer_bytes = 1024 * 1024;
+                    tuning.keepalive_idle = std::chrono::seconds(60);
+                    tuning.keepalive_interval = std::chrono::seconds(10);
+                    tuning.keepalive_probe_count = 5;
+                    tuning.user_timeout = std::chrono::milliseconds(60000);
+                    break;
+                case Profile::LOW_POWER:
+                    // Every probe wakes the radio, so probe rarely and let writes coalesce
+                    tuning.no_delay = false;
+                    tuning.send_buffer_bytes = 16384;
+                    tuning.receive_buffer_bytes = 16384;
+                    tuning.keepalive_idle = std::chrono::seconds(300);
+                    tuning.keepalive_interval = std::chrono::seconds(30);
+                    tuning.keepalive_probe_count = 4;
+                    tuning.user_timeout = std::chrono::milliseconds(120000);
+                    break;
+                case Profile::SYSTEM_DEFAULT:
+                default:
+                    break;
+            }
+            return tuning;
+        }
+
+        ResponseCode OpenSSLSocketTuning::ParseProfile(const util::String &name, Profile &profile_out) {
+            if ("system_default" == name || name.empty()) {
+                profile_out = Profile::SYSTEM_DEFAULT;
+            } else if ("low_latency" == name) {
+                profile_out = Profile::LOW_LATENCY;
+            } else if ("bulk_throughput" == name) {
+                profile_out = Profile::BULK_THROUGHPUT;
+            } else if ("low_power" == name) {
+                profile_out = Profile::LOW_POWER;
+            } else {
+                AWS_LOG_ERROR(OPENSSL_SOCKET_TUNING_LOG_TAG, "Unknown socket profile %s", name.c_str());
+                return ResponseCode::FAILURE;
+            }
+            return ResponseCode::SUCCESS;
+        }
+
+        ResponseCode OpenSSLSocketTuning::Apply(int socket_fd) const {
+            bool is_applied = true;
+
+            if (no_delay) {
+                is_applied &= SetIntOption(socket_fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+            }
+            if (0 < send_buffer_bytes) {
+                is_applied &= SetIntOption(socket_fd, SOL_SOCKET, SO_SNDBUF, send_buffer_bytes, "SO_SNDBUF");
+            }
+            if (0 < receive_buffer_bytes) {
+                is_applied &= SetIntOption(socket_fd, SOL_SOCKET, SO_RCVBUF, receive_buffer_bytes, "SO_RCVBUF");
+            }
+            if (0 < keepalive_idle.count()) {
+                is_applied &= SetIntOption(socket_fd, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+#ifdef TCP_KEEPIDLE
+                is_applied &= SetIntOption(socket_fd, IPPROTO_TCP, TCP_KEEPIDLE,
+                                           static_cast<int>(keepalive_idle.count()), "TCP_KEEPIDLE");
+#elif defined(TCP_KEEPALIVE)
+                is_applied &= SetIntOption(socket_fd, IPPROTO_TCP, TCP_KEEPALIVE,
+                                           static_cast<int>(keepalive_idle.count()), "TCP_KEEPALIVE");
+#endif
+#ifdef TCP_KEEPINTVL
+                if (0 < keepalive_interval.count()) {
+                    is_applied &= SetIntOption(socket_fd, IPPROTO_TCP, TCP_KEEPINTVL,
+                                               static_cast<int>(keepalive_interval.count()), "TCP_KEEPINTVL");
+                }
+#endif
+#ifdef TCP_KEEPCNT
+                if (0 < keepalive_probe_count) {
+                    is_applied &= SetIntOption(socket_fd, IPPROTO_TCP, TCP_KEEPCNT, keepalive_probe_count,
+                                               "TCP_KEEPCNT");
+                }
+#endif
+            }
+#ifdef TCP_USER_TIMEOUT
+            if (0 < user_timeout.count()) {
+                is_applied &= SetIntOption(socket_fd, IPPROTO_TCP, TCP_USER_TIMEOUT,
+                                           static_cast<int>(user_timeout.count()), "TCP_USER_TIMEOUT");
+            }
+#endif
+#ifdef TCP_NOTSENT_LOWAT
+            if (0 < not_sent_low_watermark_bytes) {
+                is_applied &= SetIntOption(socket_fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, not_sent_low_watermark_bytes,
+                                           "TCP_NOTSENT_LOWAT");
+            }
+#endif
+
+            return is_applied ? ResponseCode::SUCCESS : ResponseCode::NETWORK_TCP_SETUP_ERROR;
+        }
+    }
+}